@@ -0,0 +1,344 @@
+#include "GraphicsApi.h"
+#include "null/NullDevice.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <random>
+
+using namespace mygfx;
+
+namespace {
+
+struct Float4x4 {
+    float m[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+};
+
+struct Vertex2D {
+    float pos[3];
+    uint32_t color;
+    float uv[2];
+    uint32_t texIndex;
+};
+
+struct BenchOptions {
+    uint32_t frames = 500;
+    uint32_t objects = 10000;
+    const char* filter = nullptr;
+};
+
+struct BenchScene {
+    Ref<HwSwapchain> swapchain;
+    Ref<HwProgram> program;
+    PipelineState pipelineState;
+    PipelineState instancedState;
+    Ref<VertexData> cubeData;
+    Ref<HwRenderPrimitive> cube;
+    Ref<HwRenderQueue> renderQueue;
+
+    std::vector<Float4x4> transforms;
+    std::vector<int> texIndices;
+    std::vector<Vertex2D> vertices;
+    std::vector<uint16_t> indices;
+};
+
+// Records one frame of the workload
+using Workload = std::function<void(GraphicsApi& cmd, BenchScene& scene)>;
+
+struct BenchCase {
+    const char* name;
+    Workload workload;
+};
+
+void createScene(GraphicsApi& cmd, BenchScene& scene, uint32_t objectCount)
+{
+    scene.swapchain = cmd.createSwapchain(SwapChainDesc {});
+    scene.program = cmd.createProgram(nullptr, 0, {});
+    scene.pipelineState.program = scene.program;
+    scene.instancedState = scene.pipelineState;
+    scene.instancedState.primitiveState.instancing = true;
+
+    float cubeVertices[8 * 3] = {
+        -1, -1, -1, 1, -1, -1, 1, 1, -1, -1, 1, -1,
+        -1, -1, 1, 1, -1, 1, 1, 1, 1, -1, 1, 1
+    };
+
+    uint16_t cubeIndices[36] = {
+        0, 1, 2, 2, 3, 0, 4, 5, 6, 6, 7, 4,
+        0, 4, 7, 7, 3, 0, 1, 5, 6, 6, 2, 1,
+        3, 2, 6, 6, 7, 3, 0, 1, 5, 5, 4, 0
+    };
+
+    scene.cubeData = new VertexData();
+    scene.cubeData->vertexBuffers.push_back(cmd.createBuffer1(BufferUsage::VERTEX, MemoryUsage::GPU_ONLY, 24, cubeVertices));
+    scene.cubeData->indexBuffer = cmd.createBuffer1(BufferUsage::INDEX, MemoryUsage::GPU_ONLY, 36, cubeIndices);
+
+    DrawPrimitiveCommand primitive;
+    primitive.indexCount = 36;
+    scene.cube = cmd.createRenderPrimitive(scene.cubeData, primitive);
+    scene.renderQueue = new HwRenderQueue();
+
+    std::mt19937 rand(0);
+
+    // 07_RenderQueueDemo: a grid of cubes, each with its own transform and texture index
+    scene.transforms.resize(objectCount);
+    scene.texIndices.resize(objectCount);
+    for (uint32_t i = 0; i < objectCount; i++) {
+        scene.transforms[i].m[12] = (float)(i % 100) * 2.0f;
+        scene.transforms[i].m[13] = (float)(i / 100) * 2.0f;
+        scene.texIndices[i] = rand() % 10;
+    }
+
+    // 08_DynamicBufferDemo: one quad per sprite
+    scene.vertices.resize(objectCount * 4);
+    scene.indices.reserve(objectCount * 6);
+    for (uint32_t i = 0; i < objectCount; i++) {
+        float x = (float)(rand() % 1280);
+        float y = (float)(rand() % 720);
+        float halfSize = 5.0f + (float)(rand() % 5);
+        Vertex2D* v = &scene.vertices[i * 4];
+        v[0] = { { x - halfSize, y - halfSize, 0 }, 0xffffffff, { 0, 0 }, i % 64 };
+        v[1] = { { x + halfSize, y - halfSize, 0 }, 0xffffffff, { 1, 0 }, i % 64 };
+        v[2] = { { x + halfSize, y + halfSize, 0 }, 0xffffffff, { 1, 1 }, i % 64 };
+        v[3] = { { x - halfSize, y + halfSize, 0 }, 0xffffffff, { 0, 1 }, i % 64 };
+
+        uint16_t start = (uint16_t)(i * 4);
+        uint16_t quad[6] = { start, (uint16_t)(start + 1), (uint16_t)(start + 2), (uint16_t)(start + 3), start, (uint16_t)(start + 2) };
+        scene.indices.insert(scene.indices.end(), quad, quad + 6);
+    }
+}
+
+void drawPrimitives(GraphicsApi& cmd, BenchScene& scene)
+{
+    Float4x4 vp;
+    uint32_t perView = cmd.allocConstant(vp);
+    for (size_t i = 0; i < scene.transforms.size(); i++) {
+        uint32_t perObject = cmd.allocConstant(scene.transforms[i]);
+        uint32_t perMaterial = cmd.allocConstant(scene.texIndices[i]);
+        cmd.bindPipelineState(scene.pipelineState);
+        cmd.bindUniforms({ perView, perObject, perMaterial });
+        cmd.drawPrimitive(scene.cube, 1, 0);
+    }
+}
+
+void pushConstants(GraphicsApi& cmd, BenchScene& scene)
+{
+    cmd.bindPipelineState(scene.pipelineState);
+    for (auto& transform : scene.transforms) {
+        cmd.pushConstant(0, transform);
+        cmd.draw(36, 1, 0, 0);
+    }
+}
+
+void userPrimitives(GraphicsApi& cmd, BenchScene& scene)
+{
+    Float4x4 proj;
+    uint32_t ubo = cmd.allocConstant(proj);
+    cmd.bindPipelineState(scene.pipelineState);
+    cmd.bindUniforms({ ubo });
+
+    uint32_t spriteCount = (uint32_t)scene.vertices.size() / 4;
+    for (uint32_t i = 0; i < spriteCount; i++) {
+        cmd.drawUserPrimitives(Span<Vertex2D> { &scene.vertices[i * 4], 4 }, Span<uint16_t> { scene.indices.data(), 6 });
+    }
+}
+
+void customCommands(GraphicsApi& cmd, BenchScene& scene)
+{
+    static std::atomic<uint32_t> sCounter = 0;
+    for (size_t i = 0; i < scene.transforms.size(); i++) {
+        cmd.queueCommand([]() {
+            sCounter++;
+        });
+    }
+}
+
+void renderQueueDemo(GraphicsApi& cmd, BenchScene& scene)
+{
+    Float4x4 vp;
+    uint32_t perView = cmd.allocConstant(vp);
+
+    scene.renderQueue->clear();
+
+    auto& renderCmds = scene.renderQueue->getWriteCommands();
+    for (size_t i = 0; i < scene.transforms.size(); i++) {
+        uint32_t perObject = cmd.allocConstant(scene.transforms[i]);
+        uint32_t perMaterial = cmd.allocConstant(scene.texIndices[i]);
+        auto& rc = renderCmds.emplace_back();
+        rc.renderPrimitive = scene.cube;
+        rc.pipelineState = scene.pipelineState;
+        rc.uniforms.set(perView, perObject, perMaterial);
+        rc.material = (uint16_t)scene.texIndices[i];
+    }
+
+    scene.renderQueue->sort();
+    cmd.drawBatch(scene.renderQueue);
+}
+
+void renderQueueInstanced(GraphicsApi& cmd, BenchScene& scene)
+{
+    Float4x4 vp;
+    uint32_t perView = cmd.allocConstant(vp);
+
+    scene.renderQueue->clear();
+
+    auto& renderCmds = scene.renderQueue->getWriteCommands();
+    for (size_t i = 0; i < scene.transforms.size(); i++) {
+        uint32_t perObject = cmd.allocConstant(scene.transforms[i]);
+        uint32_t perMaterial = cmd.allocConstant(scene.texIndices[i]);
+        auto& rc = renderCmds.emplace_back();
+        rc.renderPrimitive = scene.cube;
+        rc.pipelineState = scene.instancedState;
+        rc.uniforms.set(perView);
+        rc.instanceData.set(perObject, perMaterial);
+        rc.material = (uint16_t)scene.texIndices[i];
+    }
+
+    scene.renderQueue->sort();
+    scene.renderQueue->mergeInstances();
+    cmd.drawBatch(scene.renderQueue);
+}
+
+void dynamicBufferDemo(GraphicsApi& cmd, BenchScene& scene)
+{
+    Float4x4 proj;
+    uint32_t ubo = cmd.allocConstant(proj);
+
+    cmd.bindPipelineState(scene.pipelineState);
+    cmd.bindUniforms({ ubo });
+    cmd.drawUserPrimitives(Span<Vertex2D> { scene.vertices }, Span<uint16_t> { scene.indices });
+}
+
+void runCase(GraphicsApi& cmd, BenchScene& scene, const BenchCase& benchCase, const BenchOptions& options)
+{
+    // warm up, so the render thread and the dynamic buffer rings are in steady state
+    const uint32_t warmupFrames = 10;
+
+    double recordTime = 0.0;
+    size_t totalCommands = 0;
+    size_t totalBytes = 0;
+    size_t maxBytes = 0;
+
+    auto start = Clock::now();
+    for (uint32_t frame = 0; frame < warmupFrames + options.frames; frame++) {
+        if (frame == warmupFrames) {
+            recordTime = 0.0;
+            totalCommands = totalBytes = maxBytes = 0;
+            start = Clock::now();
+        }
+
+        auto recordStart = Clock::now();
+
+        cmd.beginFrame();
+        cmd.makeCurrent(scene.swapchain);
+
+        RenderPassInfo renderInfo {
+            .clearFlags = TargetBufferFlags::ALL,
+        };
+        renderInfo.viewport = { .left = 0, .top = 0, .width = 1280, .height = 720 };
+        cmd.beginRendering(scene.swapchain->renderTarget, renderInfo);
+
+        benchCase.workload(cmd, scene);
+
+        cmd.endRendering(scene.swapchain->renderTarget);
+        cmd.commit(scene.swapchain);
+        cmd.endFrame();
+
+        size_t bytes = cmd.getCommandSize();
+#if MYGFX_COMMAND_COUNT
+        size_t commands = cmd.getCommandCount();
+#else
+        size_t commands = 0;
+#endif
+
+        recordTime += std::chrono::duration<double>(Clock::now() - recordStart).count();
+        totalCommands += commands;
+        totalBytes += bytes;
+        maxBytes = std::max(maxBytes, bytes);
+
+        cmd.flush();
+    }
+
+    double totalTime = std::chrono::duration<double>(Clock::now() - start).count();
+
+    printf("%-28s %10.2f %10.2f %12.2f %12.2f %12zu %12zu\n",
+        benchCase.name,
+        totalTime * 1000.0 / options.frames,
+        recordTime * 1000.0 / options.frames,
+        totalCommands / recordTime / 1e6,
+        totalCommands / totalTime / 1e6,
+        totalBytes / options.frames,
+        maxBytes);
+}
+
+void parseArgs(int argc, char** argv, BenchOptions& options)
+{
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-frames") == 0 && i + 1 < argc) {
+            options.frames = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-objects") == 0 && i + 1 < argc) {
+            options.objects = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-filter") == 0 && i + 1 < argc) {
+            options.filter = argv[++i];
+        } else {
+            printf("usage: %s [-frames N] [-objects N] [-filter name]\n", argv[0]);
+            exit(1);
+        }
+    }
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    BenchOptions options;
+    parseArgs(argc, argv, options);
+
+    // drawUserPrimitives uses 16 bit indices
+    options.objects = std::min(options.objects, 65536u / 4);
+
+    Settings settings { .name = "CommandStreamBench" };
+    auto device = new NullDevice();
+    if (!device->create(settings)) {
+        return 1;
+    }
+
+    auto api = std::make_unique<GraphicsApi>(*device);
+
+    BenchScene scene;
+    createScene(*api, scene, options.objects);
+
+    const BenchCase benchCases[] = {
+        { "bindPipelineState+drawPrim", drawPrimitives },
+        { "pushConstant+draw", pushConstants },
+        { "drawUserPrimitives", userPrimitives },
+        { "CustomCommand", customCommands },
+        { "07_RenderQueueDemo", renderQueueDemo },
+        { "07_RenderQueueInstanced", renderQueueInstanced },
+        { "08_DynamicBufferDemo", dynamicBufferDemo },
+    };
+
+    printf("device: %s, objects: %u, frames: %u\n", api->getDeviceName(), options.objects, options.frames);
+#if !MYGFX_COMMAND_COUNT
+    printf("commands are not counted, configure with -DCOMMAND_COUNT=ON for the Mcmd/s columns\n");
+#endif
+    printf("%-28s %10s %10s %12s %12s %12s %12s\n",
+        "case", "frame ms", "record ms", "Mcmd/s rec", "Mcmd/s e2e", "bytes/frame", "max bytes");
+
+    for (auto& benchCase : benchCases) {
+        if (options.filter && strstr(benchCase.name, options.filter) == nullptr) {
+            continue;
+        }
+        runCase(*api, scene, benchCase, options);
+    }
+
+    // let the render thread drain before the device goes away
+    api->flush();
+    api->flush();
+
+    scene = {};
+    api->destroy();
+    return 0;
+}
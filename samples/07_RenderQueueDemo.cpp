@@ -20,7 +20,7 @@ public:
 
     void start() override
     {
-        mShader = ShaderLibs::getSimpleLightShader();
+        mShader = ShaderLibs::getInstancedLightShader();
         mMesh = Mesh::createCube(1.0f);
         mTextures = Texture::createRandomColorTextures(10);
 
@@ -65,10 +65,14 @@ public:
                 auto& rc = renderCmds.emplace_back();
                 rc.renderPrimitive = prim;
                 rc.pipelineState = mShader->pipelineState;
-                rc.uniforms.set(perView, perObject, perMaterial);
+                rc.uniforms.set(perView);
+                rc.instanceData.set(perObject, perMaterial);
+                rc.material = (uint16_t)renderable.texIndex;
             }
         }
 
+        mRenderQueue->sort();
+        mRenderQueue->mergeInstances();
         cmd.drawBatch(mRenderQueue);
     }
 };
@@ -5,6 +5,7 @@ namespace mygfx::samples {
 static utils::Ref<Shader> sColorShader;
 static utils::Ref<Shader> sUnlitShader;
 static utils::Ref<Shader> sLightShader;
+static utils::Ref<Shader> sInstancedLightShader;
 static utils::Ref<Shader> sFullscreenShader;
 
 void ShaderLibs::clean()
@@ -12,6 +13,7 @@ void ShaderLibs::clean()
     sColorShader.reset();
     sUnlitShader.reset();
     sLightShader.reset();
+    sInstancedLightShader.reset();
     sFullscreenShader.reset();
 }
 
@@ -182,6 +184,76 @@ utils::Ref<Shader> ShaderLibs::getSimpleLightShader()
     return sLightShader;
 }
 
+utils::Ref<Shader> ShaderLibs::getInstancedLightShader()
+{
+    if (sInstancedLightShader) {
+        return sInstancedLightShader;
+    }
+
+    const char* vsCode = R"(
+	#version 450
+			
+	layout (binding = 0) uniform PerView {
+		mat4 viewProj;
+	} frameUniforms;
+
+	// the uniform ring, instance records are { world offset, material offset } in bytes
+	layout (std430, binding = 1) readonly buffer InstanceData {
+		uvec4 data[];
+	} instanceData;
+
+	layout(location = 0) in vec3 inPos;
+	layout(location = 1) in vec2 inUV;
+	layout(location = 2) in vec3 inNorm;
+
+	layout(location = 0) out vec2 outUV;
+	layout(location = 1) out vec3 outNorm;
+	layout(location = 2) flat out int outTexIndex;
+
+	void main()
+	{
+		uvec4 record = instanceData.data[gl_InstanceIndex];
+		uint world = record.x / 16;
+		mat4 worldMat = mat4(uintBitsToFloat(instanceData.data[world]), uintBitsToFloat(instanceData.data[world + 1]),
+			uintBitsToFloat(instanceData.data[world + 2]), uintBitsToFloat(instanceData.data[world + 3]));
+
+		outUV = inUV;
+		outNorm = inNorm;
+		outTexIndex = int(instanceData.data[record.y / 16].x);
+		gl_Position = frameUniforms.viewProj * worldMat * vec4(inPos.xyz, 1.0);
+	}
+	)";
+
+    const char* fsCode = R"(
+	#version 450
+
+	#extension GL_EXT_nonuniform_qualifier : require
+
+	layout(set = 1, binding = 0) uniform texture2D textures_2d[];
+	layout(set = 2, binding = 0) uniform sampler samplers[];
+
+	layout(location = 0) in vec2 inUV;
+	layout(location = 1) in vec3 inNorm;
+	layout(location = 2) flat in int inTexIndex;
+
+	layout(location = 0) out vec4 outFragColor;
+	
+	#define getSampler2D(index) sampler2D(textures_2d[nonuniformEXT((index) & 0xffff)], samplers[nonuniformEXT((index) >> 16)])
+	
+	void main()
+	{
+		outFragColor = texture(getSampler2D(inTexIndex), inUV);
+	}
+	)";
+
+    sInstancedLightShader = new Shader(vsCode, fsCode);
+    sInstancedLightShader->setVertexInput({ Format::R32G32B32_SFLOAT, {},
+        Format::R32G32_SFLOAT, {},
+        Format::R32G32B32_SFLOAT });
+    sInstancedLightShader->pipelineState.primitiveState.instancing = true;
+    return sInstancedLightShader;
+}
+
 Shader* ShaderLibs::getFullscreenShader()
 {
     if (sFullscreenShader) {
@@ -1,4 +1,5 @@
 #include "VulkanExample.h"
+#include "resource/ShaderCompiler.h"
 #include "resource/Texture.h"
 #include "utils/Log.h"
 #include "vulkan/VulkanDevice.h"
@@ -31,6 +32,8 @@ bool VulkanExample::initVulkan()
     mygfx::Settings s;
     s.name = title.c_str();
     s.validation = settings.validation;
+    s.pipelineCachePath = "pipeline_cache.bin";
+    s.shaderCachePath = "shader_cache";
     auto device = new VulkanDevice();
     if (!device->create(s)) {
         return false;
@@ -39,6 +42,7 @@ bool VulkanExample::initVulkan()
     mGraphicsApi = std::make_unique<GraphicsApi>(*device);
 
     Texture::staticInit();
+    ShaderCompiler::setCacheDir("shader_cache");
     return true;
 }
 
@@ -1,15 +1,80 @@
 #include "Mesh.h"
 #include "GraphicsApi.h"
+#include "utils/algorithm.h"
+#include <cstring>
 
 namespace mygfx {
 
+Ref<VertexData> MeshBuilder::beginVertexData()
+{
+    return mVertexData.emplace_back(new VertexData());
+}
+
+uint64_t MeshBuilder::append(const void* data, uint64_t size)
+{
+    // 16 bytes keeps every vertex format and both index types aligned
+    uint64_t offset = utils::alignUp<uint64_t>(mData.size(), 16);
+    mData.resize(offset + size);
+    std::memcpy(mData.data() + offset, data, size);
+    return offset;
+}
+
+void MeshBuilder::addVertices(VertexAttribute attribute, const void* data, uint32_t count, uint32_t stride)
+{
+    assert(!mVertexData.empty());
+    auto& vertexData = mVertexData.back();
+    vertexData->vertexOffsets.push_back(append(data, (uint64_t)count * stride));
+    vertexData->vertexAttributes.push_back(attribute);
+    if (vertexData->vertexCount == 0) {
+        vertexData->vertexCount = count;
+    }
+}
+
+void MeshBuilder::setIndices(const uint16_t* indices, uint32_t count)
+{
+    assert(!mVertexData.empty());
+    auto& vertexData = mVertexData.back();
+    vertexData->indexOffset = append(indices, count * sizeof(uint16_t));
+    vertexData->indexType = IndexType::UINT16;
+    vertexData->indexCount = count;
+}
+
+void MeshBuilder::setIndices(const uint32_t* indices, uint32_t count)
+{
+    assert(!mVertexData.empty());
+    auto& vertexData = mVertexData.back();
+    vertexData->indexOffset = append(indices, count * sizeof(uint32_t));
+    vertexData->indexType = IndexType::UINT32;
+    vertexData->indexCount = count;
+}
+
+Ref<HwBuffer> MeshBuilder::build()
+{
+    if (mData.empty()) {
+        return nullptr;
+    }
+
+    auto buffer = gfxApi().createBuffer(BufferUsage::VERTEX | BufferUsage::INDEX, MemoryUsage::GPU_ONLY, mData.size(), 0, mData.data());
+
+    for (auto& vertexData : mVertexData) {
+        vertexData->vertexBuffers.assign(vertexData->vertexOffsets.size(), buffer);
+        if (vertexData->indexCount > 0) {
+            vertexData->indexBuffer = buffer;
+        }
+    }
+
+    mData.clear();
+    mVertexData.clear();
+    return buffer;
+}
+
 SubMesh::SubMesh(VertexData* vertexData)
 {
     this->vertexData = vertexData;
     if (vertexData->indexBuffer) {
-        drawArgs.indexCount = (uint32_t)vertexData->indexBuffer->count();
+        drawArgs.indexCount = vertexData->indexCount > 0 ? vertexData->indexCount : (uint32_t)vertexData->indexBuffer->count();
     } else if (vertexData->vertexBuffers.size() > 0) {
-        drawArgs.vertexCount = (uint32_t)vertexData->vertexBuffers[0]->count();
+        drawArgs.vertexCount = vertexData->vertexCount > 0 ? vertexData->vertexCount : (uint32_t)vertexData->vertexBuffers[0]->count();
     } else {
         drawArgs.vertexCount = 3;
     }
@@ -91,20 +156,13 @@ Mesh* Mesh::createPlane(float size)
 
     uint32_t vertexCount = (uint32_t)std::size(pos);
 
-    auto vertexData = new VertexData();
-    auto vbPos = gfxApi().createBuffer1(BufferUsage::VERTEX, MemoryUsage::GPU_ONLY, vertexCount, pos);
-    vbPos->extra = (uint16_t)VertexAttribute::POSITION;
-    vertexData->vertexBuffers.push_back(vbPos);
-
-    auto vbTex = gfxApi().createBuffer1(BufferUsage::VERTEX, MemoryUsage::GPU_ONLY, vertexCount, tex);
-    vbTex->extra = (uint16_t)VertexAttribute::UV_0;
-    vertexData->vertexBuffers.push_back(vbTex);
-
-    auto vbNorm = gfxApi().createBuffer1(BufferUsage::VERTEX, MemoryUsage::GPU_ONLY, vertexCount, norm);
-    vbTex->extra = (uint16_t)VertexAttribute::NORMAL;
-    vertexData->vertexBuffers.push_back(vbNorm);
-
-    vertexData->indexBuffer = gfxApi().createBuffer1(BufferUsage::INDEX, MemoryUsage::GPU_ONLY, (uint32_t)std::size(indices), indices);
+    MeshBuilder builder;
+    auto vertexData = builder.beginVertexData();
+    builder.addVertices(VertexAttribute::POSITION, pos, vertexCount);
+    builder.addVertices(VertexAttribute::UV_0, tex, vertexCount);
+    builder.addVertices(VertexAttribute::NORMAL, norm, vertexCount);
+    builder.setIndices(indices, (uint32_t)std::size(indices));
+    builder.build();
 
     Mesh* mesh = new Mesh();
     mesh->addSubMesh(vertexData);
@@ -248,24 +306,20 @@ Mesh* Mesh::createCube(float size, VertexAttribute attributes)
 
     uint32_t vertexCount = (uint32_t)std::size(pos);
 
-    auto vertexData = new VertexData();
-    auto vbPos = gfxApi().createBuffer1(BufferUsage::VERTEX, MemoryUsage::GPU_ONLY, vertexCount, pos);
-    vbPos->extra = (uint16_t)VertexAttribute::POSITION;
-    vertexData->vertexBuffers.push_back(vbPos);
+    MeshBuilder builder;
+    auto vertexData = builder.beginVertexData();
+    builder.addVertices(VertexAttribute::POSITION, pos, vertexCount);
 
     if (any(attributes & VertexAttribute::UV_0)) {
-        auto vbTex = gfxApi().createBuffer1(BufferUsage::VERTEX, MemoryUsage::GPU_ONLY, vertexCount, tex);
-        vbTex->extra = (uint16_t)VertexAttribute::UV_0;
-        vertexData->vertexBuffers.push_back(vbTex);
+        builder.addVertices(VertexAttribute::UV_0, tex, vertexCount);
     }
 
     if (any(attributes & VertexAttribute::NORMAL)) {
-        auto vbNorm = gfxApi().createBuffer1(BufferUsage::VERTEX, MemoryUsage::GPU_ONLY, vertexCount, norm);
-        vbNorm->extra = (uint16_t)VertexAttribute::NORMAL;
-        vertexData->vertexBuffers.push_back(vbNorm);
+        builder.addVertices(VertexAttribute::NORMAL, norm, vertexCount);
     }
 
-    vertexData->indexBuffer = gfxApi().createBuffer1(BufferUsage::INDEX, MemoryUsage::GPU_ONLY, (uint32_t)std::size(indices), indices);
+    builder.setIndices(indices, (uint32_t)std::size(indices));
+    builder.build();
     Mesh* mesh = new Mesh();
     mesh->addSubMesh(vertexData);
     mesh->setBoundingBox({ { -CUBE_HALF_SIZE, -CUBE_HALF_SIZE, -CUBE_HALF_SIZE }, { CUBE_HALF_SIZE, CUBE_HALF_SIZE, CUBE_HALF_SIZE } });
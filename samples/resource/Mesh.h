@@ -18,6 +18,34 @@ struct SubMesh {
     Aabb boundingBox;
 };
 
+// Packs the vertex streams and indices of any number of VertexData into one GPU buffer, created
+// and uploaded in a single transfer by build(). Call build() before handing the VertexData to
+// Mesh::addSubMesh, render primitives resolve their buffers when they are created.
+class MeshBuilder {
+public:
+    // Streams and indices added after this call belong to the returned VertexData. build()
+    // drops the builder's references, keep the returned one until a SubMesh holds it.
+    Ref<VertexData> beginVertexData();
+
+    void addVertices(VertexAttribute attribute, const void* data, uint32_t count, uint32_t stride);
+    void setIndices(const uint16_t* indices, uint32_t count);
+    void setIndices(const uint32_t* indices, uint32_t count);
+
+    template <typename T>
+    void addVertices(VertexAttribute attribute, const T* data, uint32_t count)
+    {
+        addVertices(attribute, data, count, sizeof(T));
+    }
+
+    Ref<HwBuffer> build();
+
+private:
+    uint64_t append(const void* data, uint64_t size);
+
+    ByteArray mData;
+    Vector<Ref<VertexData>> mVertexData;
+};
+
 class Mesh : public utils::RefCounted {
 public:
     Mesh();
@@ -14,13 +14,24 @@ Shader::~Shader()
 {
 }
 
-void Shader::init()
+void Shader::init(const Span<const SpecializationValue>& specializationValues)
 {
-    mProgram = gfxApi().createProgram(mShaderModules.data(), (uint32_t)mShaderModules.size());
+    mProgram = gfxApi().createProgram(mShaderModules.data(), (uint32_t)mShaderModules.size(), specializationValues);
     mProgram->vertexInput = mVertexInput;
     pipelineState.program = mProgram;
 }
 
+Ref<Shader> Shader::specialize(const Span<const SpecializationValue>& specializationValues) const
+{
+    Ref<Shader> shader(new Shader());
+    shader->passName = passName;
+    shader->pipelineState = pipelineState;
+    shader->mShaderModules = mShaderModules;
+    shader->mVertexInput = mVertexInput;
+    shader->init(specializationValues);
+    return shader;
+}
+
 bool Shader::addShader(ShaderStage shaderStage, const String& shaderName, const String& source, ShaderSourceType sourceType, const String& entry, const String& extraParams, const DefineList* macros)
 {
     auto sm = ShaderCompiler::compileFromString(sourceType, shaderStage, shaderName, source, entry.c_str(), extraParams.c_str(), macros);
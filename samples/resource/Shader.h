@@ -18,7 +18,11 @@ public:
     Shader(const String& vsCode, const String& fsCode, const DefineList* marcos = nullptr);
     Shader(const String& csCode, const DefineList* marcos = nullptr);
     
-    void init();
+    void init(const Span<const SpecializationValue>& specializationValues = {});
+
+    // A shader sharing this one's modules and states, with its own program built from the given
+    // specialization constant values.
+    Ref<Shader> specialize(const Span<const SpecializationValue>& specializationValues) const;
 
     void setName(const std::string_view& name);
 
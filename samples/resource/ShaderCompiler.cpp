@@ -1,7 +1,12 @@
 #include "ShaderCompiler.h"
 #include "GraphicsDevice.h"
 #include "FileSystem.h"
+#include "JobSystem.h"
+#include "utils/FileUtils.h"
 #include "utils/Log.h"
+#include "utils/algorithm.h"
+#include <atomic>
+#include <fstream>
 #include <mutex>
 #include <shaderc/shaderc.hpp>
 
@@ -12,6 +17,31 @@ namespace {
     std::unordered_map<String, String> sIncludeFiles;
     Vector<Path> sShaderPath;
 
+    // bump when the compile options below change, old cache entries are then never hit
+    constexpr uint32_t SPIRV_CACHE_VERSION = 1;
+    constexpr uint32_t SPIRV_MAGIC = 0x07230203;
+
+    std::mutex sSpirvCacheMutex;
+    std::unordered_map<size_t, ByteArray> sSpirvCache;
+    Path sCacheDir;
+
+    JobSystem& getCompileJobs()
+    {
+        static JobSystem sJobSystem;
+        return sJobSystem;
+    }
+}
+
+void ShaderCompiler::setCacheDir(const Path& dir)
+{
+    std::lock_guard locker(sSpirvCacheMutex);
+    sCacheDir = dir;
+    if (!dir.empty()) {
+        if (!utils::FileUtils::createDirectories(dir)) {
+            LOG_WARNING("Can't create the shader cache dir {}", dir.string());
+            sCacheDir.clear();
+        }
+    }
 }
 
 void ShaderCompiler::init()
@@ -39,28 +69,25 @@ public:
         shaderc_include_type type, const char* requesting_source, size_t include_depth) override
 
     {
-        std::lock_guard locker(sIncludeFileMutex);
-
         String fileName(requested_source);
-        shaderc_include_result* ret = new shaderc_include_result();
-        ret->source_name = fileName.c_str();
-        ret->source_name_length = fileName.length();
-
-        auto it = sIncludeFiles.find(fileName);
-        if (it != sIncludeFiles.end()) {
-            ret->content = it->second.data();
-            ret->content_length = it->second.length();
-            return ret;
+        {
+            std::lock_guard locker(sIncludeFileMutex);
+            auto it = sIncludeFiles.find(fileName);
+            if (it != sIncludeFiles.end()) {
+                return makeResult(*it);
+            }
         }
 
+        // read outside the lock so parallel compiles don't wait on each other's io, if two threads
+        // load the same file the first insert wins
         String content = FileSystem::readAllText(fileName);
-        if (!content.empty()) {
-            ret->content = content.data();
-            ret->content_length = content.length();
-            sIncludeFiles.emplace(fileName, std::move(content));
-            return ret;
+        if (content.empty()) {
+            return nullptr;
         }
-        return nullptr;
+
+        std::lock_guard locker(sIncludeFileMutex);
+        auto it = sIncludeFiles.emplace(std::move(fileName), std::move(content)).first;
+        return makeResult(*it);
     }
 
     // Handles shaderc_include_result_release_fn callbacks.
@@ -68,6 +95,18 @@ public:
     {
         delete data;
     }
+
+private:
+    // entries are never erased or modified, the result can point into the map
+    static shaderc_include_result* makeResult(const std::pair<const String, String>& entry)
+    {
+        shaderc_include_result* ret = new shaderc_include_result();
+        ret->source_name = entry.first.c_str();
+        ret->source_name_length = entry.first.length();
+        ret->content = entry.second.data();
+        ret->content_length = entry.second.length();
+        return ret;
+    }
 };
 
 static shaderc_shader_kind getShadercKind(ShaderStage stage)
@@ -92,6 +131,94 @@ static shaderc_shader_kind getShadercKind(ShaderStage stage)
     }
 }
 
+static size_t getSpirvCacheKey(ShaderSourceType sourceType, shaderc_shader_kind kind, const char* pShaderEntryPoint, const DefineList* pDefines, const char* pSource, size_t sourceSize)
+{
+    auto hashBytes = [](size_t hash, const void* data, size_t size) {
+        return utils::fnv1a(hash, (const unsigned char*)data, size);
+    };
+
+    size_t hash = utils::_FNV_offset_basis;
+    hash = hashBytes(hash, &SPIRV_CACHE_VERSION, sizeof(SPIRV_CACHE_VERSION));
+    hash = hashBytes(hash, &sourceType, sizeof(sourceType));
+    hash = hashBytes(hash, &kind, sizeof(kind));
+    hash = hashBytes(hash, pShaderEntryPoint, strlen(pShaderEntryPoint) + 1);
+    if (pDefines) {
+        for (const auto& macro : *pDefines) {
+            hash = hashBytes(hash, macro.first.c_str(), macro.first.size() + 1);
+            hash = hashBytes(hash, macro.second.c_str(), macro.second.size() + 1);
+        }
+    }
+    return hashBytes(hash, pSource, sourceSize);
+}
+
+static Path getSpirvCachePath(const Path& cacheDir, size_t key)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.spv", (unsigned long long)key);
+    return cacheDir / name;
+}
+
+// the disk is accessed outside the lock, concurrent compiles only serialize on the map
+static bool loadCachedSpirv(size_t key, ByteArray& outSpvData)
+{
+    Path cacheDir;
+    {
+        std::lock_guard locker(sSpirvCacheMutex);
+        auto it = sSpirvCache.find(key);
+        if (it != sSpirvCache.end()) {
+            outSpvData = it->second;
+            return true;
+        }
+        cacheDir = sCacheDir;
+    }
+
+    if (cacheDir.empty()) {
+        return false;
+    }
+
+    std::ifstream is(getSpirvCachePath(cacheDir, key), std::ios::binary | std::ios::in | std::ios::ate);
+    if (!is.is_open()) {
+        return false;
+    }
+
+    // a truncated or foreign file is a miss, the compile result replaces it
+    size_t size = is.tellg();
+    if (size < 5 * sizeof(uint32_t) || size % sizeof(uint32_t) != 0) {
+        return false;
+    }
+
+    outSpvData.resize(size);
+    is.seekg(0, std::ios::beg);
+    is.read((char*)outSpvData.data(), size);
+
+    uint32_t magic = 0;
+    memcpy(&magic, outSpvData.data(), sizeof(magic));
+    if (!is || magic != SPIRV_MAGIC) {
+        outSpvData.clear();
+        return false;
+    }
+
+    std::lock_guard locker(sSpirvCacheMutex);
+    sSpirvCache.emplace(key, outSpvData);
+    return true;
+}
+
+static void storeCachedSpirv(size_t key, const ByteArray& spvData)
+{
+    Path cacheDir;
+    {
+        std::lock_guard locker(sSpirvCacheMutex);
+        sSpirvCache.emplace(key, spvData);
+        cacheDir = sCacheDir;
+    }
+
+    if (cacheDir.empty()) {
+        return;
+    }
+
+    utils::FileUtils::writeAtomic(getSpirvCachePath(cacheDir, key), spvData.data(), spvData.size());
+}
+
 bool compileShaderC(ShaderSourceType sourceType, const ShaderStage shader_type, const String& shaderName, const String& shaderCode, const char* pShaderEntryPoint, const char* shaderCompilerParams, const DefineList* pDefines, ByteArray& outSpvData)
 {
     shaderc::CompileOptions options;
@@ -131,7 +258,8 @@ bool compileShaderC(ShaderSourceType sourceType, const ShaderStage shader_type,
     // }
 
     shaderc_shader_kind kind = getShadercKind(shader_type);
-    shaderc::Compiler compiler;
+    // one per thread, batch compiles run on several workers at once
+    thread_local shaderc::Compiler compiler;
 
     try {
         auto res = compiler.PreprocessGlsl(shaderCode, kind, shaderName.c_str(), options);
@@ -141,6 +269,12 @@ bool compileShaderC(ShaderSourceType sourceType, const ShaderStage shader_type,
             return false;
         }
 
+        // the preprocessed source already holds every include and define
+        size_t cacheKey = getSpirvCacheKey(sourceType, kind, pShaderEntryPoint, pDefines, res.begin(), res.cend() - res.begin());
+        if (loadCachedSpirv(cacheKey, outSpvData)) {
+            return true;
+        }
+
         shaderc::SpvCompilationResult result = compiler.CompileGlslToSpv(res.begin(), res.cend() - res.begin(), kind, shaderName.c_str(), pShaderEntryPoint, options);
         if (result.GetCompilationStatus() != shaderc_compilation_status_success) {
             auto error = result.GetErrorMessage();
@@ -150,6 +284,8 @@ bool compileShaderC(ShaderSourceType sourceType, const ShaderStage shader_type,
 
         outSpvData.resize((char*)result.end() - (char*)result.begin());
         memcpy(outSpvData.data(), result.begin(), outSpvData.size());
+
+        storeCachedSpirv(cacheKey, outSpvData);
     } catch (std::exception& e) {
         LOG_ERROR(e.what());
         return false;
@@ -271,4 +407,50 @@ Ref<HwShaderModule> ShaderCompiler::compileFromFile(ShaderStage shader_type, con
     return nullptr;
 }
 
-}
\ No newline at end of file
+Vector<std::future<Ref<HwShaderModule>>> ShaderCompiler::compileBatch(const Vector<ShaderCompileDesc>& descs)
+{
+    Vector<std::future<Ref<HwShaderModule>>> futures;
+    futures.reserve(descs.size());
+
+    for (auto& desc : descs) {
+        auto promise = std::make_shared<std::promise<Ref<HwShaderModule>>>();
+        futures.push_back(promise->get_future());
+
+        getCompileJobs().submit([desc, promise]() {
+            promise->set_value(compileFromString(desc.sourceType, desc.stage, desc.name, desc.source, desc.entryPoint.c_str(), desc.extraParams.c_str(), &desc.defines));
+        });
+    }
+
+    return futures;
+}
+
+void ShaderCompiler::compileBatch(const Vector<ShaderCompileDesc>& descs, std::function<void(Vector<Ref<HwShaderModule>>&)> onComplete)
+{
+    struct Batch {
+        Vector<Ref<HwShaderModule>> modules;
+        std::atomic<uint32_t> remaining;
+        std::function<void(Vector<Ref<HwShaderModule>>&)> onComplete;
+    };
+
+    if (descs.empty()) {
+        Vector<Ref<HwShaderModule>> modules;
+        onComplete(modules);
+        return;
+    }
+
+    auto batch = std::make_shared<Batch>();
+    batch->modules.resize(descs.size());
+    batch->remaining = (uint32_t)descs.size();
+    batch->onComplete = std::move(onComplete);
+
+    for (uint32_t i = 0; i < descs.size(); i++) {
+        getCompileJobs().submit([desc = descs[i], batch, i]() {
+            batch->modules[i] = compileFromString(desc.sourceType, desc.stage, desc.name, desc.source, desc.entryPoint.c_str(), desc.extraParams.c_str(), &desc.defines);
+            if (--batch->remaining == 0) {
+                batch->onComplete(batch->modules);
+            }
+        });
+    }
+}
+
+}
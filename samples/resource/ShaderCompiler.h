@@ -1,16 +1,40 @@
 #pragma once
 #include "ShaderResourceInfo.h"
 #include "../FileSystem.h"
+#include <functional>
+#include <future>
 
 namespace mygfx {
 
+struct ShaderCompileDesc {
+    ShaderSourceType sourceType = ShaderSourceType::GLSL;
+    ShaderStage stage = ShaderStage::VERTEX;
+    String name;
+    String source;
+    String entryPoint;
+    String extraParams;
+    DefineList defines;
+};
+
 class ShaderCompiler {
 public:
     void init();
     
     static bool getShaderFilePath(const String& fileName, Path& outPath);
 
+    // Compiled SPIR-V is always cached in memory for the process lifetime, keyed on the
+    // preprocessed source, defines, stage, entry point and compiler options. With a cache dir it is
+    // also written there, one file per key, and reused by later runs. Empty disables the disk cache.
+    static void setCacheDir(const Path& dir);
+
     static Ref<HwShaderModule> compileFromString(ShaderSourceType sourceType, ShaderStage shader_type, const String& shaderName, const String& pShaderCode, const char* pShaderEntryPoint, const char* pExtraParams, const DefineList* pDefines);
+
+    // Compiles every desc on the compiler's worker threads, each with its own shaderc::Compiler.
+    // Futures hold nullptr for descs that fail to compile.
+    static Vector<std::future<Ref<HwShaderModule>>> compileBatch(const Vector<ShaderCompileDesc>& descs);
+    // Same, but calls onComplete once with the modules in desc order, on the worker that finished last.
+    static void compileBatch(const Vector<ShaderCompileDesc>& descs, std::function<void(Vector<Ref<HwShaderModule>>&)> onComplete);
+
     static Ref<HwShaderModule> compileFromFile(ShaderStage shader_type, const char* pFilename, const char* pShaderEntryPoint, const char* pExtraParams, const DefineList* pDefines);
 };
 
@@ -1,26 +1,33 @@
 #include "DynamicBufferPool.h"
 #include "GraphicsDevice.h"
+#include "utils/Log.h"
 #include "utils/algorithm.h"
 
 namespace mygfx {
-void DynamicBufferPool::create(BufferUsage usage, uint32_t numberOfBackBuffers, uint32_t memTotalSize, const char* name)
+void DynamicBufferPool::create(BufferUsage usage, uint32_t numberOfBackBuffers, uint32_t memTotalSize, const char* name, bool growable)
 {
-    mDynamicMemSize = utils::alignUp(memTotalSize, 256u);
-    mRing.OnCreate(numberOfBackBuffers, mDynamicMemSize);
-    mBuffer = device().createBuffer(usage, MemoryUsage::CPU_TO_GPU, mDynamicMemSize + mStaticMemSize, 0, nullptr);
-    mData = (char*)mBuffer->mapped;
+    create(usage, 0, numberOfBackBuffers, memTotalSize, name, growable);
 }
 
-void DynamicBufferPool::create(BufferUsage usage, uint32_t staticBufferSize, uint32_t numberOfBackBuffers, uint32_t memTotalSize, const char* name)
+void DynamicBufferPool::create(BufferUsage usage, uint32_t staticBufferSize, uint32_t numberOfBackBuffers, uint32_t memTotalSize, const char* name, bool growable)
 {
+    mUsage = usage;
+    mName = name ? name : "";
+    mGrowable = growable;
+    mNumberOfBackBuffers = numberOfBackBuffers;
+    mStaticMemSize = utils::alignUp(staticBufferSize, 256u);
+    mStaticOffset = 0;
     mDynamicMemSize = utils::alignUp(memTotalSize, 256u);
     mRing.OnCreate(numberOfBackBuffers, mDynamicMemSize);
     mBuffer = device().createBuffer(usage, MemoryUsage::CPU_TO_GPU, mDynamicMemSize + mStaticMemSize, 0, nullptr);
     mData = (char*)mBuffer->mapped;
+    mFrame = 0;
+    mStats = {};
 }
 
 void DynamicBufferPool::destroy()
 {
+    mChainedBuffers.clear();
     mBuffer.reset();
     mRing.destroy();
 }
@@ -30,19 +37,80 @@ bool DynamicBufferPool::allocBuffer(uint32_t size, void** pData, BufferInfo* pOu
     size = utils::alignUp(size, 256u);
 
     uint32_t memOffset;
-    if (mRing.Alloc(size, &memOffset) == false) {
-        assert("Ran out of mem for 'dynamic' buffers, please increase the allocated size");
+    if (mRing.Alloc(size, &memOffset)) {
+        memOffset += mStaticMemSize;
+
+        *pData = (void*)(mData + memOffset);
+
+        pOut->buffer = mBuffer;
+        pOut->offset = memOffset;
+        pOut->range = size;
+    } else if (!mGrowable || !allocChained(size, pData, pOut)) {
+        if (mStats.failedCount++ == 0) {
+            LOG_ERROR("DynamicBufferPool {}: out of memory allocating {} bytes, please increase the allocated size", mName, size);
+        }
         return false;
     }
 
-    memOffset += mStaticMemSize;
+    mStats.frameSize += size;
+    mStats.highWaterMark = std::max(mStats.highWaterMark, mStats.frameSize);
+    return true;
+}
+
+bool DynamicBufferPool::allocChained(uint32_t size, void** pData, BufferInfo* pOut)
+{
+    ChainedBuffer* chained = nullptr;
+    uint32_t memOffset = 0;
+    for (auto& it : mChainedBuffers) {
+        if (it.ring.Alloc(size, &memOffset)) {
+            chained = &it;
+            break;
+        }
+    }
+
+    if (chained == nullptr) {
+        uint32_t chainedSize = std::max(size, mDynamicMemSize);
+        Ref<HwBuffer> buffer = device().createBuffer(mUsage, MemoryUsage::CPU_TO_GPU, chainedSize, 0, nullptr);
+        if (buffer == nullptr || buffer->mapped == nullptr) {
+            return false;
+        }
 
-    *pData = (void*)(mData + memOffset);
+        chained = &mChainedBuffers.emplace_back();
+        chained->buffer = buffer;
+        chained->data = (char*)buffer->mapped;
+        chained->size = chainedSize;
+        chained->ring.OnCreate(mNumberOfBackBuffers, chainedSize);
+        chained->ring.Alloc(size, &memOffset);
+        mStats.maxChainedBufferCount = std::max(mStats.maxChainedBufferCount, (uint32_t)mChainedBuffers.size());
+        LOG_WARNING("DynamicBufferPool {}: ring is full, chained a buffer of {} bytes", mName, chainedSize);
+    }
 
-    pOut->buffer = mBuffer;
+    *pData = (void*)(chained->data + memOffset);
+
+    pOut->buffer = chained->buffer;
     pOut->offset = memOffset;
     pOut->range = size;
 
+    chained->lastFrame = mFrame;
+    return true;
+}
+
+bool DynamicBufferPool::allocStaticBuffer(uint32_t size, void** pData, BufferInfo* pOut)
+{
+    size = utils::alignUp(size, 256u);
+
+    if (mStaticOffset + size > mStaticMemSize) {
+        LOG_ERROR("DynamicBufferPool {}: out of static memory allocating {} bytes", mName, size);
+        return false;
+    }
+
+    *pData = (void*)(mData + mStaticOffset);
+
+    pOut->buffer = mBuffer;
+    pOut->offset = mStaticOffset;
+    pOut->range = size;
+
+    mStaticOffset += size;
     return true;
 }
 
@@ -70,6 +138,31 @@ bool DynamicBufferPool::allocIndexBuffer(uint32_t numbeOfIndices, uint32_t strid
 void DynamicBufferPool::onFrameChange()
 {
     mRing.OnBeginFrame();
+    mFrame++;
+    mStats.frameSize = 0;
+
+    for (auto it = mChainedBuffers.begin(); it != mChainedBuffers.end();) {
+        uint64_t quietFrames = mFrame - it->lastFrame;
+        if (quietFrames >= mNumberOfBackBuffers + MAX_QUIET_FRAMES) {
+            it = mChainedBuffers.erase(it);
+            continue;
+        }
+
+        it->ring.OnBeginFrame();
+        ++it;
+    }
+}
+
+DynamicBufferPool::Stats DynamicBufferPool::getStats() const
+{
+    Stats stats = mStats;
+    stats.chainedBufferCount = (uint32_t)mChainedBuffers.size();
+    stats.chainedSize = 0;
+    for (auto& it : mChainedBuffers) {
+        stats.chainedSize += it.size;
+    }
+    stats.staticSize = mStaticOffset;
+    return stats;
 }
 
 }
@@ -3,6 +3,7 @@
 #include "GraphicsDefs.h"
 #include "GraphicsHandles.h"
 #include "utils/Ring.h"
+#include <vector>
 
 namespace mygfx {
 // This class mimics the behaviour or the DX11 dynamic buffers. I can hold uniforms, index and vertex buffers.
@@ -18,26 +19,71 @@ namespace mygfx {
 //
 // Note than in this ring an allocated chuck of memory has to be contiguous in memory, that is it cannot spawn accross the tail and the head.
 // This class takes care of that.
+//
+// When the ring is full a growable pool chains extra buffers, each used as a ring of its own, so memory
+// of retired frames is reused even when the pool overflows every frame. A chained buffer is released
+// after MAX_QUIET_FRAMES frames without allocations. Pools whose allocations are addressed by their offset in getBuffer() (the uniform
+// ring, bound as one dynamic buffer) can't grow, their allocations fail instead.
+//
+// The static region in front of the ring is never recycled, see allocStaticBuffer.
 
 class DynamicBufferPool : public FrameChangeListener {
 public:
-    void create(BufferUsage usage, uint32_t numberOfBackBuffers, uint32_t memTotalSize, const char* name = NULL);
-    void create(BufferUsage usage, uint32_t staticBufferSize, uint32_t numberOfBackBuffers, uint32_t memTotalSize, const char* name = NULL);
+    static constexpr uint32_t MAX_QUIET_FRAMES = 8;
+
+    struct Stats {
+        // bytes allocated in the current frame, ring and chained buffers
+        uint32_t frameSize = 0;
+        // most bytes allocated in one frame
+        uint32_t highWaterMark = 0;
+        uint32_t chainedBufferCount = 0;
+        uint64_t chainedSize = 0;
+        uint32_t maxChainedBufferCount = 0;
+        uint32_t staticSize = 0;
+        uint32_t failedCount = 0;
+    };
+
+    void create(BufferUsage usage, uint32_t numberOfBackBuffers, uint32_t memTotalSize, const char* name = NULL, bool growable = true);
+    void create(BufferUsage usage, uint32_t staticBufferSize, uint32_t numberOfBackBuffers, uint32_t memTotalSize, const char* name = NULL, bool growable = true);
     void destroy();
     bool allocBuffer(uint32_t size, void** pData, BufferInfo* pOut);
     BufferInfo allocBuffer(uint32_t size, void* pData);
     bool allocVertexBuffer(uint32_t numbeOfVertices, uint32_t strideInBytes, void** pData, BufferInfo* pOut);
     bool allocIndexBuffer(uint32_t numbeOfIndices, uint32_t strideInBytes, void** pData, BufferInfo* pOut);
+    // lives until destroy
+    bool allocStaticBuffer(uint32_t size, void** pData, BufferInfo* pOut);
 
     void onFrameChange() override;
 
     inline HwBuffer* getBuffer() const { return mBuffer; }
 
+    Stats getStats() const;
+    void resetHighWaterMark() { mStats.highWaterMark = mStats.frameSize; }
+
 private:
+    struct ChainedBuffer {
+        SharedPtr<HwBuffer> buffer;
+        char* data = nullptr;
+        uint32_t size = 0;
+        RingWithTabs ring;
+        // last frame allocating from it
+        uint64_t lastFrame = 0;
+    };
+
+    bool allocChained(uint32_t size, void** pData, BufferInfo* pOut);
+
+    BufferUsage mUsage = BufferUsage::NONE;
+    String mName;
+    bool mGrowable = true;
+    uint32_t mNumberOfBackBuffers = 0;
     uint32_t mDynamicMemSize = 0;
     uint32_t mStaticMemSize = 0;
+    uint32_t mStaticOffset = 0;
     RingWithTabs mRing;
     char* mData = nullptr;
     SharedPtr<HwBuffer> mBuffer;
+    std::vector<ChainedBuffer> mChainedBuffers;
+    uint64_t mFrame = 0;
+    Stats mStats;
 };
 }
\ No newline at end of file
@@ -28,9 +28,18 @@ const char* GraphicsApi::getDeviceName() const
     return mDriver.getDeviceName();
 }
 
+size_t GraphicsApi::getCommandSize() const
+{
+    auto& circularBuffer = mCommandBufferQueue.getCircularBuffer();
+    return uintptr_t(circularBuffer.getHead()) - uintptr_t(circularBuffer.getTail());
+}
+
 void GraphicsApi::flush()
 {
     auto& gfx = mDriver;
+#if MYGFX_COMMAND_COUNT
+    mCommandCount = 0;
+#endif
     if (gfx.singleLoop()) {
         gfx.swapContext();
     } else {
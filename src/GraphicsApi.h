@@ -14,6 +14,13 @@ public:
 
     const char* getDeviceName() const;
 
+    // bytes recorded into the command stream since the last flush()
+    size_t getCommandSize() const;
+#if MYGFX_COMMAND_COUNT
+    // asynchronous commands recorded into the command stream since the last flush()
+    size_t getCommandCount() const { return mCommandCount; }
+#endif
+
     template <typename T>
     uint32_t allocConstant(const T& data)
     {
@@ -12,4 +12,6 @@ static constexpr uint32_t MAX_BACKBUFFER_COUNT = 3;
 static constexpr bool INVERTED_DEPTH = true;
 static constexpr bool LINEAR_COLOR_OUTPUT = true;
 static constexpr uint32_t INVALID_UNIFORM_OFFSET = 0xffffffff;
+// storage buffer block bound to the whole uniform ring, instanced shaders read their instance table from it
+static constexpr const char* INSTANCE_DATA_NAME = "InstanceData";
 }
\ No newline at end of file
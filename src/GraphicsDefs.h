@@ -3,8 +3,9 @@
 #include "GraphicsConsts.h"
 #include "GraphicsFwd.h"
 #include "utils/BitmaskEnum.h"
-#include <stdint.h>
+#include <bit>
 #include <map>
+#include <stdint.h>
 
 namespace mygfx {
 
@@ -264,6 +265,40 @@ enum class ShaderStage : uint32_t {
     MESH = 0x00000080,
 };
 
+// Value of a specialization constant (constant_id) for the program stages in stageFlags.
+// Int, uint, float and bool constants are all 32 bits wide; value holds the raw bits.
+struct SpecializationValue {
+    uint32_t id = 0;
+    uint32_t value = 0;
+    ShaderStage stageFlags = ShaderStage::ALL;
+
+    SpecializationValue() = default;
+    SpecializationValue(uint32_t id, int32_t v, ShaderStage stages = ShaderStage::ALL)
+        : id(id)
+        , value((uint32_t)v)
+        , stageFlags(stages)
+    {
+    }
+    SpecializationValue(uint32_t id, uint32_t v, ShaderStage stages = ShaderStage::ALL)
+        : id(id)
+        , value(v)
+        , stageFlags(stages)
+    {
+    }
+    SpecializationValue(uint32_t id, float v, ShaderStage stages = ShaderStage::ALL)
+        : id(id)
+        , value(std::bit_cast<uint32_t>(v))
+        , stageFlags(stages)
+    {
+    }
+    SpecializationValue(uint32_t id, bool v, ShaderStage stages = ShaderStage::ALL)
+        : id(id)
+        , value(v ? 1 : 0)
+        , stageFlags(stages)
+    {
+    }
+};
+
 enum class ShaderSourceType : uint8_t {
     GLSL,
     HLSL,
@@ -384,6 +419,12 @@ struct SamplerInfo {
     {
         return std::memcmp(this, &other, sizeof(SamplerInfo)) == 0;
     }
+
+    // all fields packed in one word, usable as a hash key
+    uint32_t key() const
+    {
+        return std::bit_cast<uint32_t>(*this);
+    }
 };
 
 static_assert(sizeof(SamplerInfo) == 4);
@@ -2,6 +2,9 @@
 #include "FrameListener.h"
 #include "api/Dispatcher.h"
 #include "utils/Log.h"
+#include "utils/algorithm.h"
+#include <algorithm>
+#include <cstring>
 
 namespace mygfx {
 
@@ -42,6 +45,11 @@ void GraphicsDevice::beginRender()
 {
     mainSemWait();
     mLastRenderTime = Clock::now();
+    executePostCommands();
+}
+
+void GraphicsDevice::executePostCommands()
+{
     std::function<void()> fn;
     while (mPostCommands.try_dequeue(fn)) {
         fn();
@@ -101,6 +109,153 @@ void HwRenderQueue::clear()
     mRenderables[gInstance->workContext()].clear();
 }
 
+uint64_t HwRenderQueue::makeSortKey(const RenderCommand& rc)
+{
+    auto& state = rc.pipelineState;
+    size_t programHash = std::hash<const void*> {}(state.program);
+    programHash ^= programHash >> 32;
+    programHash ^= programHash >> 16;
+
+    size_t stateHash = utils::fnv1a(utils::_FNV_offset_basis, (const unsigned char*)&state.primitiveState,
+        sizeof(PipelineState) - offsetof(PipelineState, primitiveState));
+    stateHash ^= stateHash >> 32;
+    stateHash ^= stateHash >> 16;
+
+    // positive floats order like their bit patterns
+    uint32_t depthBits = 0;
+    if (rc.depth > 0.0f) {
+        std::memcpy(&depthBits, &rc.depth, sizeof(depthBits));
+    }
+
+    return (uint64_t)(programHash & 0xfff) << 52
+        | (uint64_t)(stateHash & 0xfff) << 40
+        | (uint64_t)rc.material << 24
+        | (depthBits >> 8);
+}
+
+void HwRenderQueue::sort()
+{
+    auto& commands = getWriteCommands();
+    uint32_t count = (uint32_t)commands.size();
+    if (count < 2) {
+        return;
+    }
+
+    mSortItems.resize(count);
+    for (uint32_t i = 0; i < count; i++) {
+        mSortItems[i] = { makeSortKey(commands[i]), i };
+    }
+
+    if (count < 256) {
+        std::stable_sort(mSortItems.begin(), mSortItems.end(), [](const SortItem& lhs, const SortItem& rhs) {
+            return lhs.key < rhs.key;
+        });
+    } else {
+        // lsd radix sort, one byte per pass, passes where every key has the same byte are skipped
+        mSortTemp.resize(count);
+        uint32_t histograms[8][256] = {};
+        for (auto& item : mSortItems) {
+            for (uint32_t pass = 0; pass < 8; pass++) {
+                histograms[pass][(item.key >> (pass * 8)) & 0xff]++;
+            }
+        }
+
+        for (uint32_t pass = 0; pass < 8; pass++) {
+            uint32_t* histogram = histograms[pass];
+            uint32_t shift = pass * 8;
+            if (histogram[(mSortItems[0].key >> shift) & 0xff] == count) {
+                continue;
+            }
+
+            uint32_t offset = 0;
+            for (uint32_t i = 0; i < 256; i++) {
+                uint32_t n = histogram[i];
+                histogram[i] = offset;
+                offset += n;
+            }
+
+            for (auto& item : mSortItems) {
+                mSortTemp[histogram[(item.key >> shift) & 0xff]++] = item;
+            }
+
+            std::swap(mSortItems, mSortTemp);
+        }
+    }
+
+    mSorted.clear();
+    mSorted.reserve(count);
+    for (auto& item : mSortItems) {
+        mSorted.push_back(std::move(commands[item.index]));
+    }
+
+    std::swap(commands, mSorted);
+}
+
+static bool canMergeInstance(const RenderCommand& first, const RenderCommand& rc)
+{
+    return rc.renderPrimitive == first.renderPrimitive
+        && rc.indirectBuffer == nullptr
+        && rc.instanceCount == 1
+        && std::memcmp(&rc.pipelineState, &first.pipelineState, sizeof(PipelineState)) == 0
+        && rc.uniforms.size() == first.uniforms.size()
+        && std::memcmp(rc.uniforms.data(), first.uniforms.data(), rc.uniforms.size() * sizeof(uint32_t)) == 0;
+}
+
+void HwRenderQueue::mergeInstances()
+{
+    // one uvec4 per instance
+    const uint32_t recordSize = Uniforms::MAX_COUNT * sizeof(uint32_t);
+
+    auto& commands = getWriteCommands();
+    uint32_t count = (uint32_t)commands.size();
+    uint32_t writeIndex = 0;
+
+    for (uint32_t i = 0; i < count;) {
+        if (!commands[i].pipelineState.primitiveState.instancing || commands[i].indirectBuffer != nullptr) {
+            if (writeIndex != i) {
+                commands[writeIndex] = std::move(commands[i]);
+            }
+            writeIndex++;
+            i++;
+            continue;
+        }
+
+        uint32_t end = i + 1;
+        while (end < count && canMergeInstance(commands[i], commands[end])) {
+            end++;
+        }
+
+        uint32_t instanceCount = end - i;
+        void* pData;
+        BufferInfo bufferInfo;
+        if (!gInstance->allocConstantBuffer(instanceCount * recordSize, &pData, &bufferInfo)) {
+            // out of ring memory, the run can't be drawn without its table
+            i = end;
+            continue;
+        }
+
+        uint32_t* record = (uint32_t*)pData;
+        for (uint32_t j = i; j < end; j++) {
+            auto& instanceData = commands[j].instanceData;
+            for (uint32_t k = 0; k < Uniforms::MAX_COUNT; k++) {
+                record[k] = k < instanceData.size() ? instanceData.data()[k] : 0;
+            }
+            record += Uniforms::MAX_COUNT;
+        }
+
+        if (writeIndex != i) {
+            commands[writeIndex] = std::move(commands[i]);
+        }
+
+        auto& merged = commands[writeIndex++];
+        merged.instanceCount = instanceCount;
+        merged.firstInstance = (uint32_t)(bufferInfo.offset / recordSize);
+        i = end;
+    }
+
+    commands.erase(commands.begin() + writeIndex, commands.end());
+}
+
 uint32_t Stats::getDrawCall()
 {
     return sDrawCall[gInstance->workContext()];
@@ -12,6 +12,14 @@ namespace mygfx {
 struct Settings {
     const char* name;
     bool validation = false;
+    // worker threads used for parallel recording, 0 = one per core
+    uint32_t workerThreadCount = 0;
+    // drawBatch records on the workers above this many render commands
+    uint32_t multiThreadedDrawThreshold = 200;
+    // pipeline cache file, loaded at create and written back at destroy, nullptr disables it
+    const char* pipelineCachePath = nullptr;
+    // directory for shader reflection data, usually the one the SPIR-V cache lives in, nullptr disables it
+    const char* shaderCachePath = nullptr;
 };
 
 struct PipelineState;
@@ -112,6 +120,8 @@ public:
     // render thread:
     void beginRender();
     void endRender();
+    // runs the calls queued by post_async, beginRender does it every frame
+    void executePostCommands();
 
     void post(const std::function<void()>& fn, int delay = 2);
     void post_async(const std::function<void()>& fn);
@@ -131,7 +141,13 @@ struct RenderCommand {
     PipelineState pipelineState;
     HwBuffer* indirectBuffer = nullptr;
     uint32_t instanceCount = 1;
+    uint32_t firstInstance = 0;
     Uniforms uniforms;
+    // per instance uniform offsets, only read when pipelineState.primitiveState.instancing is set
+    Uniforms instanceData;
+    // sort inputs, see HwRenderQueue::sort
+    uint16_t material = 0;
+    float depth = 0.0f;
 };
 
 class HwRenderQueue : public HwObject {
@@ -140,8 +156,35 @@ public:
     const std::vector<RenderCommand>& getReadCommands() const;
     void clear();
 
+    // Reorders the write commands by makeSortKey, so consecutive draws share their program and
+    // pipeline state and the backend can skip the redundant binds. Optional, call after filling the
+    // queue and before drawBatch. Commands with equal keys keep their order.
+    void sort();
+
+    // program | pipeline state | material | depth, from the most to the least significant bits.
+    // Program and state are 12 bit hashes, material is truncated to 16 bits and depth (front to
+    // back, negative clamped to 0) keeps the top 24 bits of its float.
+    static uint64_t makeSortKey(const RenderCommand& rc);
+
+    // Merges each run of write commands whose pipeline state enables instancing and that share the
+    // render primitive, pipeline state and uniforms into one instanced draw. The instanceData of every
+    // command in the run is written to the uniform ring as a uvec4 record, and firstInstance points
+    // the draw at the first one, so the shader reads its record at gl_InstanceIndex from the
+    // INSTANCE_DATA_NAME block (vec4/uvec4 units). Runs of one are written too, instancing states
+    // always draw through the table. Call after sort and before drawBatch.
+    void mergeInstances();
+
 private:
+    struct SortItem {
+        uint64_t key;
+        uint32_t index;
+    };
+
     std::vector<RenderCommand> mRenderables[2];
+    // scratch for sort
+    std::vector<SortItem> mSortItems;
+    std::vector<SortItem> mSortTemp;
+    std::vector<RenderCommand> mSorted;
 };
 
 struct Stats {
@@ -53,4 +53,5 @@ class HwShaderModule;
 class HwProgram;
 class HwDescriptorSet;
 class HwRenderPrimitive;
+struct PipelineState;
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "GraphicsHandles.h"
 #include "GraphicsDevice.h"
+#include "utils/algorithm.h"
 #include <deque>
 #include <mutex>
 #ifdef _MSC_VER
@@ -203,4 +204,13 @@ DefineList& DefineList::operator+=(const DefineList& def2)
     return *this;
 }
 
+uint64_t HwVertexInput::makeContentId(const FormatList& fmts, const FormatList& fmts1)
+{
+    // the count keeps ({a}, {b}) apart from ({a, b}, {})
+    uint32_t count = (uint32_t)fmts.size();
+    size_t hash = utils::fnv1a(utils::_FNV_offset_basis, (const unsigned char*)&count, sizeof(count));
+    hash = utils::fnv1a(hash, (const unsigned char*)fmts.data(), fmts.size() * sizeof(Format));
+    return utils::fnv1a(hash, (const unsigned char*)fmts1.data(), fmts1.size() * sizeof(Format));
+}
+
 }
@@ -1,6 +1,7 @@
 #pragma once
 #include "GraphicsDefs.h"
 #include "utils/SharedPtr.h"
+#include <functional>
 #include <vector>
 
 #if defined(VK_USE_PLATFORM_METAL_EXT)
@@ -115,6 +116,10 @@ public:
 
 class HwVertexInput : public HwObject {
 public:
+    // Hash of the vertex and instance formats, same for equal inputs in every run.
+    uint64_t contentId = 0;
+
+    static uint64_t makeContentId(const FormatList& fmts, const FormatList& fmts1);
 };
 
 class HwDescriptorSet : public HwObject {
@@ -123,10 +128,25 @@ public:
 
 class HwProgram : public HwObject {
 public:
-    ShaderResourceInfo* getShaderResource(const String& name);
-    HwDescriptorSet* getDescriptorSet(uint32_t index);
-    HwDescriptorSet* createDescriptorSet(uint32_t index);
+    virtual ShaderResourceInfo* getShaderResource(const String& name) { return nullptr; }
+    virtual HwDescriptorSet* getDescriptorSet(uint32_t index) { return nullptr; }
+    virtual HwDescriptorSet* createDescriptorSet(uint32_t index) { return nullptr; }
+    // false while a pipeline variant of this program is compiling in the background
+    virtual bool isPipelineReady() const { return true; }
     Ref<HwVertexInput> vertexInput;
+
+    // Hash of the shader code, entry points and specialization values. Same for equivalent
+    // programs in every run, unlike the program's address; see PipelineKey.
+    uint64_t contentId = 0;
+
+    // Compile missing pipeline variants on the job system instead of inside the draw. Until a
+    // variant is ready its draws use fallbackState, or are skipped when there is none. Ignored by
+    // backends without pipeline variants, like Vulkan with shader objects, which never compile in a draw.
+    bool asyncCompile = false;
+    // Must share this program's pipeline layout, and outlive it.
+    const PipelineState* fallbackState = nullptr;
+    // Called on the render thread each time an async variant finishes compiling.
+    std::function<void(HwProgram*)> onPipelineReady;
 };
 
 struct RenderTargetDesc {
@@ -195,6 +215,15 @@ class VertexData : public RefCounted {
 public:
     std::vector<Ref<HwBuffer>> vertexBuffers;
     Ref<HwBuffer> indexBuffer;
+
+    // Set when the streams are packed into a shared buffer, one entry per vertex buffer. Otherwise
+    // each stream starts at its buffer's bufferOffset and is described by its stride and extra.
+    std::vector<uint64_t> vertexOffsets;
+    std::vector<VertexAttribute> vertexAttributes;
+    uint64_t indexOffset = 0;
+    IndexType indexType = IndexType::UINT32;
+    uint32_t vertexCount = 0;
+    uint32_t indexCount = 0;
 };
 
 class HwRenderPrimitive : public HwObject {
@@ -0,0 +1,112 @@
+#include "JobSystem.h"
+#include <algorithm>
+#include <atomic>
+
+namespace mygfx {
+
+JobSystem::JobSystem(uint32_t threadCount)
+{
+    if (threadCount == 0) {
+        threadCount = std::max(2u, std::thread::hardware_concurrency()) - 1;
+    }
+
+    mThreads.reserve(threadCount);
+    for (uint32_t i = 0; i < threadCount; i++) {
+        mThreads.emplace_back(&JobSystem::workerLoop, this, i);
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mExit = true;
+    }
+    mCondition.notify_all();
+
+    for (auto& t : mThreads) {
+        t.join();
+    }
+}
+
+void JobSystem::workerLoop(uint32_t workerIndex)
+{
+    while (true) {
+        std::function<void(uint32_t)> job;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mCondition.wait(lock, [this]() { return mExit || !mJobs.empty(); });
+            if (mJobs.empty()) {
+                return;
+            }
+
+            job = std::move(mJobs.front());
+            mJobs.pop_front();
+        }
+
+        job(workerIndex);
+    }
+}
+
+void JobSystem::submit(std::function<void()> fn)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mJobs.emplace_back([fn = std::move(fn)](uint32_t) { fn(); });
+    }
+    mCondition.notify_one();
+}
+
+void JobSystem::parallelFor(uint32_t jobCount, const ParallelJob& job)
+{
+    if (jobCount == 0) {
+        return;
+    }
+
+    // Helpers may start after every index has been taken (a long job queued by submit() ahead of
+    // them), so the state is shared and the caller only waits for finished jobs, not for helpers.
+    struct State {
+        std::atomic<uint32_t> next = 0;
+        uint32_t finished = 0;
+        std::mutex mutex;
+        std::condition_variable done;
+    };
+
+    auto state = std::make_shared<State>();
+    const ParallelJob* pJob = &job;
+
+    auto run = [state, pJob, jobCount](uint32_t workerIndex) {
+        uint32_t count = 0;
+        for (uint32_t i = state->next++; i < jobCount; i = state->next++) {
+            (*pJob)(i, workerIndex);
+            count++;
+        }
+
+        if (count > 0) {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->finished += count;
+            if (state->finished == jobCount) {
+                state->done.notify_one();
+            }
+        }
+    };
+
+    uint32_t helperCount = std::min(jobCount - 1, getThreadCount());
+    if (helperCount > 0) {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            // in front of submitted work, recording is waiting on these
+            for (uint32_t i = 0; i < helperCount; i++) {
+                mJobs.emplace_front(run);
+            }
+        }
+        mCondition.notify_all();
+    }
+
+    run(getThreadCount());
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->done.wait(lock, [&state, jobCount]() { return state->finished == jobCount; });
+}
+
+}
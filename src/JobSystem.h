@@ -0,0 +1,51 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mygfx {
+
+// Long lived worker threads the backend can hand work to.
+// Every worker has a fixed index in [0, getThreadCount()), so callers can keep per-worker
+// resources (command pools, scratch memory) without locking.
+class JobSystem {
+public:
+    using ParallelJob = std::function<void(uint32_t jobIndex, uint32_t workerIndex)>;
+
+    // threadCount == 0 uses one thread per core, minus the calling thread
+    explicit JobSystem(uint32_t threadCount = 0);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    uint32_t getThreadCount() const { return (uint32_t)mThreads.size(); }
+
+    // Number of distinct workerIndex values parallelFor can pass: the workers plus the caller.
+    uint32_t getWorkerCount() const { return getThreadCount() + 1; }
+
+    // Runs job for every index in [0, jobCount) and returns once all of them are done.
+    // The calling thread takes part with workerIndex == getThreadCount(). Runs ahead of work queued
+    // with submit().
+    void parallelFor(uint32_t jobCount, const ParallelJob& job);
+
+    // Queues fn on a worker and returns immediately. Meant for long running background work such as
+    // pipeline compiles.
+    void submit(std::function<void()> fn);
+
+private:
+    void workerLoop(uint32_t workerIndex);
+
+    std::vector<std::thread> mThreads;
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::deque<std::function<void(uint32_t)>> mJobs;
+    bool mExit = false;
+};
+
+}
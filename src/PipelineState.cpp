@@ -1,4 +1,7 @@
 #include "PipelineState.h"
+#include "GraphicsHandles.h"
+#include "utils/algorithm.h"
+#include <cstring>
 
 namespace mygfx {
 
@@ -115,4 +118,89 @@ ColorBlendState ColorBlendState::get(BlendMode blendMode)
     };
     return blendState;
 }
-}
\ No newline at end of file
+
+// Fields are packed one by one rather than copied, bit-field layout and padding are up to the
+// compiler and must not leak into the key.
+PipelineKey::PipelineKey(const PipelineState& state)
+{
+    auto push = [this](uint32_t word) {
+        assert(mSize < MAX_WORDS);
+        mWords[mSize++] = word;
+    };
+
+    auto pushId = [&push](uint64_t id) {
+        push((uint32_t)id);
+        push((uint32_t)(id >> 32));
+    };
+
+    HwProgram* program = state.program;
+    pushId(program ? program->contentId : 0);
+    pushId(program && program->vertexInput ? program->vertexInput->contentId : 0);
+
+    auto& prim = state.primitiveState;
+    auto& depth = state.depthState;
+    auto& raster = state.rasterState;
+    push((uint32_t)prim.primitiveTopology
+        | (uint32_t)prim.restartEnable << 4
+        | (uint32_t)prim.instancing << 5
+        | (uint32_t)depth.depthTestEnable << 6
+        | (uint32_t)depth.depthWriteEnable << 7
+        | (uint32_t)depth.depthCompareOp << 8
+        | (uint32_t)depth.depthBoundsTestEnable << 12
+        | (uint32_t)raster.polygonMode << 13
+        | (uint32_t)raster.cullMode << 15
+        | (uint32_t)raster.frontFace << 17
+        | (uint32_t)raster.depthBiasEnable << 18
+        | (uint32_t)raster.alphaToCoverageEnable << 19
+        | (uint32_t)raster.alphaToOneEnable << 20
+        | (uint32_t)raster.rasterizerDiscardEnable << 21
+        | (uint32_t)raster.rasterizationSamples << 22);
+
+    auto& blend = state.colorBlendState;
+    push((uint32_t)blend.colorBlendOp
+        | (uint32_t)blend.alphaBlendOp << 3
+        | (uint32_t)blend.srcColorBlendFactor << 6
+        | (uint32_t)blend.dstColorBlendFactor << 11
+        | (uint32_t)blend.srcAlphaBlendFactor << 16
+        | (uint32_t)blend.dstAlphaBlendFactor << 21
+        | (uint32_t)blend.colorWrite << 26
+        | (uint32_t)blend.colorBlendEnable << 30);
+
+    if (auto advanced = state.advanceState) {
+        auto& stencil = advanced->stencilState;
+        push(1u
+            | (uint32_t)stencil.stencilTestEnable << 1
+            | (uint32_t)advanced->colorBlendCount << 2);
+
+        for (auto& op : { stencil.front, stencil.back }) {
+            push((uint32_t)op.failOp
+                | (uint32_t)op.passOp << 3
+                | (uint32_t)op.depthFailOp << 6
+                | (uint32_t)op.compareOp << 9);
+            push((uint32_t)op.compareMask
+                | (uint32_t)op.writeMask << 8
+                | (uint32_t)op.reference << 16);
+        }
+
+        for (uint32_t i = 0; i < advanced->colorBlendCount; i++) {
+            auto& cb = advanced->colorBlendState[i];
+            push((uint32_t)cb.advancedBlendOp
+                | (uint32_t)cb.srcPremultiplied << 3
+                | (uint32_t)cb.dstPremultiplied << 4
+                | (uint32_t)cb.clampResults << 5
+                | (uint32_t)cb.blendOverlap << 6);
+        }
+    } else {
+        push(0);
+    }
+
+    mHash = utils::fnv1a(utils::_FNV_offset_basis, (const unsigned char*)mWords, mSize * sizeof(uint32_t));
+}
+
+bool PipelineKey::operator==(const PipelineKey& other) const
+{
+    return mHash == other.mHash && mSize == other.mSize
+        && std::memcmp(mWords, other.mWords, mSize * sizeof(uint32_t)) == 0;
+}
+
+}
@@ -7,7 +7,9 @@ namespace mygfx {
 struct PrimitiveState {
     PrimitiveTopology primitiveTopology : 4 = PrimitiveTopology::TRIANGLE_LIST;
     bool restartEnable : 1 = false;
-    uint8_t reserve : 3 = 0;
+    // HwRenderQueue::mergeInstances draws these as instances, see RenderCommand::instanceData
+    bool instancing : 1 = false;
+    uint8_t reserve : 2 = 0;
 
     auto operator<=>(PrimitiveState const&) const = default;
 };
@@ -127,4 +129,31 @@ struct PipelineState {
     AdvancedState* advanceState { nullptr };
 };
 
+// Canonical, pointer-free form of a PipelineState: the program and its vertex input are replaced by
+// their content ids and the advanced state by the values it points to. States that build the same
+// pipeline give equal keys, in every run, so keys can index persistent caches.
+class PipelineKey {
+public:
+    PipelineKey() = default;
+    explicit PipelineKey(const PipelineState& state);
+
+    const uint32_t* data() const { return mWords; }
+    // in words
+    uint32_t size() const { return mSize; }
+    size_t getHash() const { return mHash; }
+
+    bool operator==(const PipelineKey& other) const;
+
+    struct Hasher {
+        size_t operator()(const PipelineKey& key) const { return key.getHash(); }
+    };
+
+private:
+    // program and vertex input ids, fixed states, advanced header, stencil, advanced blends
+    static constexpr uint32_t MAX_WORDS = 4 + 2 + 1 + 4 + 8;
+    uint32_t mWords[MAX_WORDS] {};
+    uint32_t mSize = 0;
+    size_t mHash = 0;
+};
+
 }
\ No newline at end of file
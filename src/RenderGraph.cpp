@@ -0,0 +1,605 @@
+#include "RenderGraph.h"
+#include "TextureData.h"
+#include <algorithm>
+
+namespace mygfx {
+
+RenderGraphTexture RenderGraphBuilder::createTexture(const char* name, const RenderGraphTextureDesc& desc)
+{
+    auto& texture = mGraph.mTextures.emplace_back();
+    texture.name = name;
+    texture.desc = desc;
+    return { (uint32_t)mGraph.mTextures.size() - 1 };
+}
+
+RenderGraphBuffer RenderGraphBuilder::createBuffer(const char* name, const RenderGraphBufferDesc& desc)
+{
+    auto& buffer = mGraph.mBuffers.emplace_back();
+    buffer.name = name;
+    buffer.desc = desc;
+    return { (uint32_t)mGraph.mBuffers.size() - 1 };
+}
+
+RenderGraphTexture RenderGraphBuilder::read(RenderGraphTexture texture, ResourceState state)
+{
+    assert(texture.isValid());
+    RenderGraph::addAccess(mGraph.mPasses[mPassIndex].textures, texture.index, state, false);
+    return texture;
+}
+
+RenderGraphTexture RenderGraphBuilder::write(RenderGraphTexture texture, ResourceState state)
+{
+    assert(texture.isValid());
+    RenderGraph::addAccess(mGraph.mPasses[mPassIndex].textures, texture.index, state, true);
+    if (mGraph.mTextures[texture.index].imported) {
+        sideEffect();
+    }
+    return texture;
+}
+
+RenderGraphBuffer RenderGraphBuilder::read(RenderGraphBuffer buffer, ResourceState state)
+{
+    assert(buffer.isValid());
+    RenderGraph::addAccess(mGraph.mPasses[mPassIndex].buffers, buffer.index, state, false);
+    return buffer;
+}
+
+RenderGraphBuffer RenderGraphBuilder::write(RenderGraphBuffer buffer, ResourceState state)
+{
+    assert(buffer.isValid());
+    RenderGraph::addAccess(mGraph.mPasses[mPassIndex].buffers, buffer.index, state, true);
+    if (mGraph.mBuffers[buffer.index].imported) {
+        sideEffect();
+    }
+    return buffer;
+}
+
+void RenderGraphBuilder::setColorAttachment(uint32_t index, RenderGraphTexture texture, bool clear)
+{
+    assert(index < 8);
+    auto& pass = mGraph.mPasses[mPassIndex];
+    pass.colorAttachments[index] = { texture.index, clear };
+    pass.colorAttachmentCount = std::max(pass.colorAttachmentCount, index + 1);
+
+    // loading depends on the earlier writers
+    if (!clear) {
+        read(texture, ResourceState::RENDER_TARGET_RESOURCE);
+    }
+    write(texture, ResourceState::RENDER_TARGET_RESOURCE);
+}
+
+void RenderGraphBuilder::setDepthAttachment(RenderGraphTexture texture, bool clear)
+{
+    auto& pass = mGraph.mPasses[mPassIndex];
+    pass.depthAttachment = { texture.index, clear };
+
+    if (!clear) {
+        read(texture, ResourceState::DEPTH_WRITE);
+    }
+    write(texture, ResourceState::DEPTH_WRITE);
+}
+
+void RenderGraphBuilder::setRenderTarget(HwRenderTarget* renderTarget, TargetBufferFlags clearFlags)
+{
+    auto& pass = mGraph.mPasses[mPassIndex];
+    pass.renderTarget = renderTarget;
+    pass.renderPassInfo.clearFlags = clearFlags;
+    sideEffect();
+}
+
+RenderPassInfo& RenderGraphBuilder::renderPassInfo()
+{
+    return mGraph.mPasses[mPassIndex].renderPassInfo;
+}
+
+void RenderGraphBuilder::sideEffect()
+{
+    mGraph.mPasses[mPassIndex].sideEffect = true;
+}
+
+HwTexture* RenderGraphResources::getTexture(RenderGraphTexture texture) const
+{
+    return mGraph.getPhysicalTexture(texture.index);
+}
+
+HwBuffer* RenderGraphResources::getBuffer(RenderGraphBuffer buffer) const
+{
+    return mGraph.getPhysicalBuffer(buffer.index);
+}
+
+RenderGraphTexture RenderGraph::importTexture(const char* name, HwTexture* texture)
+{
+    auto& v = mTextures.emplace_back();
+    v.name = name;
+    v.desc = { texture->width, texture->height, texture->format };
+    v.imported = texture;
+    return { (uint32_t)mTextures.size() - 1 };
+}
+
+RenderGraphBuffer RenderGraph::importBuffer(const char* name, HwBuffer* buffer, ResourceState state)
+{
+    auto& v = mBuffers.emplace_back();
+    v.name = name;
+    v.desc = { buffer->usage, buffer->size, buffer->stride };
+    v.imported = buffer;
+    v.state = state;
+    return { (uint32_t)mBuffers.size() - 1 };
+}
+
+bool RenderGraph::Pass::isAttachment(uint32_t texture) const
+{
+    for (uint32_t i = 0; i < colorAttachmentCount; i++) {
+        if (colorAttachments[i].texture == texture) {
+            return true;
+        }
+    }
+
+    return depthAttachment.texture == texture;
+}
+
+void RenderGraph::addPass(const char* name, const std::function<void(RenderGraphBuilder&)>& setup, ExecuteFn execute)
+{
+    uint32_t passIndex = (uint32_t)mPasses.size();
+    auto& pass = mPasses.emplace_back();
+    pass.name = name;
+    pass.execute = std::move(execute);
+
+    RenderGraphBuilder builder(*this, passIndex);
+    setup(builder);
+    mCompiled = false;
+}
+
+void RenderGraph::addAccess(std::vector<Access>& accesses, uint32_t resource, ResourceState state, bool write)
+{
+    for (auto& access : accesses) {
+        if (access.resource != resource) {
+            continue;
+        }
+
+        // the write state wins, reads are combined
+        if (write) {
+            access.state = state;
+        } else if (!access.write) {
+            access.state |= state;
+        }
+
+        access.read |= !write;
+        access.write |= write;
+        return;
+    }
+
+    accesses.push_back({ resource, state, !write, write });
+}
+
+void RenderGraph::compile()
+{
+    cullPasses();
+    computeLifetimes();
+    assignPhysicalSlots();
+    mCompiled = true;
+}
+
+void RenderGraph::cullPasses()
+{
+    // Walks the passes backwards, tracking which resources a later live pass reads. A pass is
+    // live when it writes one of them, its writes then satisfy those reads and its own reads
+    // make the earlier writers live. A pass reading what it writes only keeps the earlier
+    // writers, not itself, so unused read-modify-write chains are culled as a whole.
+    std::vector<bool> textureRead(mTextures.size(), false);
+    std::vector<bool> bufferRead(mBuffers.size(), false);
+
+    for (uint32_t i = (uint32_t)mPasses.size(); i-- > 0;) {
+        auto& pass = mPasses[i];
+        bool writes = false;
+        bool live = pass.sideEffect;
+        for (auto& access : pass.textures) {
+            writes |= access.write;
+            live |= access.write && textureRead[access.resource];
+        }
+
+        for (auto& access : pass.buffers) {
+            writes |= access.write;
+            live |= access.write && bufferRead[access.resource];
+        }
+
+        // a pass without results is only there for its execute callback
+        pass.culled = writes && !live;
+        if (pass.culled) {
+            continue;
+        }
+
+        for (auto& access : pass.textures) {
+            if (access.write) {
+                textureRead[access.resource] = false;
+            }
+            if (access.read) {
+                textureRead[access.resource] = true;
+            }
+        }
+
+        for (auto& access : pass.buffers) {
+            if (access.write) {
+                bufferRead[access.resource] = false;
+            }
+            if (access.read) {
+                bufferRead[access.resource] = true;
+            }
+        }
+    }
+}
+
+static TextureUsage getTextureUsage(ResourceState state)
+{
+    TextureUsage usage = TextureUsage::NONE;
+    if (any(state & ResourceState::RENDER_TARGET_RESOURCE)) {
+        usage |= TextureUsage::COLOR_ATTACHMENT;
+    }
+    if (any(state & (ResourceState::DEPTH_WRITE | ResourceState::DEPTH_READ))) {
+        usage |= TextureUsage::DEPTH_STENCIL_ATTACHMENT;
+    }
+    if (any(state & ResourceState::SHADER_RESOURCE)) {
+        usage |= TextureUsage::SAMPLED;
+    }
+    if (any(state & ResourceState::UNORDERED_ACCESS)) {
+        usage |= TextureUsage::STORAGE;
+    }
+    if (any(state & (ResourceState::COPY_SOURCE | ResourceState::RESOLVE_SOURCE))) {
+        usage |= TextureUsage::TRANSFER_SRC;
+    }
+    if (any(state & (ResourceState::COPY_DEST | ResourceState::RESOLVE_DEST))) {
+        usage |= TextureUsage::TRANSFER_DST;
+    }
+    return usage;
+}
+
+static BufferUsage getBufferUsage(ResourceState state)
+{
+    BufferUsage usage = BufferUsage::NONE;
+    if (any(state & ResourceState::VERTEX_BUFFER_RESOURCE)) {
+        usage |= BufferUsage::VERTEX;
+    }
+    if (any(state & ResourceState::INDEX_BUFFER_RESOURCE)) {
+        usage |= BufferUsage::INDEX;
+    }
+    if (any(state & ResourceState::CONSTANT_BUFFER_RESOURCE)) {
+        usage |= BufferUsage::UNIFORM;
+    }
+    if (any(state & ResourceState::UNORDERED_ACCESS)) {
+        usage |= BufferUsage::STORAGE;
+    }
+    if (any(state & ResourceState::INDIRECT_ARGUMENT)) {
+        usage |= BufferUsage::INDIRECT_BUFFER;
+    }
+    return usage;
+}
+
+void RenderGraph::computeLifetimes()
+{
+    for (auto& v : mTextures) {
+        v.firstPass = v.lastPass = INVALID_INDEX;
+    }
+
+    for (auto& v : mBuffers) {
+        v.firstPass = v.lastPass = INVALID_INDEX;
+    }
+
+    for (uint32_t i = 0; i < mPasses.size(); i++) {
+        auto& pass = mPasses[i];
+        if (pass.culled) {
+            continue;
+        }
+
+        for (auto& access : pass.textures) {
+            auto& v = mTextures[access.resource];
+            v.firstPass = std::min(v.firstPass, i);
+            v.lastPass = v.lastPass == INVALID_INDEX ? i : std::max(v.lastPass, i);
+            v.desc.usage |= getTextureUsage(access.state);
+        }
+
+        for (auto& access : pass.buffers) {
+            auto& v = mBuffers[access.resource];
+            v.firstPass = std::min(v.firstPass, i);
+            v.lastPass = v.lastPass == INVALID_INDEX ? i : std::max(v.lastPass, i);
+            v.desc.usage |= getBufferUsage(access.state);
+        }
+    }
+}
+
+// Greedy interval assignment: in the order of their first use, a resource takes the first slot
+// with an equal desc that is free again by then, or a new one.
+template <typename Resource, typename Slot>
+static void assignSlots(std::vector<Resource>& resources, std::vector<Slot>& slots)
+{
+    std::vector<uint32_t> order;
+    for (uint32_t i = 0; i < resources.size(); i++) {
+        resources[i].physical = 0xffffffff;
+        if (!resources[i].imported && resources[i].firstPass != 0xffffffff) {
+            order.push_back(i);
+        }
+    }
+
+    std::stable_sort(order.begin(), order.end(), [&resources](uint32_t a, uint32_t b) {
+        return resources[a].firstPass < resources[b].firstPass;
+    });
+
+    slots.clear();
+    for (uint32_t index : order) {
+        auto& v = resources[index];
+        uint32_t slot = 0;
+        for (; slot < slots.size(); slot++) {
+            if (slots[slot].lastPass < v.firstPass && slots[slot].desc == v.desc) {
+                break;
+            }
+        }
+
+        if (slot == slots.size()) {
+            slots.push_back({ v.desc, v.lastPass });
+        } else {
+            slots[slot].lastPass = v.lastPass;
+        }
+
+        v.physical = slot;
+    }
+}
+
+void RenderGraph::assignPhysicalSlots()
+{
+    assignSlots(mTextures, mTextureSlots);
+    assignSlots(mBuffers, mBufferSlots);
+}
+
+void RenderGraph::acquireResources(GraphicsApi& cmd)
+{
+    // a pool entry serves one slot per frame
+    for (auto& slot : mTextureSlots) {
+        auto it = std::find_if(mTexturePool.begin(), mTexturePool.end(), [this, &slot](const PooledTexture& entry) {
+            return entry.lastFrame != mFrame && entry.desc == slot.desc;
+        });
+
+        if (it == mTexturePool.end()) {
+            auto textureData = TextureData::texture2D(slot.desc.width, slot.desc.height, slot.desc.format);
+            textureData.usage = slot.desc.usage;
+            textureData.sampleCount = slot.desc.sampleCount;
+
+            auto& entry = mTexturePool.emplace_back();
+            entry.desc = slot.desc;
+            entry.texture = cmd.createTexture(textureData, SamplerInfo::create(Filter::NEAREST, SamplerAddressMode::CLAMP_TO_EDGE));
+            it = mTexturePool.end() - 1;
+        }
+
+        it->lastFrame = mFrame;
+        slot.pool = (uint32_t)(it - mTexturePool.begin());
+    }
+
+    for (auto& slot : mBufferSlots) {
+        auto it = std::find_if(mBufferPool.begin(), mBufferPool.end(), [this, &slot](const PooledBuffer& entry) {
+            return entry.lastFrame != mFrame && entry.desc == slot.desc;
+        });
+
+        if (it == mBufferPool.end()) {
+            auto& entry = mBufferPool.emplace_back();
+            entry.desc = slot.desc;
+            entry.buffer = cmd.createBuffer(slot.desc.usage, MemoryUsage::GPU_ONLY, slot.desc.size, slot.desc.stride, nullptr);
+            it = mBufferPool.end() - 1;
+        }
+
+        it->lastFrame = mFrame;
+        slot.pool = (uint32_t)(it - mBufferPool.begin());
+    }
+}
+
+void RenderGraph::releaseUnusedResources()
+{
+    auto unused = [this](const auto& entry) {
+        return entry.lastFrame + MAX_UNUSED_FRAMES < mFrame;
+    };
+
+    // render targets first, they keep the views of the textures
+    std::erase_if(mRenderTargetPool, unused);
+    std::erase_if(mTexturePool, unused);
+    std::erase_if(mBufferPool, unused);
+}
+
+HwTexture* RenderGraph::getPhysicalTexture(uint32_t texture) const
+{
+    auto& v = mTextures[texture];
+    if (v.imported) {
+        return v.imported;
+    }
+
+    assert(v.physical != INVALID_INDEX && "Texture is not used by a live pass");
+    return mTexturePool[mTextureSlots[v.physical].pool].texture.get();
+}
+
+HwBuffer* RenderGraph::getPhysicalBuffer(uint32_t buffer) const
+{
+    auto& v = mBuffers[buffer];
+    if (v.imported) {
+        return v.imported;
+    }
+
+    assert(v.physical != INVALID_INDEX && "Buffer is not used by a live pass");
+    return mBufferPool[mBufferSlots[v.physical].pool].buffer.get();
+}
+
+HwRenderTarget* RenderGraph::getRenderTarget(GraphicsApi& cmd, uint32_t passIndex, RenderPassInfo& renderInfo)
+{
+    auto& pass = mPasses[passIndex];
+    renderInfo = pass.renderPassInfo;
+    if (pass.renderTarget) {
+        return pass.renderTarget;
+    }
+
+    renderInfo.clearFlags = TargetBufferFlags::NONE;
+    renderInfo.loadFlags = TargetBufferFlags::NONE;
+    renderInfo.storeFlags = TargetBufferFlags::NONE;
+
+    // load what earlier passes wrote, store what later passes or the caller use
+    auto setFlags = [&](const Attachment& attachment, TargetBufferFlags flags) {
+        auto& v = mTextures[attachment.texture];
+        if (attachment.clear) {
+            renderInfo.clearFlags |= flags;
+        } else if (v.imported || v.firstPass < passIndex) {
+            renderInfo.loadFlags |= flags;
+        }
+
+        if (v.imported || v.lastPass > passIndex) {
+            renderInfo.storeFlags |= flags;
+        }
+    };
+
+    HwTextureView* attachments[9] {};
+    HwTexture* firstTexture = nullptr;
+    for (uint32_t i = 0; i < pass.colorAttachmentCount; i++) {
+        auto& attachment = pass.colorAttachments[i];
+        assert(attachment.texture != INVALID_INDEX && "Color attachments must be contiguous");
+        HwTexture* texture = getPhysicalTexture(attachment.texture);
+        attachments[i] = texture->getRTV();
+        firstTexture = firstTexture ? firstTexture : texture;
+        setFlags(attachment, getTargetBufferFlagsAt(i));
+    }
+
+    if (pass.depthAttachment.texture != INVALID_INDEX) {
+        HwTexture* texture = getPhysicalTexture(pass.depthAttachment.texture);
+        attachments[8] = texture->getDSV();
+        firstTexture = firstTexture ? firstTexture : texture;
+        setFlags(pass.depthAttachment, TargetBufferFlags::DEPTH);
+    }
+
+    if (renderInfo.viewport.width == 0) {
+        renderInfo.viewport = { 0, 0, firstTexture->width, firstTexture->height };
+    }
+
+    auto it = std::find_if(mRenderTargetPool.begin(), mRenderTargetPool.end(), [&attachments](const PooledRenderTarget& entry) {
+        return std::equal(std::begin(attachments), std::end(attachments), std::begin(entry.attachments));
+    });
+
+    if (it == mRenderTargetPool.end()) {
+        RenderTargetDesc desc {
+            .width = firstTexture->width,
+            .height = firstTexture->height
+        };
+
+        for (uint32_t i = 0; i < pass.colorAttachmentCount; i++) {
+            desc.colorAttachments.emplace_back(attachments[i]);
+        }
+        desc.depthAttachment = attachments[8];
+
+        auto& entry = mRenderTargetPool.emplace_back();
+        std::copy(std::begin(attachments), std::end(attachments), std::begin(entry.attachments));
+        entry.renderTarget = cmd.createRenderTarget(desc);
+        it = mRenderTargetPool.end() - 1;
+    }
+
+    it->lastFrame = mFrame;
+    return it->renderTarget.get();
+}
+
+void RenderGraph::transitionTextures(GraphicsApi& cmd, const Pass& pass)
+{
+    uint32_t barrierCount = 0;
+    Barrier* barriers = nullptr;
+
+    // The backend moves textures on its own (attachments, sampled writes, bound storage images),
+    // so the graph does not track their state. The source is left UNDEFINED and resolved from
+    // the backend's tracking, which also skips a read after the same read.
+    for (auto& access : pass.textures) {
+        // beginRendering transitions attachments and knows whether the contents are discarded
+        if (pass.isAttachment(access.resource)) {
+            continue;
+        }
+
+        if (barriers == nullptr) {
+            barriers = cmd.allocatePod<Barrier>(pass.textures.size());
+        }
+
+        barriers[barrierCount++] = Barrier::transition(getPhysicalTexture(access.resource), ResourceState::UNDEFINED, access.state);
+    }
+
+    if (barrierCount > 0) {
+        cmd.resourceBarrier(barrierCount, barriers);
+    }
+}
+
+void RenderGraph::transitionBuffers(GraphicsApi& cmd, const Pass& pass)
+{
+    uint32_t barrierCount = 0;
+    Barrier* barriers = nullptr;
+
+    for (auto& access : pass.buffers) {
+        auto& v = mBuffers[access.resource];
+        ResourceState& state = v.imported ? v.state : mBufferPool[mBufferSlots[v.physical].pool].state;
+        bool uav = state == ResourceState::UNORDERED_ACCESS && access.state == ResourceState::UNORDERED_ACCESS;
+        if (state == access.state && !uav) {
+            continue;
+        }
+
+        if (barriers == nullptr) {
+            barriers = cmd.allocatePod<Barrier>(pass.buffers.size());
+        }
+
+        HwBuffer* buffer = getPhysicalBuffer(access.resource);
+        barriers[barrierCount++] = uav ? Barrier::uav(buffer) : Barrier::transition(buffer, state, access.state);
+        state = access.state;
+    }
+
+    if (barrierCount > 0) {
+        cmd.resourceBarrier(barrierCount, barriers);
+    }
+}
+
+void RenderGraph::execute(GraphicsApi& cmd)
+{
+    if (!mCompiled) {
+        compile();
+    }
+
+    mFrame++;
+    acquireResources(cmd);
+
+    RenderGraphResources resources(*this);
+    for (uint32_t i = 0; i < mPasses.size(); i++) {
+        auto& pass = mPasses[i];
+        if (pass.culled) {
+            continue;
+        }
+
+        transitionTextures(cmd, pass);
+        transitionBuffers(cmd, pass);
+
+        if (pass.isRendering()) {
+            RenderPassInfo renderInfo;
+            HwRenderTarget* renderTarget = getRenderTarget(cmd, i, renderInfo);
+            cmd.beginRendering(renderTarget, renderInfo);
+            if (pass.execute) {
+                pass.execute(cmd, resources);
+            }
+            cmd.endRendering(renderTarget);
+        } else if (pass.execute) {
+            pass.execute(cmd, resources);
+        }
+    }
+
+    releaseUnusedResources();
+    reset();
+}
+
+void RenderGraph::reset()
+{
+    mPasses.clear();
+    mTextures.clear();
+    mBuffers.clear();
+    mTextureSlots.clear();
+    mBufferSlots.clear();
+    mCompiled = false;
+}
+
+void RenderGraph::clear()
+{
+    reset();
+    mRenderTargetPool.clear();
+    mTexturePool.clear();
+    mBufferPool.clear();
+}
+
+}
@@ -0,0 +1,256 @@
+#pragma once
+
+#include "GraphicsApi.h"
+#include <functional>
+
+namespace mygfx {
+
+class RenderGraph;
+class RenderGraphBuilder;
+class RenderGraphResources;
+
+struct RenderGraphTexture {
+    static constexpr uint32_t INVALID = 0xffffffff;
+
+    uint32_t index = INVALID;
+
+    bool isValid() const { return index != INVALID; }
+};
+
+struct RenderGraphBuffer {
+    static constexpr uint32_t INVALID = 0xffffffff;
+
+    uint32_t index = INVALID;
+
+    bool isValid() const { return index != INVALID; }
+};
+
+struct RenderGraphTextureDesc {
+    uint16_t width = 0;
+    uint16_t height = 0;
+    Format format = Format::UNDEFINED;
+    // usages implied by the passes (attachment, sampled, storage, copy) are added by compile
+    TextureUsage usage = TextureUsage::NONE;
+    SampleCount sampleCount = SampleCount::SAMPLE_1;
+
+    auto operator<=>(RenderGraphTextureDesc const&) const = default;
+};
+
+struct RenderGraphBufferDesc {
+    BufferUsage usage = BufferUsage::NONE;
+    uint64_t size = 0;
+    uint16_t stride = 0;
+
+    auto operator<=>(RenderGraphBufferDesc const&) const = default;
+};
+
+// Declares what a pass reads and writes, only valid inside the setup callback of addPass.
+class RenderGraphBuilder {
+public:
+    RenderGraphTexture createTexture(const char* name, const RenderGraphTextureDesc& desc);
+    RenderGraphBuffer createBuffer(const char* name, const RenderGraphBufferDesc& desc);
+
+    RenderGraphTexture read(RenderGraphTexture texture, ResourceState state = ResourceState::SHADER_RESOURCE);
+    RenderGraphTexture write(RenderGraphTexture texture, ResourceState state = ResourceState::UNORDERED_ACCESS);
+    RenderGraphBuffer read(RenderGraphBuffer buffer, ResourceState state = ResourceState::CONSTANT_BUFFER_RESOURCE);
+    RenderGraphBuffer write(RenderGraphBuffer buffer, ResourceState state = ResourceState::UNORDERED_ACCESS);
+
+    // Attachments make the pass a rendering pass, the graph begins and ends rendering around its
+    // execute callback. Contents are loaded when an earlier pass wrote them, cleared when clear is
+    // set, and discarded otherwise. They are stored only when a later pass or the caller uses them.
+    void setColorAttachment(uint32_t index, RenderGraphTexture texture, bool clear = false);
+    void setDepthAttachment(RenderGraphTexture texture, bool clear = false);
+    // Renders to an imported render target (the swapchain) instead of attachments
+    void setRenderTarget(HwRenderTarget* renderTarget, TargetBufferFlags clearFlags = TargetBufferFlags::NONE);
+
+    // viewport and clear values, the load, clear and store flags are filled in by the graph
+    RenderPassInfo& renderPassInfo();
+
+    // the pass is kept even if nothing reads what it writes
+    void sideEffect();
+
+private:
+    RenderGraphBuilder(RenderGraph& graph, uint32_t passIndex)
+        : mGraph(graph)
+        , mPassIndex(passIndex)
+    {
+    }
+
+    RenderGraph& mGraph;
+    uint32_t mPassIndex;
+
+    friend class RenderGraph;
+};
+
+// Physical resources of the graph, only valid inside the execute callback of a pass.
+class RenderGraphResources {
+public:
+    HwTexture* getTexture(RenderGraphTexture texture) const;
+    HwBuffer* getBuffer(RenderGraphBuffer buffer) const;
+
+private:
+    RenderGraphResources(const RenderGraph& graph)
+        : mGraph(graph)
+    {
+    }
+
+    const RenderGraph& mGraph;
+
+    friend class RenderGraph;
+};
+
+// Frame graph on top of GraphicsApi. Each frame, passes declare the virtual textures and buffers
+// they read and write, compile() culls the passes whose results are never used and plans the
+// transient resources, and execute() records the live passes in the order they were added.
+//
+// Transient resources whose lifetimes do not overlap and whose descs match share one physical
+// resource, pooled across frames. Barriers for the reads and writes of each pass are issued by
+// the graph, attachments are transitioned by beginRendering.
+//
+// compile() is pure CPU work, the plan can be inspected with isPassCulled and getPhysicalIndex.
+class RenderGraph {
+public:
+    using ExecuteFn = std::function<void(GraphicsApi& cmd, const RenderGraphResources& resources)>;
+
+    // pool entries unused for this many frames are released
+    static constexpr uint32_t MAX_UNUSED_FRAMES = 8;
+
+    RenderGraph() = default;
+    RenderGraph(const RenderGraph&) = delete;
+    RenderGraph& operator=(const RenderGraph&) = delete;
+
+    // The caller owns imported resources, passes writing them are never culled. state is the
+    // state of the buffer when the graph executes, it is left in the state of its last use, as
+    // is an imported texture.
+    RenderGraphTexture importTexture(const char* name, HwTexture* texture);
+    RenderGraphBuffer importBuffer(const char* name, HwBuffer* buffer, ResourceState state);
+
+    void addPass(const char* name, const std::function<void(RenderGraphBuilder&)>& setup, ExecuteFn execute);
+
+    void compile();
+    // Records the live passes, compiles first if needed. The graph is reset afterwards, passes
+    // are added again each frame.
+    void execute(GraphicsApi& cmd);
+
+    // drops the passes and virtual resources of the frame, the pool is kept
+    void reset();
+    // releases the pooled resources as well
+    void clear();
+
+    bool isPassCulled(uint32_t passIndex) const { return mPasses[passIndex].culled; }
+    // physical slot a transient resource is assigned to by compile, slots are shared by aliases
+    uint32_t getPhysicalIndex(RenderGraphTexture texture) const { return mTextures[texture.index].physical; }
+    uint32_t getPhysicalIndex(RenderGraphBuffer buffer) const { return mBuffers[buffer.index].physical; }
+
+private:
+    static constexpr uint32_t INVALID_INDEX = 0xffffffff;
+
+    // one per resource and pass, a pass reading and writing a resource only depends on the
+    // earlier writers when it reads
+    struct Access {
+        uint32_t resource;
+        ResourceState state;
+        bool read;
+        bool write;
+    };
+
+    struct Attachment {
+        uint32_t texture = INVALID_INDEX;
+        bool clear = false;
+    };
+
+    struct Pass {
+        String name;
+        ExecuteFn execute;
+        std::vector<Access> textures;
+        std::vector<Access> buffers;
+        Attachment colorAttachments[8];
+        uint32_t colorAttachmentCount = 0;
+        Attachment depthAttachment;
+        HwRenderTarget* renderTarget = nullptr;
+        RenderPassInfo renderPassInfo {};
+        bool sideEffect = false;
+
+        // compile
+        bool culled = false;
+
+        bool isRendering() const { return renderTarget != nullptr || colorAttachmentCount > 0 || depthAttachment.texture != INVALID_INDEX; }
+        bool isAttachment(uint32_t texture) const;
+    };
+
+    template <typename Desc, typename Handle>
+    struct VirtualResource {
+        String name;
+        Desc desc;
+        Handle* imported = nullptr;
+
+        // compile
+        uint32_t firstPass = INVALID_INDEX;
+        uint32_t lastPass = INVALID_INDEX;
+        uint32_t physical = INVALID_INDEX;
+    };
+
+    using VirtualTexture = VirtualResource<RenderGraphTextureDesc, HwTexture>;
+
+    struct VirtualBuffer : VirtualResource<RenderGraphBufferDesc, HwBuffer> {
+        // state of an imported buffer, follows its uses while executing
+        ResourceState state = ResourceState::UNDEFINED;
+    };
+
+    // physical resource planned by compile, pool is the entry acquired for it by execute
+    template <typename Desc>
+    struct Slot {
+        Desc desc;
+        uint32_t lastPass;
+        uint32_t pool = INVALID_INDEX;
+    };
+
+    struct PooledTexture {
+        RenderGraphTextureDesc desc;
+        Ref<HwTexture> texture;
+        uint64_t lastFrame = 0;
+    };
+
+    struct PooledBuffer {
+        RenderGraphBufferDesc desc;
+        Ref<HwBuffer> buffer;
+        // only the graph transitions its buffers, so the state is known between frames
+        ResourceState state = ResourceState::UNDEFINED;
+        uint64_t lastFrame = 0;
+    };
+
+    struct PooledRenderTarget {
+        HwTextureView* attachments[9] {};
+        Ref<HwRenderTarget> renderTarget;
+        uint64_t lastFrame = 0;
+    };
+
+    static void addAccess(std::vector<Access>& accesses, uint32_t resource, ResourceState state, bool write);
+    void cullPasses();
+    void computeLifetimes();
+    void assignPhysicalSlots();
+    void acquireResources(GraphicsApi& cmd);
+    void releaseUnusedResources();
+    HwTexture* getPhysicalTexture(uint32_t texture) const;
+    HwBuffer* getPhysicalBuffer(uint32_t buffer) const;
+    HwRenderTarget* getRenderTarget(GraphicsApi& cmd, uint32_t passIndex, RenderPassInfo& renderInfo);
+    void transitionTextures(GraphicsApi& cmd, const Pass& pass);
+    void transitionBuffers(GraphicsApi& cmd, const Pass& pass);
+
+    std::vector<Pass> mPasses;
+    std::vector<VirtualTexture> mTextures;
+    std::vector<VirtualBuffer> mBuffers;
+    std::vector<Slot<RenderGraphTextureDesc>> mTextureSlots;
+    std::vector<Slot<RenderGraphBufferDesc>> mBufferSlots;
+
+    std::vector<PooledTexture> mTexturePool;
+    std::vector<PooledBuffer> mBufferPool;
+    std::vector<PooledRenderTarget> mRenderTargetPool;
+    uint64_t mFrame = 0;
+    bool mCompiled = false;
+
+    friend class RenderGraphBuilder;
+    friend class RenderGraphResources;
+};
+
+}
@@ -16,10 +16,10 @@
 
 #include "CircularBuffer.h"
 
-#if !defined(WIN32) && !defined(__EMSCRIPTEN__) && !defined(IOS)
+#if defined(__linux__) && !defined(__EMSCRIPTEN__)
 #include <sys/mman.h>
 #include <unistd.h>
-#define HAS_MMAP 0
+#define HAS_MMAP 1
 #else
 #define HAS_MMAP 0
 #endif
@@ -27,6 +27,7 @@
 #include <stdio.h>
 
 #include "../utils/architecture.h"
+#include "../utils/Log.h"
 #include <assert.h>
 // #include <utils/ashmem.h>
 // #include <utils/debug.h>
@@ -66,68 +67,37 @@ void* CircularBuffer::alloc(size_t size) noexcept
 {
 #if HAS_MMAP
     void* data = nullptr;
-    void* vaddr = MAP_FAILED;
-    void* vaddr_shadow = MAP_FAILED;
-    void* vaddr_guard = MAP_FAILED;
     size_t const BLOCK_SIZE = getBlockSize();
-    int const fd = ashmem_create_region("filament::CircularBuffer", size + BLOCK_SIZE);
-    if (fd >= 0) {
-        // reserve/find enough address space
+
+    // both views must start on a page boundary
+    int const fd = (size % BLOCK_SIZE) == 0 ? memfd_create("mygfx::CircularBuffer", MFD_CLOEXEC) : -1;
+    if (fd >= 0 && ftruncate(fd, (off_t)size) == 0) {
+        // reserve enough address space for both views and the guard page
         void* reserve_vaddr = mmap(nullptr, size * 2 + BLOCK_SIZE,
             PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
         if (reserve_vaddr != MAP_FAILED) {
-            munmap(reserve_vaddr, size * 2 + BLOCK_SIZE);
             // map the circular buffer once...
-            vaddr = mmap(reserve_vaddr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
-            if (vaddr != MAP_FAILED) {
-                // and map the circular buffer again, behind the previous copy...
-                vaddr_shadow = mmap((char*)vaddr + size, size,
-                    PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
-                if (vaddr_shadow != MAP_FAILED && (vaddr_shadow == (char*)vaddr + size)) {
-                    // finally map the guard page, to make sure we never corrupt memory
-                    vaddr_guard = mmap((char*)vaddr_shadow + size, BLOCK_SIZE, PROT_NONE,
-                        MAP_PRIVATE, fd, (off_t)size);
-                    if (vaddr_guard != MAP_FAILED && (vaddr_guard == (char*)vaddr_shadow + size)) {
-                        // woo-hoo success!
-                        mUsesAshmem = fd;
-                        data = vaddr;
-                    }
-                }
+            void* vaddr = mmap(reserve_vaddr, size,
+                PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+            // and map it again, right behind the first copy. The guard page stays PROT_NONE.
+            void* vaddr_shadow = vaddr == MAP_FAILED ? MAP_FAILED : mmap((char*)reserve_vaddr + size, size,
+                PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+            if (vaddr_shadow != MAP_FAILED) {
+                mUsesAshmem = fd;
+                data = reserve_vaddr;
+            } else {
+                munmap(reserve_vaddr, size * 2 + BLOCK_SIZE);
             }
         }
     }
 
     if (mUsesAshmem < 0) {
-        // ashmem failed
-        if (vaddr_guard != MAP_FAILED) {
-            munmap(vaddr_guard, size);
-        }
-
-        if (vaddr_shadow != MAP_FAILED) {
-            munmap(vaddr_shadow, size);
-        }
-
-        if (vaddr != MAP_FAILED) {
-            munmap(vaddr, size);
-        }
-
         if (fd >= 0) {
             close(fd);
         }
 
-        data = mmap(nullptr, size * 2 + BLOCK_SIZE,
-            PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
-
-        // ASSERT_POSTCONDITION(data,
-        //         "couldn't allocate %u KiB of virtual address space for the command buffer",
-        //         (size * 2 / 1024));
-
-        // slog.d << "WARNING: Using soft CircularBuffer (" << (size * 2 / 1024) << " KiB)"
-        //       << io::endl;
-
-        // guard page at the end
-        void* guard = (void*)(uintptr_t(data) + size * 2);
-        mprotect(guard, BLOCK_SIZE, PROT_NONE);
+        LOG_WARNING("Using soft CircularBuffer ({} KiB)", size * 2 / 1024);
+        data = malloc(2 * size);
     }
     return data;
 #else
@@ -138,13 +108,13 @@ void* CircularBuffer::alloc(size_t size) noexcept
 void CircularBuffer::dealloc() noexcept
 {
 #if HAS_MMAP
-    if (mData) {
+    if (mUsesAshmem >= 0) {
         size_t const BLOCK_SIZE = getBlockSize();
         munmap(mData, mSize * 2 + BLOCK_SIZE);
-        if (mUsesAshmem >= 0) {
-            close(mUsesAshmem);
-            mUsesAshmem = -1;
-        }
+        close(mUsesAshmem);
+        mUsesAshmem = -1;
+    } else {
+        free(mData);
     }
 #else
     free(mData);
@@ -154,14 +124,14 @@ void CircularBuffer::dealloc() noexcept
 
 void CircularBuffer::circularize() noexcept
 {
-    if (mUsesAshmem > 0) {
+    if (mUsesAshmem >= 0) {
+        // the second view aliases the first one, so wrapping is just moving the head back.
+        // The bytes past the end are the same physical pages as the start of the buffer,
+        // they must not be touched: the slice that was just flushed reads them.
         intptr_t const overflow = intptr_t(mHead) - (intptr_t(mData) + int64_t(mSize));
         if (overflow >= 0) {
             assert(size_t(overflow) <= mSize);
             mHead = (void*)(intptr_t(mData) + overflow);
-#ifndef NDEBUG
-            memset(mData, 0xA5, size_t(overflow));
-#endif
         }
     } else {
         // Only circularize if mHead if in the second buffer.
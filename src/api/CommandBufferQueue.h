@@ -57,6 +57,7 @@ public:
     ~CommandBufferQueue();
 
     CircularBuffer& getCircularBuffer() { return mCircularBuffer; }
+    CircularBuffer const& getCircularBuffer() const { return mCircularBuffer; }
 
     size_t getHighWatermark() const noexcept { return mHighWatermark; }
 
@@ -116,6 +116,7 @@ void CommandStream::execute(void* buffer)
 void CommandStream::queueCommand(std::function<void()> command)
 {
     new (allocateCommand(CustomCommand::align(sizeof(CustomCommand)))) CustomCommand(std::move(command));
+    COUNT_COMMAND();
 }
 
 template <typename... ARGS>
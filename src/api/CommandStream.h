@@ -211,6 +211,13 @@ public:
 #define DEBUG_COMMAND_END(methodName, sync)
 #endif
 
+// commands recorded into the stream are only counted for the benchmarks, see COMMAND_COUNT in CMakeLists.txt
+#if MYGFX_COMMAND_COUNT
+#define COUNT_COMMAND() mCommandCount++
+#else
+#define COUNT_COMMAND()
+#endif
+
 class CommandStream {
     template <typename T>
     struct AutoExecute {
@@ -270,6 +277,7 @@ public:
         using Cmd = COMMAND_TYPE(methodName);                             \
         void* const p = allocateCommand(CommandBase::align(sizeof(Cmd))); \
         new (p) Cmd(mDispatcher.methodName##_, APPLY(std::move, params)); \
+        COUNT_COMMAND();                                                  \
         DEBUG_COMMAND_END(methodName, false);                             \
     }
 
@@ -291,6 +299,7 @@ public:
         using Cmd = COMMAND_TYPE(methodName##R);                                           \
         void* const p = allocateCommand(CommandBase::align(sizeof(Cmd)));                  \
         new (p) Cmd(mDispatcher.methodName##_, RetType(result), APPLY(std::move, params)); \
+        COUNT_COMMAND();                                                                   \
         DEBUG_COMMAND_END(methodName, false);                                              \
         return result;                                                                     \
     }
@@ -351,6 +360,10 @@ protected:
     Driver& UTILS_RESTRICT mDriver;
     CircularBuffer* UTILS_RESTRICT mCurrentBuffer;
     Dispatcher mDispatcher;
+#if MYGFX_COMMAND_COUNT
+    // driver and custom commands recorded, pod allocations are not counted
+    size_t mCommandCount = 0;
+#endif
 
 #ifndef NDEBUG
     // just for debugging...
@@ -0,0 +1,389 @@
+#include "NullDevice.h"
+#include "api/CommandStreamDispatcher.h"
+#include "utils/Log.h"
+#include <cstring>
+
+namespace mygfx {
+
+NullDevice::NullDevice()
+{
+}
+
+NullDevice::~NullDevice()
+{
+}
+
+bool NullDevice::create(const Settings& settings)
+{
+    mainThreadID = ThreadUtils::getThreadId();
+
+    SamplerHandle::init();
+
+    // Same layout as the Vulkan backend so allocConstant and allocVertex see identical offsets
+    const uint32_t constantBuffersMemSize = 32 * 1024 * 1024;
+    // uniforms are addressed by their offset in the one ring buffer, so it can't grow
+    mConstantBufferRing.create(BufferUsage::UNIFORM | BufferUsage::STORAGE | BufferUsage::SHADER_DEVICE_ADDRESS,
+        MAX_BACKBUFFER_COUNT, constantBuffersMemSize, "Uniforms", false);
+#if LARGE_DYNAMIC_INDEX
+    const uint32_t vertexBuffersMemSize = 64 * 1024 * 1024;
+#else
+    const uint32_t vertexBuffersMemSize = 16 * 1024 * 1024;
+#endif
+    mVertexBufferRing.create(BufferUsage::VERTEX | BufferUsage::INDEX | BufferUsage::INDIRECT_BUFFER | BufferUsage::SHADER_DEVICE_ADDRESS, MAX_BACKBUFFER_COUNT, vertexBuffersMemSize, "VertexBuffers|IndexBuffers");
+
+    LOG_INFO("Null device created: {}", settings.name ? settings.name : "");
+    return true;
+}
+
+const char* NullDevice::getDeviceName() const
+{
+    return "Null";
+}
+
+void NullDevice::destroy()
+{
+    HwObject::gc(true);
+
+    mSwapChain.reset();
+
+    mConstantBufferRing.destroy();
+    mVertexBufferRing.destroy();
+
+    SamplerHandle::shutdown();
+
+    HwObject::gc(true);
+}
+
+Ref<HwSwapchain> NullDevice::createSwapchain(const SwapChainDesc& desc)
+{
+    return makeShared<NullSwapchain>(desc);
+}
+
+Ref<HwRenderTarget> NullDevice::createRenderTarget(const RenderTargetDesc& desc)
+{
+    return makeShared<NullRenderTarget>(desc);
+}
+
+Ref<HwBuffer> NullDevice::createBuffer(BufferUsage usage, MemoryUsage memoryUsage, uint64_t size, uint16_t stride, const void* data)
+{
+    return makeShared<NullBuffer>(usage, memoryUsage, size, stride, data);
+}
+
+Ref<HwBufferView> NullDevice::createBufferView(HwBuffer* buffer, uint64_t offset, uint64_t range)
+{
+    return makeShared<NullBufferView>(static_cast<NullBuffer*>(buffer), offset, range);
+}
+
+Ref<HwTexture> NullDevice::createTexture(const TextureData& textureData, SamplerInfo sampler)
+{
+    auto tex = makeShared<NullTexture>(textureData, sampler);
+    tex->mSRV = createSRV(tex, -1, nullptr);
+    if (any(textureData.usage & TextureUsage::COLOR_ATTACHMENT)) {
+        tex->mRTV = createRTV(tex, 0, nullptr);
+    }
+    if (any(textureData.usage & TextureUsage::DEPTH_STENCIL_ATTACHMENT)) {
+        tex->mDSV = createRTV(tex, 0, nullptr);
+    }
+    return tex;
+}
+
+Ref<HwTextureView> NullDevice::createSRV(HwTexture* tex, int mipLevel, const char* name)
+{
+    return makeShared<NullTextureView>(static_cast<NullTexture*>(tex), mipLevel);
+}
+
+Ref<HwTextureView> NullDevice::createRTV(HwTexture* tex, int mipLevel, const char* name)
+{
+    return makeShared<NullTextureView>(static_cast<NullTexture*>(tex), mipLevel);
+}
+
+bool NullDevice::copyData(HwTexture* tex, TextureDataProvider* dataProvider)
+{
+    NullTexture* nullTex = static_cast<NullTexture*>(tex);
+    for (uint32_t a = 0; a < tex->layerCount; a++) {
+        for (uint32_t face = 0; face < tex->faceCount; face++) {
+            for (uint32_t mip = 0; mip < tex->mipLevels; mip++) {
+                size_t offset, imageSize;
+                if (!nullTex->getImageOffset(mip, a, face, &offset, &imageSize)) {
+                    return false;
+                }
+
+                uint32_t dwWidth = std::max<uint32_t>(tex->width >> mip, 1);
+                uint32_t dwHeight = std::max<uint32_t>(tex->height >> mip, 1);
+                dataProvider->copyPixels(nullTex->storage.data() + offset, (uint32_t)imageSize, dwWidth, dwHeight, a, face, mip);
+            }
+        }
+    }
+    return true;
+}
+
+Ref<SamplerHandle> NullDevice::createSampler(const SamplerInfo& info)
+{
+    return makeShared<NullSampler>(info);
+}
+
+Ref<HwShaderModule> NullDevice::createShaderModule(ShaderStage stage, const ByteArray& shaderCode, ShaderCodeType shaderCodeType, const char* pShaderEntryPoint)
+{
+    return makeShared<NullShaderModule>(stage, shaderCode, shaderCodeType, pShaderEntryPoint);
+}
+
+Ref<HwProgram> NullDevice::createProgram(Ref<HwShaderModule>* shaderModules, uint32_t count, const Span<const SpecializationValue>& specializationValues)
+{
+    return makeShared<NullProgram>(shaderModules, count, specializationValues);
+}
+
+Ref<HwVertexInput> NullDevice::createVertexInput(const FormatList& fmts, const FormatList& fmts1)
+{
+    return makeShared<NullVertexInput>(fmts, fmts1);
+}
+
+Ref<HwRenderPrimitive> NullDevice::createRenderPrimitive(VertexData* geo, const DrawPrimitiveCommand& primitive)
+{
+    return makeShared<NullRenderPrimitive>(geo, primitive);
+}
+
+Ref<HwDescriptorSet> NullDevice::createDescriptorSet(const Span<DescriptorSetLayoutBinding>& bindings)
+{
+    return makeShared<NullDescriptorSet>(bindings);
+}
+
+bool NullDevice::allocVertexBuffer(uint32_t numbeOfVertices, uint32_t strideInBytes, void** pData, BufferInfo* pOut)
+{
+    return mVertexBufferRing.allocVertexBuffer(numbeOfVertices, strideInBytes, pData, pOut);
+}
+
+bool NullDevice::allocIndexBuffer(uint32_t numbeOfIndices, uint32_t strideInBytes, void** pData, BufferInfo* pOut)
+{
+    return mVertexBufferRing.allocIndexBuffer(numbeOfIndices, strideInBytes, pData, pOut);
+}
+
+bool NullDevice::allocConstantBuffer(uint32_t size, void** pData, BufferInfo* pOut)
+{
+    return mConstantBufferRing.allocBuffer(size, pData, pOut);
+}
+
+void NullDevice::updateBuffer(HwBuffer* buffer, const void* data, size_t size, size_t offset)
+{
+    static_cast<NullBuffer*>(buffer)->setData(data, size, offset);
+}
+
+void NullDevice::updateTexture(HwTexture* texture,
+    uint32_t level,
+    uint32_t xoffset,
+    uint32_t yoffset,
+    uint32_t zoffset,
+    uint32_t width,
+    uint32_t height,
+    uint32_t depth,
+    const void* data,
+    size_t size)
+{
+    static_cast<NullTexture*>(texture)->setData(level, xoffset, yoffset, zoffset, width, height, depth, data, size);
+}
+
+void NullDevice::copyTexture(HwTexture* srcTex, uint32_t srcLevel, uint32_t srcLayer,
+    HwTexture* destTex, uint32_t destLevel, uint32_t destLayer)
+{
+    NullTexture* src = static_cast<NullTexture*>(srcTex);
+    NullTexture* dest = static_cast<NullTexture*>(destTex);
+    size_t srcOffset, srcSize, destOffset, destSize;
+    if (!src->getImageOffset(srcLevel, srcLayer, 0, &srcOffset, &srcSize)
+        || !dest->getImageOffset(destLevel, destLayer, 0, &destOffset, &destSize)) {
+        return;
+    }
+
+    std::memcpy(dest->storage.data() + destOffset, src->storage.data() + srcOffset, std::min(srcSize, destSize));
+}
+
+void NullDevice::beginFrame(int)
+{
+}
+
+void NullDevice::endFrame(int)
+{
+    HwObject::gc();
+}
+
+void NullDevice::makeCurrent(HwSwapchain* sc)
+{
+    mSwapChain = sc;
+}
+
+void NullDevice::resize(HwSwapchain* sc, uint32_t destWidth, uint32_t destHeight)
+{
+    static_cast<NullSwapchain*>(sc)->resize(destWidth, destHeight);
+}
+
+void NullDevice::commit(HwSwapchain* sc)
+{
+    assert(sc == mSwapChain);
+}
+
+void NullDevice::updateDescriptorSet1(HwDescriptorSet* descriptorSet, uint32_t dstBinding, HwTextureView* texView)
+{
+}
+
+void NullDevice::updateDescriptorSet2(HwDescriptorSet* descriptorSet, uint32_t dstBinding, HwBuffer* buffer)
+{
+}
+
+void NullDevice::updateDescriptorSet3(HwDescriptorSet* descriptorSet, uint32_t dstBinding, const BufferInfo& bufferInfo)
+{
+}
+
+void NullDevice::updateDescriptorSet4(HwDescriptorSet* descriptorSet, uint32_t dstBinding, uint32_t bufferSize)
+{
+}
+
+void NullDevice::beginRendering(HwRenderTarget* pRT, const RenderPassInfo& renderInfo)
+{
+}
+
+void NullDevice::endRendering(HwRenderTarget* pRT)
+{
+}
+
+void NullDevice::setViewport(float topX, float topY, float width, float height, float minDepth, float maxDepth)
+{
+}
+
+void NullDevice::setScissor(uint32_t topX, uint32_t topY, uint32_t width, uint32_t height)
+{
+}
+
+void NullDevice::setViewportAndScissor(uint32_t topX, uint32_t topY, uint32_t width, uint32_t height)
+{
+}
+
+void NullDevice::resetState(int)
+{
+}
+
+void NullDevice::setVertexInput(HwVertexInput* vertexInput)
+{
+}
+
+void NullDevice::setPrimitiveTopology(PrimitiveTopology primitiveTopology)
+{
+}
+
+void NullDevice::setPrimitiveRestartEnable(bool restartEnable)
+{
+}
+
+void NullDevice::bindShaderProgram(HwProgram* program)
+{
+}
+
+void NullDevice::bindRasterState(const RasterState& rasterState)
+{
+}
+
+void NullDevice::bindColorBlendState(const ColorBlendState& colorBlendState)
+{
+}
+
+void NullDevice::bindDepthState(const DepthState& depthState)
+{
+}
+
+void NullDevice::bindStencilState(const StencilState& stencilState)
+{
+}
+
+void NullDevice::bindPipelineState(const PipelineState& pipelineState)
+{
+}
+
+void NullDevice::pushConstant1(uint32_t index, const void* data, uint32_t size)
+{
+}
+
+void NullDevice::bindDescriptorSets1(const Span<HwDescriptorSet*>& ds, const Uniforms& uniforms)
+{
+}
+
+void NullDevice::bindUniforms(const Uniforms& uniforms)
+{
+}
+
+void NullDevice::bindIndexBuffer(HwBuffer* buffer, uint64_t offset, IndexType indexType)
+{
+}
+
+void NullDevice::bindVertexBuffer(uint32_t firstBinding, HwBuffer* buffer, uint64_t offset)
+{
+}
+
+void NullDevice::draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance)
+{
+    Stats::drawCall()++;
+}
+
+void NullDevice::drawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset, uint32_t firstInstance)
+{
+    Stats::drawCall()++;
+}
+
+void NullDevice::drawIndirect(HwBuffer* buffer, uint64_t offset, uint32_t drawCount, uint32_t stride)
+{
+    Stats::drawCall()++;
+}
+
+void NullDevice::drawIndexedIndirect(HwBuffer* buffer, uint64_t offset, uint32_t drawCount, uint32_t stride)
+{
+    Stats::drawCall()++;
+}
+
+void NullDevice::dispatch(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ)
+{
+}
+
+void NullDevice::dispatchIndirect(HwBuffer* buffer, uint64_t offset)
+{
+}
+
+void NullDevice::drawPrimitive(HwRenderPrimitive* primitive, uint32_t instanceCount, uint32_t firstInstance)
+{
+    Stats::drawCall()++;
+}
+
+void NullDevice::drawIndirectPrimitive(HwRenderPrimitive* primitive, HwBuffer* indirectBuffer, uint64_t offset, uint32_t drawCount, uint32_t stride)
+{
+    Stats::drawCall()++;
+}
+
+void NullDevice::drawBatch(HwRenderQueue* renderQueue)
+{
+    const auto& primitives = renderQueue->getReadCommands();
+    Stats::drawCall() += (uint32_t)primitives.size();
+}
+
+void NullDevice::resourceBarrier(uint32_t barrierCount, const Barrier* pBarriers)
+{
+    // tracks states like the Vulkan backend, UNDEFINED sources are resolved from the tracked state
+    for (uint32_t i = 0; i < barrierCount; ++i) {
+        const Barrier& barrier = pBarriers[i];
+        HwResource* pResource = const_cast<HwResource*>(barrier.pResource);
+        if (barrier.type == BarrierType::UAV) {
+            pResource->setCurrentResourceState(ResourceState::UNORDERED_ACCESS, barrier.subResource);
+            continue;
+        }
+
+        if (barrier.sourceState != ResourceState::UNDEFINED && barrier.sourceState != pResource->getCurrentResourceState(barrier.subResource)) {
+            LOG_ERROR("ResourceBarrier: the source state does not match the tracked state");
+            mInvalidBarrierCount++;
+        }
+
+        pResource->setCurrentResourceState(barrier.destState, barrier.subResource);
+    }
+}
+
+Dispatcher NullDevice::getDispatcher() const noexcept
+{
+    return ConcreteDispatcher<NullDevice>::make();
+}
+
+// explicit instantiation of the Dispatcher
+template class ConcreteDispatcher<NullDevice>;
+}
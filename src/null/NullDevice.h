@@ -0,0 +1,45 @@
+#pragma once
+#include "../GraphicsDevice.h"
+#include "NullHandles.h"
+
+namespace mygfx {
+
+// A device that never touches the GPU: resources live in host memory, programs are recorded but
+// never compiled, and draws are only counted into Stats. Useful for benchmarking the command
+// stream and render thread, and for running the frontend on machines without Vulkan.
+class NullDevice : public GraphicsDevice {
+public:
+    NullDevice();
+    ~NullDevice();
+
+    bool create(const Settings& settings) override;
+
+    const char* getDeviceName() const override;
+    Dispatcher getDispatcher() const noexcept override;
+
+    DynamicBufferPool& getConstbufferRing() { return mConstantBufferRing; }
+    DynamicBufferPool& getVertexBufferRing() { return mVertexBufferRing; }
+    // transitions whose source state did not match the tracked one, the Vulkan backend asserts on them
+    uint32_t getInvalidBarrierCount() const { return mInvalidBarrierCount; }
+
+#define DECL_DRIVER_API(methodName, paramsDecl, params) \
+    UTILS_ALWAYS_INLINE inline void methodName(paramsDecl);
+
+#define DECL_DRIVER_API_SYNCHRONOUS(RetType, methodName, paramsDecl, params) \
+    RetType methodName(paramsDecl) override;
+
+#define DECL_DRIVER_API_RETURN(RetType, methodName, paramsDecl, params) \
+    RetType methodName##S() noexcept override;                          \
+    UTILS_ALWAYS_INLINE inline void methodName##R(RetType, paramsDecl);
+
+#include "api/GraphicsAPI.inc"
+
+    void destroy();
+
+protected:
+    DynamicBufferPool mConstantBufferRing;
+    DynamicBufferPool mVertexBufferRing;
+    std::atomic<uint32_t> mInvalidBarrierCount = 0;
+};
+
+}
@@ -0,0 +1,201 @@
+#include "NullHandles.h"
+#include "../ShaderResourceInfo.h"
+#include "../utils/algorithm.h"
+#include <cstring>
+
+namespace mygfx {
+
+NullBuffer::NullBuffer(BufferUsage usage, MemoryUsage memoryUsage, uint64_t size, uint16_t stride, const void* data)
+{
+    this->usage = usage;
+    this->memoryUsage = memoryUsage;
+    this->size = size;
+    this->stride = stride;
+
+    storage.reset(new uint8_t[size]);
+    mapped = storage.get();
+    deviceAddress = (uint64_t)mapped;
+
+    if (data) {
+        std::memcpy(mapped, data, size);
+    }
+
+    initState(ResourceState::GENERICREAD);
+}
+
+void NullBuffer::setData(const void* data, size_t size, size_t offset)
+{
+    assert(offset + size <= this->size);
+    std::memcpy(storage.get() + offset, data, size);
+}
+
+NullBufferView::NullBufferView(NullBuffer* buffer, uint64_t offset, uint64_t range)
+    : buffer(buffer)
+    , offset(offset)
+    , range(range)
+{
+}
+
+NullTextureView::NullTextureView(NullTexture* texture, int mipLevel)
+    : texture(texture)
+    , mipLevel(mipLevel)
+{
+}
+
+NullTexture::NullTexture(const TextureData& textureData, SamplerInfo samplerInfo)
+    : samplerInfo(samplerInfo)
+{
+    width = textureData.width;
+    height = textureData.height;
+    depth = textureData.depth;
+    layerCount = textureData.layerCount;
+    faceCount = textureData.faceCount;
+    mipLevels = textureData.mipMapCount;
+    format = textureData.format;
+    samplerType = textureData.samplerType;
+
+    mLayout = textureData;
+    mLayout.dataBlock = {};
+
+    storage.resize(mLayout.getTotalSize());
+    if (textureData.dataBlock.size() > 0) {
+        std::memcpy(storage.data(), textureData.dataBlock.data(), std::min(storage.size(), textureData.dataBlock.size()));
+    }
+
+    initState(ResourceState::COMMON_RESOURCE);
+    initSubResourceCount(mipLevels * layerCount * faceCount);
+}
+
+bool NullTexture::getImageOffset(uint32_t level, uint32_t layer, uint32_t face, size_t* pOffset, size_t* pImageSize)
+{
+    return mLayout.getImageOffset((uint16_t)level, (uint16_t)layer, (uint16_t)face, pOffset, pImageSize);
+}
+
+void NullTexture::setData(uint32_t level, uint32_t xoffset, uint32_t yoffset, uint32_t zoffset,
+    uint32_t width, uint32_t height, uint32_t depth, const void* data, size_t size)
+{
+    size_t offset, imageSize;
+    if (!getImageOffset(level, 0, 0, &offset, &imageSize)) {
+        return;
+    }
+
+    uint32_t mipWidth = std::max(1, this->width >> level);
+    uint32_t mipHeight = std::max(1, this->height >> level);
+
+    if (xoffset == 0 && yoffset == 0 && zoffset == 0 && width == mipWidth && height == mipHeight) {
+        std::memcpy(storage.data() + offset, data, std::min(size, storage.size() - offset));
+        return;
+    }
+
+    // Partial updates are only tracked for uncompressed formats
+    if (mLayout.pixelsPerBlock() != 1) {
+        return;
+    }
+
+    uint32_t pixelSize = mLayout.bitsPerPixel() / 8;
+    const uint8_t* src = (const uint8_t*)data;
+    for (uint32_t z = 0; z < depth; z++) {
+        for (uint32_t y = 0; y < height; y++) {
+            size_t dst = offset + (((size_t)(zoffset + z) * mipHeight + yoffset + y) * mipWidth + xoffset) * pixelSize;
+            size_t rowSize = (size_t)width * pixelSize;
+            if (dst + rowSize > storage.size()) {
+                return;
+            }
+            std::memcpy(storage.data() + dst, src, rowSize);
+            src += rowSize;
+        }
+    }
+}
+
+NullSampler::NullSampler(const SamplerInfo& info)
+{
+    samplerInfo = info;
+}
+
+NullShaderModule::NullShaderModule(ShaderStage stage, const ByteArray& shaderCode, ShaderCodeType shaderCodeType, const char* pShaderEntryPoint)
+    : stage(stage)
+    , shaderCodeType(shaderCodeType)
+    , shaderCode(shaderCode)
+    , entryPoint(pShaderEntryPoint ? pShaderEntryPoint : "main")
+{
+}
+
+NullProgram::NullProgram(Ref<HwShaderModule>* shaderModules, uint32_t count, const Span<const SpecializationValue>& specializationValues)
+{
+    size_t hash = utils::_FNV_offset_basis;
+    for (uint32_t i = 0; i < count; i++) {
+        this->shaderModules.push_back(shaderModules[i]);
+
+        auto sm = static_cast<NullShaderModule*>(shaderModules[i].get());
+        hash = utils::fnv1a(hash, (const unsigned char*)&sm->stage, sizeof(sm->stage));
+        hash = utils::fnv1a(hash, sm->shaderCode.data(), sm->shaderCode.size());
+        hash = utils::fnv1a(hash, (const unsigned char*)sm->entryPoint.data(), sm->entryPoint.size());
+        for (auto& sc : specializationValues) {
+            if (any(sc.stageFlags & sm->stage)) {
+                hash = utils::fnv1a(hash, (const unsigned char*)&sc.id, sizeof(sc.id));
+                hash = utils::fnv1a(hash, (const unsigned char*)&sc.value, sizeof(sc.value));
+            }
+        }
+    }
+    contentId = hash;
+}
+
+ShaderResourceInfo* NullProgram::getShaderResource(const String& name)
+{
+    for (auto& sm : shaderModules) {
+        for (auto& res : sm->shaderResourceInfo) {
+            if (name == res->name) {
+                return res;
+            }
+        }
+    }
+    return nullptr;
+}
+
+NullVertexInput::NullVertexInput(const FormatList& fmts, const FormatList& fmts1)
+    : vertexFormats(fmts)
+    , instanceFormats(fmts1)
+{
+    contentId = makeContentId(fmts, fmts1);
+}
+
+NullDescriptorSet::NullDescriptorSet(const Span<DescriptorSetLayoutBinding>& bindings)
+    : bindings(bindings.begin(), bindings.end())
+{
+}
+
+NullRenderPrimitive::NullRenderPrimitive(VertexData* geo, const DrawPrimitiveCommand& primitive)
+    : HwRenderPrimitive(geo, primitive)
+{
+}
+
+NullRenderTarget::NullRenderTarget(const RenderTargetDesc& desc)
+    : colorAttachments(desc.colorAttachments)
+    , depthAttachment(desc.depthAttachment)
+{
+    width = desc.width;
+    height = desc.height;
+}
+
+NullRenderTarget::NullRenderTarget(uint32_t w, uint32_t h, bool isSwapchain)
+{
+    width = w;
+    height = h;
+    this->isSwapchain = isSwapchain;
+}
+
+NullSwapchain::NullSwapchain(const SwapChainDesc& desc)
+{
+    this->desc = desc;
+    renderTarget = makeShared<NullRenderTarget>(desc.width, desc.height, true);
+}
+
+void NullSwapchain::resize(uint32_t w, uint32_t h)
+{
+    desc.width = w;
+    desc.height = h;
+    renderTarget->width = w;
+    renderTarget->height = h;
+}
+
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include "../GraphicsHandles.h"
+#include "../TextureData.h"
+
+#include <memory>
+#include <vector>
+
+namespace mygfx {
+
+class NullBuffer : public HwBuffer {
+public:
+    NullBuffer(BufferUsage usage, MemoryUsage memoryUsage, uint64_t size, uint16_t stride, const void* data);
+
+    void setData(const void* data, size_t size, size_t offset);
+
+    std::unique_ptr<uint8_t[]> storage;
+};
+
+class NullBufferView : public HwBufferView {
+public:
+    NullBufferView(NullBuffer* buffer, uint64_t offset, uint64_t range);
+
+    Ref<NullBuffer> buffer;
+    uint64_t offset = 0;
+    uint64_t range = 0;
+};
+
+class NullTexture;
+
+class NullTextureView : public HwTextureView {
+public:
+    NullTextureView(NullTexture* texture, int mipLevel);
+
+    NullTexture* texture = nullptr;
+    int mipLevel = -1;
+};
+
+class NullTexture : public HwTexture {
+public:
+    NullTexture(const TextureData& textureData, SamplerInfo samplerInfo);
+
+    bool getImageOffset(uint32_t level, uint32_t layer, uint32_t face, size_t* pOffset, size_t* pImageSize);
+    void setData(uint32_t level, uint32_t xoffset, uint32_t yoffset, uint32_t zoffset,
+        uint32_t width, uint32_t height, uint32_t depth, const void* data, size_t size);
+
+    SamplerInfo samplerInfo;
+    std::vector<uint8_t> storage;
+
+private:
+    // Layout only, dataBlock is never kept.
+    TextureData mLayout;
+};
+
+class NullSampler : public SamplerHandle {
+public:
+    NullSampler(const SamplerInfo& info);
+};
+
+class NullShaderModule : public HwShaderModule {
+public:
+    NullShaderModule(ShaderStage stage, const ByteArray& shaderCode, ShaderCodeType shaderCodeType, const char* pShaderEntryPoint);
+
+    ShaderStage stage;
+    ShaderCodeType shaderCodeType;
+    ByteArray shaderCode;
+    String entryPoint;
+};
+
+class NullProgram : public HwProgram {
+public:
+    NullProgram(Ref<HwShaderModule>* shaderModules, uint32_t count, const Span<const SpecializationValue>& specializationValues);
+
+    ShaderResourceInfo* getShaderResource(const String& name) override;
+
+    std::vector<Ref<HwShaderModule>> shaderModules;
+};
+
+class NullVertexInput : public HwVertexInput {
+public:
+    NullVertexInput(const FormatList& fmts, const FormatList& fmts1);
+
+    FormatList vertexFormats;
+    FormatList instanceFormats;
+};
+
+class NullDescriptorSet : public HwDescriptorSet {
+public:
+    NullDescriptorSet(const Span<DescriptorSetLayoutBinding>& bindings);
+
+    std::vector<DescriptorSetLayoutBinding> bindings;
+};
+
+class NullRenderPrimitive : public HwRenderPrimitive {
+public:
+    NullRenderPrimitive(VertexData* geo, const DrawPrimitiveCommand& primitive);
+
+    uint32_t indexCount() const { return drawArgs.indexCount; }
+};
+
+class NullRenderTarget : public HwRenderTarget {
+public:
+    NullRenderTarget(const RenderTargetDesc& desc);
+    NullRenderTarget(uint32_t w, uint32_t h, bool isSwapchain = false);
+
+    std::vector<Ref<HwTextureView>> colorAttachments;
+    Ref<HwTextureView> depthAttachment;
+};
+
+class NullSwapchain : public HwSwapchain {
+public:
+    NullSwapchain(const SwapChainDesc& desc);
+
+    void resize(uint32_t w, uint32_t h);
+};
+
+}
@@ -0,0 +1,42 @@
+#include "utils/FileUtils.h"
+
+#include <fstream>
+#include <string>
+#include <thread>
+
+namespace utils {
+
+bool FileUtils::writeAtomic(const std::filesystem::path& path, const void* data, size_t size) noexcept
+{
+    std::filesystem::path tempPath = path;
+    tempPath += "." + std::to_string(std::hash<std::thread::id> {}(std::this_thread::get_id())) + ".tmp";
+
+    std::ofstream os(tempPath, std::ios::binary | std::ios::out | std::ios::trunc);
+    if (!os.is_open()) {
+        return false;
+    }
+
+    os.write((const char*)data, size);
+    os.close();
+
+    std::error_code ec;
+    if (os) {
+        std::filesystem::rename(tempPath, path, ec);
+    }
+
+    if (!os || ec) {
+        std::filesystem::remove(tempPath, ec);
+        return false;
+    }
+
+    return true;
+}
+
+bool FileUtils::createDirectories(const std::filesystem::path& dir) noexcept
+{
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    return std::filesystem::is_directory(dir, ec);
+}
+
+} // namespace utils
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <filesystem>
+
+namespace utils {
+
+class FileUtils {
+public:
+    // Writes next to the target and renames it over, so a crash or a concurrent write of the
+    // same file never leaves a partial file behind.
+    static bool writeAtomic(const std::filesystem::path& path, const void* data, size_t size) noexcept;
+
+    // creates the directory and its parents, true if it exists afterwards
+    static bool createDirectories(const std::filesystem::path& dir) noexcept;
+};
+
+} // namespace utils
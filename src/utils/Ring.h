@@ -37,7 +37,6 @@ public:
             return true;
         }
 
-        assert(false);
         return false;
     }
 
@@ -2,6 +2,15 @@
 #include "CommandPool.h"
 #include "VulkanDevice.h"
 #include "VulkanImageUtility.h"
+#include <algorithm>
+
+// The tracked states are those of the graphics command buffer recorded on the render thread, which
+// is submitted in recording order. Secondary command buffers are recorded in parallel and other
+// queues are submitted out of that order, their transitions would race on the states or derive
+// the wrong source layouts.
+#define CHECK_TRACKED_TRANSITION()                                                    \
+    assert(commandPool != nullptr && getCommandQueueType() == CommandQueueType::Graphics \
+        && SyncContext::renderThreadID == std::this_thread::get_id())
 
 namespace mygfx {
 
@@ -21,10 +30,18 @@ void CommandBuffer::begin(const VkCommandBufferBeginInfo& beginInfo) const VULKA
 {
     VkResult result = vkBeginCommandBuffer(cmd, &beginInfo);
     VK_CHECK_MSG(result, "CommandBuffer::begin");
+
+    mImageBarriers.clear();
+    mBufferBarriers.clear();
+    mSampledWrites.clear();
 }
 
 void CommandBuffer::end() const VULKAN_NOEXCEPT
 {
+    // leave sampled textures readable for the next command buffer
+    transitionSampledImages();
+    flushBarriers();
+
     VkResult result = vkEndCommandBuffer(cmd);
     VK_CHECK_MSG(result, "CommandBuffer::end");
 }
@@ -33,68 +50,44 @@ void CommandBuffer::beginRendering(HwRenderTarget* pRT, const RenderPassInfo& re
 {
     VulkanRenderTarget* pVkRT = (VulkanRenderTarget*)pRT;
 
-    // Transition color and depth images for drawing
+    // Transition color and depth images for drawing, contents that are not loaded are discarded
+    VulkanTexture* attachments[9];
+    uint32_t attachmentCount = 0;
     if (pVkRT->isSwapchain) {
-        tools::insertImageMemoryBarrier(
-            cmd,
-            pVkRT->colorAttachments[pVkRT->currentIndex]->image(),
-            0,
-            VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-            VK_IMAGE_LAYOUT_UNDEFINED,
-            VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-            VkImageSubresourceRange { VK_IMAGE_ASPECT_COLOR_BIT, 0,
-                1, 0, 1 });
+        attachments[attachmentCount++] = pVkRT->colorAttachments[pVkRT->currentIndex]->texture();
     } else {
-        // todo:check
         for (auto& t : pVkRT->colorAttachments) {
-            tools::insertImageMemoryBarrier(
-                cmd,
-                t->image(),
-                0,
-                VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-                VK_IMAGE_LAYOUT_UNDEFINED,
-                VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-                VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-                VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-                VkImageSubresourceRange { VK_IMAGE_ASPECT_COLOR_BIT, 0,
-                    1, 0, 1 });
+            attachments[attachmentCount++] = t->texture();
         }
     }
 
-    bool hasStencil = true;
     if (pVkRT->depthAttachment) {
-        auto& fmtInfo = getFormatInfo(imgutil::fromVk(pVkRT->depthAttachment->format()));
-        auto dstLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-        if (fmtInfo.depth && !fmtInfo.stencil) {
-            dstLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL;
-            hasStencil = false;
-        } else if (fmtInfo.stencil && !fmtInfo.depth) {
-            dstLayout = VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL;
-        }
+        attachments[attachmentCount++] = pVkRT->depthAttachment->texture();
+    }
 
-        VkImageAspectFlags aspectMask = VK_IMAGE_ASPECT_NONE;
-        if (fmtInfo.depth) {
-            aspectMask |= VK_IMAGE_ASPECT_DEPTH_BIT;
-        }
+    // what earlier passes wrote may be sampled by this one
+    transitionSampledImages(std::span<VulkanTexture* const>(attachments, attachmentCount));
 
-        if (fmtInfo.stencil) {
-            aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
+    if (pVkRT->isSwapchain) {
+        auto& view = pVkRT->colorAttachments[pVkRT->currentIndex];
+        transition(view->texture(), ResourceState::RENDER_TARGET_RESOURCE, &view->subresourceRange(),
+            !any(renderInfo.loadFlags & TargetBufferFlags::COLOR_0) || any(renderInfo.clearFlags & TargetBufferFlags::COLOR_0));
+    } else {
+        for (size_t i = 0; i < pVkRT->colorAttachments.size(); i++) {
+            auto& view = pVkRT->colorAttachments[i];
+            transition(view->texture(), ResourceState::RENDER_TARGET_RESOURCE, &view->subresourceRange(),
+                !any(renderInfo.loadFlags & TargetBufferFlags(1 << i)) || any(renderInfo.clearFlags & TargetBufferFlags(1 << i)));
         }
+    }
 
-        tools::insertImageMemoryBarrier(
-            cmd,
-            pVkRT->depthAttachment->image(),
-            0,
-            VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
-            VK_IMAGE_LAYOUT_UNDEFINED,
-            dstLayout,
-            VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
-            VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
-            VkImageSubresourceRange { aspectMask, 0, 1, 0, 1 });
+    if (pVkRT->depthAttachment) {
+        auto& view = pVkRT->depthAttachment;
+        transition(view->texture(), ResourceState::DEPTH_WRITE, &view->subresourceRange(),
+            !any(renderInfo.loadFlags & TargetBufferFlags::DEPTH) || any(renderInfo.clearFlags & TargetBufferFlags::DEPTH));
     }
 
+    flushBarriers();
+
     // New structures are used to define the attachments used in dynamic rendering
     VkRenderingAttachmentInfoKHR colorAttachment[8] {};
     if (pVkRT->isSwapchain) {
@@ -122,19 +115,17 @@ void CommandBuffer::beginRendering(HwRenderTarget* pRT, const RenderPassInfo& re
     // A single depth stencil attachment info can be used, but they can also be specified separately.
     // When both are specified separately, the only requirement is that the image view is identical.
     VkRenderingAttachmentInfoKHR depthStencilAttachment {};
+    bool hasStencil = true;
 
     if (pVkRT->depthAttachment) {
         auto& fmtInfo = getFormatInfo(imgutil::fromVk(pVkRT->depthAttachment->format()));
-        auto dstLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
         if (fmtInfo.depth && !fmtInfo.stencil) {
-            dstLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL;
             hasStencil = false;
-        } else if (fmtInfo.stencil && !fmtInfo.depth) {
-            dstLayout = VK_IMAGE_LAYOUT_STENCIL_ATTACHMENT_OPTIMAL;
         }
         depthStencilAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
         depthStencilAttachment.imageView = pVkRT->depthAttachment->handle();
-        depthStencilAttachment.imageLayout = dstLayout;
+        // the layout DEPTH_WRITE transitions to
+        depthStencilAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
         depthStencilAttachment.loadOp = any(renderInfo.clearFlags & TargetBufferFlags::DEPTH) ? VK_ATTACHMENT_LOAD_OP_CLEAR
             : any(renderInfo.loadFlags & TargetBufferFlags::DEPTH)                            ? VK_ATTACHMENT_LOAD_OP_LOAD
                                                                                               : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
@@ -177,34 +168,12 @@ void CommandBuffer::endRendering(HwRenderTarget* pRT) const VULKAN_NOEXCEPT
 
     VulkanRenderTarget* pVkRT = (VulkanRenderTarget*)pRT;
     if (pVkRT->isSwapchain) {
-
         // Transition color image for presentation
-        tools::insertImageMemoryBarrier(
-            cmd,
-            pVkRT->colorAttachments[pVkRT->currentIndex]->image(),
-            VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-            0,
-            VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-            VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
-            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-            VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
-            VkImageSubresourceRange { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 });
-
-    } else {
-        // todo:check
-        for (auto& t : pVkRT->colorAttachments) {
-            tools::insertImageMemoryBarrier(
-                cmd,
-                t->image(),
-                VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-                0,
-                VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-                VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
-                VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-                VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
-                VkImageSubresourceRange { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 });
-        }
+        // flushed by end()
+        transition(pVkRT->colorAttachments[pVkRT->currentIndex]->texture(), ResourceState::PRESENT);
     }
+
+    // other attachments keep their state, the next use transitions them
 }
 
 void CommandBuffer::resetState() const VULKAN_NOEXCEPT
@@ -251,6 +220,7 @@ void CommandBuffer::resetState() const VULKAN_NOEXCEPT
     mColorBlendState = {};
     mStencilState = {};
     mPrimitive = nullptr;
+    mSkipDraw = false;
 }
 
 void CommandBuffer::setViewportAndScissor(const VkRect2D& renderArea) const VULKAN_NOEXCEPT
@@ -298,6 +268,19 @@ void CommandBuffer::bindDescriptorSets(HwDescriptorSet* const* ds, uint32_t setC
     assert(setCount <= 8);
 
     if (ds != nullptr) {
+        // barriers are not allowed inside rendering, textures read by graphics sets are expected
+        // to be in SHADER_RESOURCE already
+        if (mProgram->getBindPoint() == VK_PIPELINE_BIND_POINT_COMPUTE) {
+            transitionSampledImages();
+
+            std::lock_guard<std::mutex> lock(gfx().getDescriptorWriteLock());
+            for (uint32_t i = 0; i < setCount; i++) {
+                for (auto& image : ((DescriptorSet*)ds[i])->getBoundImages()) {
+                    transition(image.view->texture(), image.state, &image.view->subresourceRange());
+                }
+            }
+        }
+
         VkDescriptorSet vkDS[8];
         for (uint32_t i = 0; i < setCount; i++) {
             vkDS[i] = ((DescriptorSet*)ds[i])->handle();
@@ -467,13 +450,21 @@ void CommandBuffer::bindPipelineState(const PipelineState* pipelineState) const
 void CommandBuffer::bindGraphicsPipeline(VulkanProgram* vkProgram, const PipelineState* pipelineState) const VULKAN_NOEXCEPT
 {
 #if !HAS_SHADER_OBJECT_EXT
-    extern VulkanDevice& gfx();
     if (vkProgram->getBindPoint() == VkPipelineBindPoint::VK_PIPELINE_BIND_POINT_COMPUTE) {
         auto pipeline = vkProgram->getComputePipeline();
         vkCmdBindPipeline(cmd, VkPipelineBindPoint::VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
     } else {
         auto pipeline = vkProgram->getGraphicsPipeline(gfx().mAttachmentFormats, pipelineState);
-        vkCmdBindPipeline(cmd, VkPipelineBindPoint::VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+        if (pipeline == VK_NULL_HANDLE && vkProgram->fallbackState) {
+            auto fallbackState = vkProgram->fallbackState;
+            pipeline = ((VulkanProgram*)fallbackState->program)->getGraphicsPipeline(gfx().mAttachmentFormats, fallbackState);
+        }
+
+        // still compiling, drop draws until another pipeline is bound
+        mSkipDraw = pipeline == VK_NULL_HANDLE;
+        if (!mSkipDraw) {
+            vkCmdBindPipeline(cmd, VkPipelineBindPoint::VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+        }
     }
 #endif
 }
@@ -481,7 +472,6 @@ void CommandBuffer::bindGraphicsPipeline(VulkanProgram* vkProgram, const Pipelin
 void CommandBuffer::bindComputePipeline(VulkanProgram* vkProgram) const VULKAN_NOEXCEPT
 {
 #if !HAS_SHADER_OBJECT_EXT
-    extern VulkanDevice& gfx();
     assert(vkProgram->getBindPoint() == VkPipelineBindPoint::VK_PIPELINE_BIND_POINT_COMPUTE);
     auto pipeline = vkProgram->getComputePipeline();
     vkCmdBindPipeline(cmd, VkPipelineBindPoint::VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);    
@@ -509,6 +499,12 @@ void CommandBuffer::copyImage(VulkanTexture* srcTex, uint32_t srcLevel, uint32_t
     copyRegion.extent.height = std::min(srcTex->height, destTex->height);
     copyRegion.extent.depth = std::min(srcTex->depth, destTex->depth);
 
+    VkImageSubresourceRange srcRange { imgutil::getAspectFlags(srcTex->vkFormat), srcLevel, 1, srcBaseLayer, 1 };
+    VkImageSubresourceRange destRange { imgutil::getAspectFlags(destTex->vkFormat), destLevel, 1, destBaseLayer, 1 };
+    transition(srcTex, ResourceState::COPY_SOURCE, &srcRange);
+    transition(destTex, ResourceState::COPY_DEST, &destRange);
+    flushBarriers();
+
     vkCmdCopyImage(
         cmd,
         srcTex->image(),
@@ -519,300 +515,344 @@ void CommandBuffer::copyImage(VulkanTexture* srcTex, uint32_t srcLevel, uint32_t
         &copyRegion);
 }
 
-VkImageLayout ConvertToLayout(ResourceState state)
+struct ResourceSync {
+    VkPipelineStageFlags2 stages;
+    VkAccessFlags2 access;
+    VkImageLayout layout;
+    bool write;
+};
+
+static constexpr VkPipelineStageFlags2 ALL_SHADER_STAGES = VK_PIPELINE_STAGE_2_PRE_RASTERIZATION_SHADERS_BIT
+    | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+
+static ResourceSync getStateBitSync(ResourceState state)
 {
     switch (state) {
-    case ResourceState::COMMON_RESOURCE:
-        return VK_IMAGE_LAYOUT_GENERAL;
+    case ResourceState::VERTEX_BUFFER_RESOURCE:
+        return { VK_PIPELINE_STAGE_2_VERTEX_ATTRIBUTE_INPUT_BIT, VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, false };
+    case ResourceState::CONSTANT_BUFFER_RESOURCE:
+        return { ALL_SHADER_STAGES, VK_ACCESS_2_UNIFORM_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, false };
+    case ResourceState::INDEX_BUFFER_RESOURCE:
+        return { VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT, VK_ACCESS_2_INDEX_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, false };
     case ResourceState::RENDER_TARGET_RESOURCE:
-        return VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        return { VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+            VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, true };
     case ResourceState::UNORDERED_ACCESS:
-        return VK_IMAGE_LAYOUT_GENERAL;
+        return { ALL_SHADER_STAGES, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, true };
     case ResourceState::DEPTH_WRITE:
-        return VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        return { VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+            VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+            VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, true };
     case ResourceState::DEPTH_READ:
-    case ResourceState::DEPTH_SHADER_RESOURCE:
-        return VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        return { VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+            VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, false };
     case ResourceState::NONPIXEL_SHADER_RESOURCE:
+        return { VK_PIPELINE_STAGE_2_PRE_RASTERIZATION_SHADERS_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+            VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false };
     case ResourceState::PIXEL_SHADER_RESOURCE:
-    case ResourceState::SHADER_RESOURCE:
-        return VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        return { VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false };
+    case ResourceState::INDIRECT_ARGUMENT:
+        return { VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, false };
     case ResourceState::COPY_DEST:
-        return VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        return { VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, true };
     case ResourceState::COPY_SOURCE:
-        return VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-    case ResourceState::GENERICREAD:
-        return VK_IMAGE_LAYOUT_GENERAL;
-    case ResourceState::PRESENT:
-        return VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-    case ResourceState::SHADING_RATE_SOURCE:
-        return VK_IMAGE_LAYOUT_FRAGMENT_SHADING_RATE_ATTACHMENT_OPTIMAL_KHR;
-    case ResourceState::UNDEFINED:
-        return VK_IMAGE_LAYOUT_UNDEFINED;
-    // Unsupported states
-    case ResourceState::VERTEX_BUFFER_RESOURCE:
-    case ResourceState::CONSTANT_BUFFER_RESOURCE:
-    case ResourceState::INDEX_BUFFER_RESOURCE:
-    case ResourceState::INDIRECT_ARGUMENT:
+        return { VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, false };
     case ResourceState::RESOLVE_DEST:
+        return { VK_PIPELINE_STAGE_2_RESOLVE_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, true };
     case ResourceState::RESOLVE_SOURCE:
+        return { VK_PIPELINE_STAGE_2_RESOLVE_BIT, VK_ACCESS_2_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, false };
+    case ResourceState::SHADING_RATE_SOURCE:
+        return { VK_PIPELINE_STAGE_2_FRAGMENT_SHADING_RATE_ATTACHMENT_BIT_KHR, VK_ACCESS_2_FRAGMENT_SHADING_RATE_ATTACHMENT_READ_BIT_KHR,
+            VK_IMAGE_LAYOUT_FRAGMENT_SHADING_RATE_ATTACHMENT_OPTIMAL_KHR, false };
     case ResourceState::RT_ACCELERATION_STRUCT:
+    case ResourceState::GENERICREAD:
+        return { VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_MEMORY_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, false };
     default:
-        // CauldronCritical(L"Unsupported resource state for layout.");
-        return VK_IMAGE_LAYOUT_UNDEFINED;
-    };
+        break;
+    }
+
+    LOG_ERROR("Unsupported resource state : {}", (uint32_t)state);
+    return { VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, true };
 }
 
-VkAccessFlags ConvertToAccessMask(ResourceState state)
+// Stages, accesses and image layout of a resource in state, restricted to what queueType supports.
+static ResourceSync getResourceSync(ResourceState state, CommandQueueType queueType)
 {
+    ResourceSync sync { VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_UNDEFINED, false };
     switch (state) {
+    case ResourceState::UNDEFINED:
+        return sync;
     case ResourceState::COMMON_RESOURCE:
-        return 0; // VK_ACCESS_NONE_KHR;
-    case ResourceState::VERTEX_BUFFER_RESOURCE:
-        return VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
-    case ResourceState::CONSTANT_BUFFER_RESOURCE:
-        return VK_ACCESS_UNIFORM_READ_BIT;
-    case ResourceState::INDEX_BUFFER_RESOURCE:
-        return VK_ACCESS_INDEX_READ_BIT;
-    case ResourceState::RENDER_TARGET_RESOURCE:
-        return VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-    case ResourceState::UNORDERED_ACCESS:
-        return VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
-    case ResourceState::DEPTH_WRITE:
-        return VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-    case ResourceState::DEPTH_READ:
-        return VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
-    case ResourceState::DEPTH_SHADER_RESOURCE:
-        return VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
-    case ResourceState::NONPIXEL_SHADER_RESOURCE:
-    case ResourceState::PIXEL_SHADER_RESOURCE:
-    case ResourceState::SHADER_RESOURCE:
-        return VK_ACCESS_SHADER_READ_BIT;
-    case ResourceState::INDIRECT_ARGUMENT:
-        return VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
-    case ResourceState::COPY_DEST:
-        return VK_ACCESS_TRANSFER_WRITE_BIT;
-    case ResourceState::COPY_SOURCE:
-        return VK_ACCESS_TRANSFER_READ_BIT;
-    case ResourceState::RESOLVE_DEST:
+        sync = { VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, true };
         break;
-    case ResourceState::RESOLVE_SOURCE:
+    case ResourceState::PRESENT:
+        sync = { VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, false };
         break;
-    case ResourceState::RT_ACCELERATION_STRUCT:
-        return VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR;
-        // return VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
-    case ResourceState::SHADING_RATE_SOURCE:
-        return VK_ACCESS_FRAGMENT_SHADING_RATE_ATTACHMENT_READ_BIT_KHR;
-    case ResourceState::GENERICREAD:
+    case ResourceState::DEPTH_SHADER_RESOURCE:
+        // sampled through the shader resource view
+        sync = { VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT | ALL_SHADER_STAGES,
+            VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false };
         break;
-    case ResourceState::PRESENT:
-        return 0; // VK_ACCESS_NONE_KHR;
-    case ResourceState::UNDEFINED:
-        return 0; // VK_ACCESS_NONE_KHR;
-    };
+    default:
+        for (uint32_t bits = (uint32_t)state; bits != 0; bits &= bits - 1) {
+            ResourceSync bitSync = getStateBitSync((ResourceState)(bits & (~bits + 1)));
+            sync.stages |= bitSync.stages;
+            sync.access |= bitSync.access;
+            sync.write |= bitSync.write;
+            if (sync.layout == VK_IMAGE_LAYOUT_UNDEFINED) {
+                sync.layout = bitSync.layout;
+            } else if (bitSync.layout != VK_IMAGE_LAYOUT_UNDEFINED && bitSync.layout != sync.layout) {
+                sync.layout = VK_IMAGE_LAYOUT_GENERAL;
+            }
+        }
+        break;
+    }
+
+    if (queueType == CommandQueueType::Compute) {
+        sync.stages &= VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT | VK_PIPELINE_STAGE_2_COPY_BIT
+            | VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+        sync.access &= VK_ACCESS_2_SHADER_SAMPLED_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT
+            | VK_ACCESS_2_UNIFORM_READ_BIT | VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_2_TRANSFER_READ_BIT
+            | VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
+    } else if (queueType == CommandQueueType::Copy) {
+        sync.stages &= VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT | VK_PIPELINE_STAGE_2_COPY_BIT | VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+        sync.access &= VK_ACCESS_2_TRANSFER_READ_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
+    }
+
+    if (sync.stages == VK_PIPELINE_STAGE_2_NONE) {
+        sync.access = VK_ACCESS_2_NONE;
+    }
 
-    LOG_ERROR("Unsupported resource state for access mask.");
-    return 0; // VK_ACCESS_NONE_KHR;
+    return sync;
 }
 
-void setSubResourceRange(const HwResource* pResource, VkImageMemoryBarrier& imageBarrier, uint32_t subResource)
+static VkImageSubresourceRange getSubresourceRange(const VulkanTexture* vkTexture, uint32_t subResource)
 {
-    const VulkanTexture* vkTexture = static_cast<const VulkanTexture*>(pResource);
-    imageBarrier.subresourceRange.aspectMask = imgutil::getAspectFlags(vkTexture->vkFormat);
+    VkImageSubresourceRange range {};
+    range.aspectMask = imgutil::getAspectFlags(vkTexture->vkFormat);
     if (subResource == 0xffffffff) {
-        imageBarrier.subresourceRange.baseMipLevel = 0;
-        imageBarrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
-        imageBarrier.subresourceRange.baseArrayLayer = 0;
-        imageBarrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+        range.baseMipLevel = 0;
+        range.levelCount = VK_REMAINING_MIP_LEVELS;
+        range.baseArrayLayer = 0;
+        range.layerCount = VK_REMAINING_ARRAY_LAYERS;
+        return range;
+    }
+
+    //  For types that have both depth and stencil, we need to correct the aspect mask and re-index the sub resource.
+    if (range.aspectMask == (VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT)) {
+        uint32_t numDepthSubResources = vkTexture->mipLevels * vkTexture->layerCount;
+        if (subResource >= numDepthSubResources) {
+            range.aspectMask = VK_IMAGE_ASPECT_STENCIL_BIT;
+            subResource -= numDepthSubResources;
+        } else {
+            range.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+        }
+    }
+
+    range.baseMipLevel = subResource % vkTexture->mipLevels;
+    range.levelCount = 1;
+    range.baseArrayLayer = subResource / vkTexture->mipLevels;
+    range.layerCount = 1;
+
+    assert(range.baseMipLevel < vkTexture->mipLevels && "Subresource range is outside of the image range.");
+    assert(range.baseArrayLayer < vkTexture->layerCount * vkTexture->faceCount && "Subresource range is outside of the image range.");
+    return range;
+}
+
+void CommandBuffer::transition(VulkanTexture* tex, ResourceState newState, const VkImageSubresourceRange* range, bool discard) const VULKAN_NOEXCEPT
+{
+    CHECK_TRACKED_TRANSITION();
+
+    uint32_t totalLayers = (uint32_t)tex->layerCount * tex->faceCount;
+    VkImageSubresourceRange fullRange { imgutil::getAspectFlags(tex->vkFormat), 0, tex->mipLevels, 0, totalLayers };
+    VkImageSubresourceRange r = range ? *range : fullRange;
+    if (r.levelCount == VK_REMAINING_MIP_LEVELS) {
+        r.levelCount = tex->mipLevels - r.baseMipLevel;
+    }
+    if (r.layerCount == VK_REMAINING_ARRAY_LAYERS) {
+        r.layerCount = totalLayers - r.baseArrayLayer;
+    }
+
+    // one barrier when the subresources of the range agree, one per subresource otherwise
+    ResourceState oldState = tex->getCurrentResourceState(tex->subresourceIndex(r.baseMipLevel, r.baseArrayLayer));
+    bool uniform = true;
+    for (uint32_t layer = r.baseArrayLayer; uniform && layer < r.baseArrayLayer + r.layerCount; layer++) {
+        for (uint32_t level = r.baseMipLevel; level < r.baseMipLevel + r.levelCount; level++) {
+            if (tex->getCurrentResourceState(tex->subresourceIndex(level, layer)) != oldState) {
+                uniform = false;
+                break;
+            }
+        }
+    }
+
+    if (uniform) {
+        addImageBarrier(tex, r, oldState, newState, discard);
     } else {
-        // VkImageCreateInfo createInfo = pResource->GetImpl()->GetImageCreateInfo();
-        //  For types that have both depth and stencil, we need to correct the aspect mask and re-index the sub resource.
-        if (imageBarrier.subresourceRange.aspectMask == (VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT)) // depth + stencil
-        {
-            uint32_t numDepthSubResources = vkTexture->mipLevels * vkTexture->layerCount;
-            if (subResource >= numDepthSubResources) // stencil
-            {
-                imageBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_STENCIL_BIT;
-                subResource -= numDepthSubResources;
-            } else // depth
-            {
-                imageBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+        for (uint32_t layer = r.baseArrayLayer; layer < r.baseArrayLayer + r.layerCount; layer++) {
+            for (uint32_t level = r.baseMipLevel; level < r.baseMipLevel + r.levelCount; level++) {
+                VkImageSubresourceRange subRange { r.aspectMask, level, 1, layer, 1 };
+                addImageBarrier(tex, subRange, tex->getCurrentResourceState(tex->subresourceIndex(level, layer)), newState, discard);
             }
         }
+    }
 
-        imageBarrier.subresourceRange.baseMipLevel = subResource % vkTexture->mipLevels;
-        imageBarrier.subresourceRange.levelCount = 1;
-        imageBarrier.subresourceRange.baseArrayLayer = subResource / vkTexture->mipLevels;
-        imageBarrier.subresourceRange.layerCount = 1;
+    tex->setSubresourceState(r, newState);
 
-        assert(imageBarrier.subresourceRange.baseMipLevel < vkTexture->mipLevels && "Subresource range is outside of the image range.");
-        assert(imageBarrier.subresourceRange.baseArrayLayer < vkTexture->layerCount && "Subresource range is outside of the image range.");
+    if (newState != ResourceState::SHADER_RESOURCE && !tex->isSwapchain && (tex->usage & VK_IMAGE_USAGE_SAMPLED_BIT) != 0
+        && std::find(mSampledWrites.begin(), mSampledWrites.end(), tex) == mSampledWrites.end()) {
+        mSampledWrites.push_back(tex);
     }
 }
 
-void CommandBuffer::resourceBarrier(uint32_t barrierCount, const Barrier* pBarriers) const VULKAN_NOEXCEPT
+static bool rangesOverlap(const VkImageSubresourceRange& a, const VkImageSubresourceRange& b)
+{
+    return (a.aspectMask & b.aspectMask) != 0
+        && a.baseMipLevel < b.baseMipLevel + b.levelCount && b.baseMipLevel < a.baseMipLevel + a.levelCount
+        && a.baseArrayLayer < b.baseArrayLayer + b.layerCount && b.baseArrayLayer < a.baseArrayLayer + a.layerCount;
+}
+
+void CommandBuffer::addImageBarrier(VulkanTexture* tex, const VkImageSubresourceRange& range, ResourceState oldState, ResourceState newState, bool discard) const
+{
+    auto queueType = getCommandQueueType();
+    ResourceSync src = getResourceSync(oldState, queueType);
+    ResourceSync dst = getResourceSync(newState, queueType);
+
+    // a read after the same read needs neither a layout change nor a wait
+    if (oldState == newState && !dst.write && !discard) {
+        return;
+    }
+
+    VkImageMemoryBarrier2 barrier { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2 };
+    barrier.srcStageMask = src.stages;
+    // only writes have to be made available
+    barrier.srcAccessMask = src.write ? src.access : VK_ACCESS_2_NONE;
+    barrier.dstStageMask = dst.stages;
+    barrier.dstAccessMask = dst.access;
+    if (discard && tex->isAliased()) {
+        // the memory was last written through another transient attachment
+        barrier.srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+        barrier.srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT;
+    }
+    barrier.oldLayout = discard ? VK_IMAGE_LAYOUT_UNDEFINED : src.layout;
+    barrier.newLayout = dst.layout;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = tex->image();
+    barrier.subresourceRange = range;
+
+    // The barriers of one dependency are unordered, so a subresource must not be transitioned
+    // twice in one. The same range continues the pending transition, an overlap flushes it first.
+    for (auto& pending : mImageBarriers) {
+        if (pending.image != barrier.image || !rangesOverlap(pending.subresourceRange, range)) {
+            continue;
+        }
+
+        if (std::memcmp(&pending.subresourceRange, &range, sizeof(range)) == 0) {
+            pending.dstStageMask = barrier.dstStageMask;
+            pending.dstAccessMask = barrier.dstAccessMask;
+            pending.newLayout = barrier.newLayout;
+            return;
+        }
+
+        recordBarriers();
+        break;
+    }
+
+    mImageBarriers.push_back(barrier);
+}
+
+void CommandBuffer::transition(VulkanBuffer* buffer, ResourceState newState) const VULKAN_NOEXCEPT
+{
+    CHECK_TRACKED_TRANSITION();
+
+    ResourceState oldState = buffer->getCurrentResourceState();
+    auto queueType = getCommandQueueType();
+    ResourceSync src = getResourceSync(oldState, queueType);
+    ResourceSync dst = getResourceSync(newState, queueType);
+    buffer->setCurrentResourceState(newState);
+
+    if (oldState == newState && !dst.write) {
+        return;
+    }
+
+    VkBufferMemoryBarrier2 barrier { VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2 };
+    barrier.srcStageMask = src.stages;
+    barrier.srcAccessMask = src.write ? src.access : VK_ACCESS_2_NONE;
+    barrier.dstStageMask = dst.stages;
+    barrier.dstAccessMask = dst.access;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = buffer->buffer;
+    barrier.offset = 0;
+    barrier.size = VK_WHOLE_SIZE;
+    mBufferBarriers.push_back(barrier);
+}
+
+void CommandBuffer::transitionSampledImages(std::span<VulkanTexture* const> skip) const
 {
-    std::vector<VkImageMemoryBarrier> imageBarriers;
-    std::vector<VkBufferMemoryBarrier> bufferBarriers;
+    if (mSampledWrites.empty()) {
+        return;
+    }
 
+    size_t kept = 0;
+    for (size_t i = 0; i < mSampledWrites.size(); i++) {
+        VulkanTexture* tex = mSampledWrites[i];
+        if (std::find(skip.begin(), skip.end(), tex) != skip.end()) {
+            mSampledWrites[kept++] = tex;
+            continue;
+        }
+
+        transition(tex, ResourceState::SHADER_RESOURCE);
+    }
+
+    mSampledWrites.resize(kept);
+}
+
+void CommandBuffer::recordBarriers() const
+{
+    VkDependencyInfo dependencyInfo { VK_STRUCTURE_TYPE_DEPENDENCY_INFO };
+    dependencyInfo.bufferMemoryBarrierCount = (uint32_t)mBufferBarriers.size();
+    dependencyInfo.pBufferMemoryBarriers = mBufferBarriers.data();
+    dependencyInfo.imageMemoryBarrierCount = (uint32_t)mImageBarriers.size();
+    dependencyInfo.pImageMemoryBarriers = mImageBarriers.data();
+    vkCmdPipelineBarrier2(cmd, &dependencyInfo);
+
+    mImageBarriers.clear();
+    mBufferBarriers.clear();
+}
+
+void CommandBuffer::resourceBarrier(uint32_t barrierCount, const Barrier* pBarriers) const VULKAN_NOEXCEPT
+{
     for (uint32_t i = 0; i < barrierCount; ++i) {
-        const Barrier barrier = pBarriers[i];
+        const Barrier& barrier = pBarriers[i];
+        HwResource* pResource = const_cast<HwResource*>(barrier.pResource);
 
+        ResourceState destState;
         if (barrier.type == BarrierType::TRANSITION) {
-            assert(barrier.sourceState == barrier.pResource->getCurrentResourceState(barrier.subResource) && "ResourceBarrier::Error : ResourceState and Barrier.SourceState do not match.");
-            if (barrier.pResource->type == ResourceType::BUFFER) {
-                const VulkanBuffer* vkBuffer = static_cast<const VulkanBuffer*>(barrier.pResource);
-                VkBufferMemoryBarrier bufferBarrier;
-                bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
-                bufferBarrier.pNext = nullptr;
-                bufferBarrier.srcAccessMask = ConvertToAccessMask(barrier.sourceState);
-                bufferBarrier.dstAccessMask = ConvertToAccessMask(barrier.destState);
-                bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-                bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-                bufferBarrier.buffer = vkBuffer->buffer;
-                bufferBarrier.offset = 0;
-                bufferBarrier.size = VK_WHOLE_SIZE;
-
-                bufferBarriers.push_back(bufferBarrier);
-            } else {
-                const VulkanTexture* vkTexture = static_cast<const VulkanTexture*>(barrier.pResource);
-                if ((barrier.sourceState == ResourceState::PRESENT || barrier.sourceState == ResourceState::UNDEFINED)
-                    && (barrier.destState == ResourceState::PIXEL_SHADER_RESOURCE
-                        || barrier.destState == ResourceState::NONPIXEL_SHADER_RESOURCE
-                        || barrier.destState == (ResourceState::PIXEL_SHADER_RESOURCE | ResourceState::NONPIXEL_SHADER_RESOURCE))) {
-                    // Add an intermediate transition to get rid of the validation warning:
-                    // we are transitioning from undefined state (which means the content of the texture is undefined) to a read state.
-                    // Vulkan triggers a warning in this case.
-                    // More case might exist. We will add them when we meet them.
-
-                    VkImageMemoryBarrier imageBarrier;
-                    imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-                    imageBarrier.pNext = nullptr;
-                    imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-                    imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-                    setSubResourceRange(barrier.pResource, imageBarrier, barrier.subResource);
-                    imageBarrier.image = vkTexture->image();
-
-                    imageBarrier.srcAccessMask = 0;
-                    imageBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-
-                    VkImageUsageFlags usage = vkTexture->usage;
-                    if ((usage & VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT) != 0) {
-                        imageBarrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-                        imageBarrier.newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-                    } else if ((usage & VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT) != 0) {
-                        imageBarrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-                        imageBarrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-                    } else if ((usage & VK_IMAGE_USAGE_TRANSFER_DST_BIT) != 0) {
-                        imageBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-                        imageBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-                    } else if ((usage & VK_IMAGE_USAGE_STORAGE_BIT) != 0) {
-                        imageBarrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
-                        imageBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
-                    } else {
-                        LOG_WARNING("Unable to find an appropriate intermediate transition. Please support this case.");
-                    }
-
-                    // push intermediate barrier
-                    imageBarriers.push_back(imageBarrier);
-
-                    // push final barrier
-                    imageBarrier.srcAccessMask = imageBarrier.dstAccessMask;
-                    imageBarrier.dstAccessMask = ConvertToAccessMask(barrier.destState);
-                    imageBarrier.oldLayout = imageBarrier.newLayout;
-                    imageBarrier.newLayout = ConvertToLayout(barrier.destState);
-                    imageBarriers.push_back(imageBarrier);
-                } else {
-                    VkImageMemoryBarrier imageBarrier = {};
-                    imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-                    imageBarrier.pNext = nullptr;
-                    imageBarrier.srcAccessMask = ConvertToAccessMask(barrier.sourceState);
-                    imageBarrier.dstAccessMask = ConvertToAccessMask(barrier.destState);
-                    imageBarrier.oldLayout = barrier.sourceState == ResourceState::PRESENT ? VK_IMAGE_LAYOUT_UNDEFINED : ConvertToLayout(barrier.sourceState);
-                    imageBarrier.newLayout = ConvertToLayout(barrier.destState);
-                    imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-                    imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-                    imageBarrier.subresourceRange.aspectMask = imgutil::getAspectFlags(vkTexture->vkFormat);
-                    setSubResourceRange(barrier.pResource, imageBarrier, barrier.subResource);
-                    imageBarrier.image = vkTexture->image();
-
-                    imageBarriers.push_back(imageBarrier);
-                }
-            }
-
-            // Set the new internal state (this is largely used for debugging
-            const_cast<HwResource*>(barrier.pResource)->setCurrentResourceState(barrier.destState, barrier.subResource);
+            // UNDEFINED when the caller does not know the state, the tracked one is used anyway
+            assert((barrier.sourceState == ResourceState::UNDEFINED || barrier.sourceState == barrier.pResource->getCurrentResourceState(barrier.subResource))
+                && "ResourceBarrier::Error : ResourceState and Barrier.SourceState do not match.");
+            destState = barrier.destState;
         } else if (barrier.type == BarrierType::UAV) {
-            // Resource is expected to be in UAV state
-            // assert( ResourceState::UnorderedAccess == barrier.pResource->GetCurrentResourceState(barrier.SubResource) ||
-            //                   ResourceState::RTAccelerationStruct == barrier.pResource->GetCurrentResourceState(barrier.SubResource),
-            //               "ResourceBarrier::Error : ResourceState isn't UnorderedAccess or RTAccelerationStruct.");
-
-            if (barrier.pResource->type == ResourceType::IMAGE) {
-                const VulkanTexture* vkTexture = static_cast<const VulkanTexture*>(barrier.pResource);
-                VkFormat imageFormat = vkTexture->vkFormat;
-
-                VkImageMemoryBarrier imageBarrier = {};
-                imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-                imageBarrier.pNext = nullptr;
-                imageBarrier.srcAccessMask = ConvertToAccessMask(barrier.sourceState); // Is this really needed for a UAV barrier? Remove if it's ignored
-                imageBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
-                imageBarrier.oldLayout = barrier.sourceState == ResourceState::PRESENT ? VK_IMAGE_LAYOUT_UNDEFINED : ConvertToLayout(barrier.sourceState);
-                imageBarrier.newLayout = ConvertToLayout(barrier.destState);
-                imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-                imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-                imageBarrier.subresourceRange.aspectMask = imgutil::getAspectFlags(imageFormat);
-                setSubResourceRange(barrier.pResource, imageBarrier, barrier.subResource);
-                imageBarrier.image = vkTexture->image();
-
-                imageBarriers.push_back(imageBarrier);
-            } else if (barrier.pResource->type == ResourceType::BUFFER) {
-                const VulkanBuffer* vkBuffer = static_cast<const VulkanBuffer*>(barrier.pResource);
-
-                VkBufferMemoryBarrier bufferBarrier;
-                bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
-                bufferBarrier.pNext = nullptr;
-                bufferBarrier.srcAccessMask = ConvertToAccessMask(barrier.sourceState); // Is this really needed for a UAV barrier? Remove if it's ignored
-                bufferBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
-                bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-                bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-                bufferBarrier.buffer = vkBuffer->buffer;
-                bufferBarrier.offset = 0;
-                bufferBarrier.size = VK_WHOLE_SIZE;
-
-                bufferBarriers.push_back(bufferBarrier);
-            }
+            // a write state, so the barrier is recorded even if the resource stays in it
+            destState = ResourceState::UNORDERED_ACCESS;
         } else {
             LOG_ERROR("Unsupported barrier");
+            continue;
         }
-    }
 
-    if (bufferBarriers.size() > 0 || imageBarriers.size() > 0) {
-        uint32_t srcStageMask = VK_PIPELINE_STAGE_NONE;
-        uint32_t dstStageMask = VK_PIPELINE_STAGE_NONE;
-        switch (getCommandQueueType()) {
-        case CommandQueueType::Graphics:
-            srcStageMask = VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT;
-            dstStageMask = VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT;
-            break;
-        case CommandQueueType::Compute:
-            srcStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
-            dstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
-            break;
-        case CommandQueueType::Copy:
-            srcStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
-            dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
-            break;
+        if (pResource->type == ResourceType::BUFFER) {
+            transition(static_cast<VulkanBuffer*>(pResource), destState);
+        } else {
+            VulkanTexture* vkTexture = static_cast<VulkanTexture*>(pResource);
+            VkImageSubresourceRange range = getSubresourceRange(vkTexture, barrier.subResource);
+            transition(vkTexture, destState, &range);
+            // the caller keeps the state it asked for, it is not moved back to SHADER_RESOURCE
+            std::erase(mSampledWrites, vkTexture);
         }
-        vkCmdPipelineBarrier(
-            cmd,
-            srcStageMask, dstStageMask, 0,
-            0, nullptr,
-            static_cast<uint32_t>(bufferBarriers.size()),
-            bufferBarriers.data(),
-            static_cast<uint32_t>(imageBarriers.size()),
-            imageBarriers.data());
     }
+
+    // recorded with the transitions of the next draw, dispatch, copy or pass
 }
 
 void CommandBuffer::free() const
@@ -875,21 +915,20 @@ VkPipelineStageFlags pipelineStageForLayout(VkImageLayout layout)
 
 void CommandBuffer::setImageLayout(VkImage image, VkImageLayout oldImageLayout, VkImageLayout newImageLayout, const VkImageSubresourceRange& subresourceRange) const VULKAN_NOEXCEPT
 {
-    // Create an image barrier object
-    VkImageMemoryBarrier imageMemoryBarrier;
-    imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-    imageMemoryBarrier.pNext = nullptr;
+    // the legacy stage and access bits keep their values in the 2 variants
+    VkImageMemoryBarrier2 imageMemoryBarrier { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2 };
+    imageMemoryBarrier.srcStageMask = pipelineStageForLayout(oldImageLayout);
+    imageMemoryBarrier.srcAccessMask = accessFlagsForLayout(oldImageLayout);
+    imageMemoryBarrier.dstStageMask = pipelineStageForLayout(newImageLayout);
+    imageMemoryBarrier.dstAccessMask = accessFlagsForLayout(newImageLayout);
     imageMemoryBarrier.oldLayout = oldImageLayout;
     imageMemoryBarrier.newLayout = newImageLayout;
+    imageMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
     imageMemoryBarrier.image = image;
     imageMemoryBarrier.subresourceRange = subresourceRange;
-    imageMemoryBarrier.srcAccessMask = accessFlagsForLayout(oldImageLayout);
-    imageMemoryBarrier.dstAccessMask = accessFlagsForLayout(newImageLayout);
-    VkPipelineStageFlags srcStageMask = pipelineStageForLayout(oldImageLayout);
-    VkPipelineStageFlags destStageMask = pipelineStageForLayout(newImageLayout);
-    // Put barrier on top
-    // Put barrier inside setup command buffer
-    pipelineBarrier(srcStageMask, destStageMask, VkDependencyFlags(), 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
+    // batched with the other pending barriers
+    mImageBarriers.push_back(imageMemoryBarrier);
 }
 
 void CommandBuffer::pipelineBarrier(VkPipelineStageFlags srcStageMask,
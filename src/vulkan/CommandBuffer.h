@@ -10,6 +10,7 @@
 #include "VulkanTextureView.h"
 
 #include <span>
+#include <vector>
 
 #define VULKAN_NOEXCEPT noexcept
 
@@ -97,6 +98,14 @@ public:
     void copyImage(VulkanTexture* srcTex, uint32_t srcLevel, uint32_t srcBaseLayer, VulkanTexture* destTex, uint32_t destLevel, uint32_t destBaseLayer) const VULKAN_NOEXCEPT;
     void resourceBarrier(uint32_t barrierCount, const Barrier* pBarriers) const VULKAN_NOEXCEPT;
 
+    // Brings the subresources of tex in range (the whole image when null) from their tracked state
+    // into newState. Nothing is recorded for a read after the same read. discard drops the old
+    // contents. Barriers are batched and recorded as one dependency by flushBarriers, which the
+    // next draw, dispatch, copy or rendering begin calls.
+    void transition(VulkanTexture* tex, ResourceState newState, const VkImageSubresourceRange* range = nullptr, bool discard = false) const VULKAN_NOEXCEPT;
+    void transition(VulkanBuffer* buffer, ResourceState newState) const VULKAN_NOEXCEPT;
+    void flushBarriers() const VULKAN_NOEXCEPT;
+
     void setImageLayout(VkImage image, VkImageLayout oldImageLayout, VkImageLayout newImageLayout, const VkImageSubresourceRange& subresourceRange) const VULKAN_NOEXCEPT;
 
     void pipelineBarrier(VkPipelineStageFlags srcStageMask,
@@ -124,6 +133,10 @@ public:
     mutable CommandList* commandPool = nullptr;
 
 private:
+    void recordBarriers() const;
+    void addImageBarrier(VulkanTexture* tex, const VkImageSubresourceRange& range, ResourceState oldState, ResourceState newState, bool discard) const;
+    void transitionSampledImages(std::span<VulkanTexture* const> skip = {}) const;
+
     mutable VulkanVertexInput* mVertexInput = nullptr;
     mutable VulkanProgram* mProgram = nullptr;
     mutable PrimitiveState mPrimitiveState {};
@@ -133,6 +146,13 @@ private:
     mutable ColorBlendState mColorBlendState {};
     mutable StencilState mStencilState {};
     mutable HwRenderPrimitive* mPrimitive = nullptr;
+    mutable bool mSkipDraw = false;
+
+    mutable std::vector<VkImageMemoryBarrier2> mImageBarriers;
+    mutable std::vector<VkBufferMemoryBarrier2> mBufferBarriers;
+    // Sampled textures moved out of SHADER_RESOURCE. Bindless reads cannot be seen, so they are
+    // brought back before the next pass and at the end of the command buffer.
+    mutable std::vector<VulkanTexture*> mSampledWrites;
 };
 
 inline void CommandBuffer::setVertexInput(HwVertexInput* vertexInput) const VULKAN_NOEXCEPT
@@ -224,7 +244,7 @@ inline void CommandBuffer::drawPrimitive(HwRenderPrimitive* primitive, uint32_t
     if (rp->indexBuffer != nullptr) {
         if (mPrimitive != primitive) {
             vkCmdBindVertexBuffers(cmd, 0, (uint32_t)rp->vertexBuffers.size(), rp->vertexBuffers.data(), rp->bufferOffsets.get());
-            vkCmdBindIndexBuffer(cmd, rp->indexBuffer, 0, rp->indexType);
+            vkCmdBindIndexBuffer(cmd, rp->indexBuffer, rp->indexOffset, rp->indexType);
         }
 
         drawIndexed(rp->drawArgs.indexCount, instanceCount, rp->drawArgs.firstIndex, 0, firstInstance);
@@ -242,6 +262,12 @@ inline void CommandBuffer::drawPrimitive(HwRenderPrimitive* primitive, uint32_t
 
 inline void CommandBuffer::draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance) const VULKAN_NOEXCEPT
 {
+    if (mSkipDraw) {
+        return;
+    }
+
+    flushBarriers();
+
     vkCmdDraw(cmd, vertexCount, instanceCount, firstVertex, firstInstance);
 }
 
@@ -251,28 +277,56 @@ inline void CommandBuffer::drawIndexed(uint32_t indexCount,
     int32_t vertexOffset,
     uint32_t firstInstance) const VULKAN_NOEXCEPT
 {
+    if (mSkipDraw) {
+        return;
+    }
+
+    flushBarriers();
+
     vkCmdDrawIndexed(cmd, indexCount, instanceCount, firstIndex, vertexOffset, firstInstance);
 }
 
 inline void CommandBuffer::drawIndirect(HwBuffer* buffer, VkDeviceSize offset, uint32_t drawCount, uint32_t stride) const VULKAN_NOEXCEPT
 {
+    if (mSkipDraw) {
+        return;
+    }
+
+    flushBarriers();
+
     VulkanBuffer* vkBuffer = static_cast<VulkanBuffer*>(buffer);
     vkCmdDrawIndirect(cmd, vkBuffer->buffer, offset, drawCount, stride);
 }
 
 inline void CommandBuffer::drawIndexedIndirect(HwBuffer* buffer, VkDeviceSize offset, uint32_t drawCount, uint32_t stride) const VULKAN_NOEXCEPT
 {
+    if (mSkipDraw) {
+        return;
+    }
+
+    flushBarriers();
+
     VulkanBuffer* vkBuffer = static_cast<VulkanBuffer*>(buffer);
     vkCmdDrawIndexedIndirect(cmd, vkBuffer->buffer, offset, drawCount, stride);
 }
 
+inline void CommandBuffer::flushBarriers() const VULKAN_NOEXCEPT
+{
+    if (!mImageBarriers.empty() || !mBufferBarriers.empty()) {
+        recordBarriers();
+    }
+}
+
 inline void CommandBuffer::dispatch(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ) const VULKAN_NOEXCEPT
 {
+    flushBarriers();
     vkCmdDispatch(cmd, groupCountX, groupCountY, groupCountZ);
 }
 
 inline void CommandBuffer::dispatchIndirect(HwBuffer* buffer, VkDeviceSize offset) const VULKAN_NOEXCEPT
 {
+    flushBarriers();
+
     VulkanBuffer* vkBuffer = static_cast<VulkanBuffer*>(buffer);
     vkCmdDispatchIndirect(cmd, vkBuffer->buffer, offset);
 }
@@ -102,4 +102,28 @@ void CommandList::free()
     mCommandBuffers.clear();
 }
 
-}
\ No newline at end of file
+SecondaryCommandPool::SecondaryCommandPool(uint32_t queueFamilyIndex)
+{
+    for (auto& slot : mFrameSlots) {
+        slot.pool.create(queueFamilyIndex);
+    }
+}
+
+CommandBuffer* SecondaryCommandPool::acquire(uint64_t frameIndex)
+{
+    auto& slot = mFrameSlots[frameIndex % FRAME_SLOT_COUNT];
+    if (slot.frameIndex != frameIndex) {
+        // the GPU is done with this slot, recycle every buffer at once
+        slot.pool.reset();
+        slot.used = 0;
+        slot.frameIndex = frameIndex;
+    }
+
+    if (slot.used == slot.commandBuffers.size()) {
+        slot.commandBuffers.emplace_back(slot.pool.alloc(true));
+    }
+
+    return &slot.commandBuffers[slot.used++];
+}
+
+}
@@ -3,6 +3,7 @@
 #include "../GraphicsDefs.h"
 #include "CommandBuffer.h"
 #include "VulkanObjects.h"
+#include <deque>
 
 namespace mygfx {
 class CommandPool : public HandleUnique<VkCommandPool> {
@@ -42,4 +43,25 @@ protected:
     std::vector<CommandBuffer> mCommandBuffers;
     std::vector<VkCommandBuffer> mVkCommandBuffers;
 };
+
+// Secondary command buffers owned by one worker thread. Buffers are recycled once their frame slot
+// comes around again, so steady-state recording never allocates.
+class SecondaryCommandPool {
+public:
+    static constexpr uint32_t FRAME_SLOT_COUNT = MAX_BACKBUFFER_COUNT + 1;
+
+    SecondaryCommandPool(uint32_t queueFamilyIndex);
+
+    CommandBuffer* acquire(uint64_t frameIndex);
+
+protected:
+    struct FrameSlot {
+        CommandPool pool;
+        std::deque<CommandBuffer> commandBuffers;
+        uint32_t used = 0;
+        uint64_t frameIndex = ~0ull;
+    };
+
+    FrameSlot mFrameSlots[FRAME_SLOT_COUNT];
+};
 }
@@ -108,8 +108,20 @@ uint64_t CommandQueue::submit(const std::vector<CommandBuffer>& cmdLists, const
 
 uint64_t CommandQueue::submit(const VkCommandBuffer* commandBuffers, uint32_t count, const VkSemaphore signalSemaphore, const VkSemaphore waitSemaphore, int useEndOfFrameSemaphore)
 {
-    VkPipelineStageFlags waitStageFlags[] = { VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT };
-    VkSemaphore waitSemaphores[] = { mSemaphore, waitSemaphore };
+    VkPipelineStageFlags waitStageFlags[] = { VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT };
+    uint64_t semaphoreWaitValues[] = { mLatestSemaphoreValue, 0, 0 };
+
+    uint32_t waitSemaphoreCount = 0;
+    VkSemaphore waitSemaphores[3];
+    waitSemaphores[waitSemaphoreCount++] = mSemaphore;
+    if (waitSemaphore != VK_NULL_HANDLE)
+        waitSemaphores[waitSemaphoreCount++] = waitSemaphore;
+    if (mQueueWaitSemaphore != VK_NULL_HANDLE) {
+        waitStageFlags[waitSemaphoreCount] = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+        semaphoreWaitValues[waitSemaphoreCount] = mQueueWaitValue;
+        waitSemaphores[waitSemaphoreCount++] = mQueueWaitSemaphore;
+        mQueueWaitSemaphore = VK_NULL_HANDLE;
+    }
 
     uint32_t signalSemaphoreCount = 0;
     VkSemaphore signalSemaphores[3];
@@ -122,7 +134,7 @@ uint64_t CommandQueue::submit(const VkCommandBuffer* commandBuffers, uint32_t co
     VkSubmitInfo info = {};
     info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
     info.pNext = nullptr;
-    info.waitSemaphoreCount = (waitSemaphore == VK_NULL_HANDLE) ? 1 : 2;
+    info.waitSemaphoreCount = waitSemaphoreCount;
     info.pWaitSemaphores = waitSemaphores;
     info.pWaitDstStageMask = waitStageFlags;
     info.pCommandBuffers = commandBuffers;
@@ -130,7 +142,6 @@ uint64_t CommandQueue::submit(const VkCommandBuffer* commandBuffers, uint32_t co
     info.signalSemaphoreCount = signalSemaphoreCount;
     info.pSignalSemaphores = signalSemaphores;
 
-    uint64_t semaphoreWaitValues[] = { mLatestSemaphoreValue, 0 };
     ++mLatestSemaphoreValue;
 
     // the second value is useless
@@ -191,6 +202,27 @@ void CommandQueue::wait(uint64_t waitValue) const
     // Assert(ASSERT_WARNING, res == VK_SUCCESS, "Failed to wait on the queue semaphore.");
 }
 
+uint64_t CommandQueue::getCompletedValue() const
+{
+    uint64_t value = 0;
+#if MYGFX_FEATURE_LEVEL <= 1
+    vkGetSemaphoreCounterValueKHR(gfx().device, mSemaphore, &value);
+#else
+    vkGetSemaphoreCounterValue(gfx().device, mSemaphore, &value);
+#endif
+    return value;
+}
+
+void CommandQueue::waitQueue(const CommandQueue& queue, uint64_t value)
+{
+    if (mQueueWaitSemaphore == queue.mSemaphore) {
+        mQueueWaitValue = std::max(mQueueWaitValue, value);
+    } else {
+        mQueueWaitSemaphore = queue.mSemaphore;
+        mQueueWaitValue = value;
+    }
+}
+
 void CommandQueue::flush()
 {
     std::lock_guard<std::mutex> lock(mSubmitMutex);
@@ -26,6 +26,13 @@ public:
     uint64_t submit(const VkCommandBuffer* cmdLists, uint32_t count, const VkSemaphore signalSemaphore, const VkSemaphore waitSemaphore, int useEndOfFrameSemaphore = -1);
     uint64_t present(VkSwapchainKHR swapchain, uint32_t imageIndex); // only valid on the present queue
     void wait(uint64_t waitValue) const;
+    uint64_t getCompletedValue() const;
+    // the value the next submit signals
+    uint64_t getNextSubmitValue() const { return mLatestSemaphoreValue + 1; }
+
+    // The next submit waits on the GPU until the timeline semaphore of another queue reaches value.
+    void waitQueue(const CommandQueue& queue, uint64_t value);
+    VkSemaphore getSemaphore() const { return mSemaphore; }
 
     void flush();
 
@@ -37,6 +44,8 @@ protected:
     CommandQueueType mQueueType;
     VkSemaphore mSemaphore;
     uint64_t mLatestSemaphoreValue = 0;
+    VkSemaphore mQueueWaitSemaphore = VK_NULL_HANDLE;
+    uint64_t mQueueWaitValue = 0;
     uint32_t mFamilyIndex;
     moodycamel::ConcurrentQueue<CommandList*> mAvailableCommandPools;
     std::vector<VkSemaphore> mFrameSemaphores = {};
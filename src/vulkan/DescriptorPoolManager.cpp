@@ -1,5 +1,7 @@
 #include "DescriptorPoolManager.h"
 #include "VulkanDevice.h"
+#include "utils/algorithm.h"
+#include <atomic>
 
 namespace mygfx {
 
@@ -22,39 +24,171 @@ namespace {
         VK_DESCRIPTOR_TYPE_MUTABLE_VALVE,
         VK_DESCRIPTOR_TYPE_SAMPLER
     };
+
+    // bumped by destroyAll, thread caches from before point at destroyed pools
+    std::atomic<uint32_t> sGeneration = 1;
+
+    // pools of exited threads, taken back by the manager on its next acquire. Thread exit may
+    // run after the device is gone (the main thread's cache), so it never touches the manager.
+    std::mutex sOrphanLock;
+    std::vector<PoolInfo*> sOrphanPools;
 }
 
+// The pool each thread allocates from, per bucket. Queued for the manager on thread exit.
+struct ThreadPoolCache {
+    DescriptorPoolManager* manager = nullptr;
+    uint32_t generation = 0;
+    std::unordered_map<size_t, PoolInfo*> pools;
+
+    ~ThreadPoolCache()
+    {
+        std::lock_guard<std::mutex> lock(sOrphanLock);
+        if (manager && generation == sGeneration) {
+            for (auto& it : pools) {
+                sOrphanPools.push_back(it.second);
+            }
+        }
+    }
+};
+
+static thread_local ThreadPoolCache sThreadPools;
+
 void DescriptorPoolManager::init()
 {
 }
 
-VkDescriptorPool& DescriptorPoolManager::getPool(const DescriptorResourceCounts& counts, uint32_t totalSets)
+PoolInfo* DescriptorPoolManager::allocate(const DescriptorResourceCounts& counts, bool bindless, VkDescriptorSetAllocateInfo& allocInfo, VkDescriptorSet* descriptorSet)
+{
+    size_t key = utils::fnv1a(utils::_FNV_offset_basis, (const unsigned char*)counts.data(), sizeof(uint32_t) * DESCRIPTOR_TYPE_COUNT);
+    utils::hash_combine(key, bindless);
+
+    auto& cache = sThreadPools;
+    if (cache.manager != this || cache.generation != sGeneration) {
+        cache.pools.clear();
+        cache.manager = this;
+        cache.generation = sGeneration;
+    }
+
+    PoolInfo*& pool = cache.pools[key];
+    if (pool == nullptr) {
+        pool = acquirePool(key, counts, bindless, nullptr);
+    }
+
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(pool->mMutex);
+            if (pool->mAllocatedSets < pool->mTotalSets) {
+                allocInfo.descriptorPool = pool->mPool;
+                VkResult result = vkAllocateDescriptorSets(gfx().device, &allocInfo, descriptorSet);
+                if (result == VK_SUCCESS) {
+                    pool->mAllocatedSets++;
+                    return pool;
+                }
+
+                // a fragmented pool is left to drain like a full one, anything else is fatal
+                if ((result != VK_ERROR_FRAGMENTED_POOL && result != VK_ERROR_OUT_OF_POOL_MEMORY) || pool->mAllocatedSets == 0) {
+                    VK_CHECK_RESULT(result);
+                    return nullptr;
+                }
+            }
+        }
+
+        pool = acquirePool(key, counts, bindless, pool);
+    }
+}
+
+void DescriptorPoolManager::free(PoolInfo* pool, VkDescriptorSet descriptorSet)
 {
+    {
+        std::lock_guard<std::mutex> lock(pool->mMutex);
+        if (pool->mPool) {
+            vkFreeDescriptorSets(gfx().device, pool->mPool, 1, &descriptorSet);
+        }
+
+        assert(pool->mAllocatedSets > 0);
+        if (pool->mAllocatedSets > 1) {
+            pool->mAllocatedSets--;
+            return;
+        }
+    }
+
+    // The last set: once the count drops another thread may recycle or destroy the pool, so the
+    // count is dropped under the manager lock, taken before the pool's like recyclePool does.
+    // The set still counted keeps the pool alive until then.
     std::lock_guard<std::mutex> lock(mMutex);
-    for (auto& poolInfo : mPools) {
-        if (poolInfo.allocate(counts)) {
-            return poolInfo.pool();
+    {
+        std::lock_guard<std::mutex> poolLock(pool->mMutex);
+        if (--pool->mAllocatedSets > 0) {
+            return;
         }
     }
 
-    PoolInfo& newPool = createNewPool(counts, totalSets);
-    bool result = newPool.allocate(counts);
-    assert(result);
-    return newPool.pool();
+    if (!pool->mOwned && !pool->mIdle) {
+        recyclePool(pool);
+    }
 }
 
-void DescriptorPoolManager::free(const VkDescriptorPool& pool, const DescriptorResourceCounts& counts)
+PoolInfo* DescriptorPoolManager::acquirePool(size_t key, const DescriptorResourceCounts& counts, bool bindless, PoolInfo* fullPool)
 {
     std::lock_guard<std::mutex> lock(mMutex);
+    reclaimOrphanPools();
+    if (fullPool) {
+        fullPool->mOwned = false;
+    }
 
-    for (auto& poolInfo : mPools) {
-        if (poolInfo.pool() == pool) {
-            poolInfo.free(counts);
+    auto& bucket = mBuckets[key];
+    PoolInfo* pool = nullptr;
+    if (!bucket.idlePools.empty()) {
+        pool = bucket.idlePools.back();
+        bucket.idlePools.pop_back();
+        pool->mIdle = false;
+    } else {
+        // bindless sets hold thousands of descriptors, one per pool
+        uint32_t totalSets = bindless ? 1 : bucket.nextPoolSets;
+        bucket.nextPoolSets = std::min(bucket.nextPoolSets * 2, MAX_POOL_SETS);
+        pool = createNewPool(key, counts, totalSets);
+    }
+
+    pool->mOwned = true;
+    return pool;
+}
+
+void DescriptorPoolManager::reclaimOrphanPools()
+{
+    std::vector<PoolInfo*> orphans;
+    {
+        std::lock_guard<std::mutex> lock(sOrphanLock);
+        orphans.swap(sOrphanPools);
+    }
+
+    for (auto pool : orphans) {
+        pool->mOwned = false;
+        recyclePool(pool);
+    }
+}
+
+void DescriptorPoolManager::recyclePool(PoolInfo* pool)
+{
+    {
+        std::lock_guard<std::mutex> lock(pool->mMutex);
+        if (pool->mAllocatedSets > 0 || !pool->mPool) {
+            return;
         }
     }
+
+    auto& bucket = mBuckets[pool->mKey];
+    if (bucket.idlePools.size() >= MAX_IDLE_POOLS) {
+        destroyPool(pool);
+        return;
+    }
+
+    // every set is freed already, the reset only returns the pool to a clean, unfragmented state
+    vkResetDescriptorPool(gfx().device, pool->mPool, 0);
+    pool->mIdle = true;
+    bucket.idlePools.push_back(pool);
 }
 
-PoolInfo& DescriptorPoolManager::createNewPool(const DescriptorResourceCounts& counts, uint32_t totalSets)
+PoolInfo* DescriptorPoolManager::createNewPool(size_t key, const DescriptorResourceCounts& counts, uint32_t totalSets)
 {
     std::vector<VkDescriptorPoolSize> sizes; //[DESCRIPTOR_TYPE_COUNT];
     for (int i = 0; i < DESCRIPTOR_TYPE_COUNT; i++) {
@@ -72,44 +206,41 @@ PoolInfo& DescriptorPoolManager::createNewPool(const DescriptorResourceCounts& c
     poolCI.pPoolSizes = sizes.data();
 
     VkDescriptorPool descriptorPool;
-    vkCreateDescriptorPool(gfx().device, &poolCI, nullptr, &descriptorPool);
-    return mPools.emplace_back(descriptorPool, counts, totalSets);
+    VK_CHECK_RESULT(vkCreateDescriptorPool(gfx().device, &poolCI, nullptr, &descriptorPool));
+    return mPools.emplace_back(std::make_unique<PoolInfo>(descriptorPool, key, counts, totalSets)).get();
+}
+
+void DescriptorPoolManager::destroyPool(PoolInfo* pool)
+{
+    vkDestroyDescriptorPool(gfx().device, pool->mPool, nullptr);
+    std::erase_if(mPools, [pool](auto& p) { return p.get() == pool; });
 }
 
 void DescriptorPoolManager::destroyAll()
 {
+    std::lock_guard<std::mutex> lock(mMutex);
     for (auto& poolInfo : mPools) {
-        vkDestroyDescriptorPool(gfx().device, poolInfo.pool(), nullptr);
+        if (poolInfo->mPool) {
+            vkDestroyDescriptorPool(gfx().device, poolInfo->mPool, nullptr);
+            poolInfo->mPool = VK_NULL_HANDLE;
+        }
     }
 
-    mPools.clear();
+    // sets still alive only give their count back, the pools are gone; PoolInfos of those are kept
+    std::erase_if(mPools, [](auto& p) { return p->mAllocatedSets == 0; });
+    mBuckets.clear();
+
+    std::lock_guard<std::mutex> orphanLock(sOrphanLock);
+    sOrphanPools.clear();
+    sGeneration++;
 }
 
-PoolInfo::PoolInfo(const VkDescriptorPool& pool, const DescriptorResourceCounts& counts, uint32_t totalSets)
+PoolInfo::PoolInfo(const VkDescriptorPool& pool, size_t key, const DescriptorResourceCounts& counts, uint32_t totalSets)
 {
     mPool = pool;
+    mKey = key;
     mDescriptorCounts = counts;
-    mRemainingSets = totalSets;
+    mTotalSets = totalSets;
 }
 
-bool PoolInfo::allocate(const DescriptorResourceCounts& counts)
-{
-    if (mDescriptorCounts != counts) {
-        return false;
-    }
-
-    if (mRemainingSets <= 0) {
-        return false;
-    }
-
-    mRemainingSets -= 1;
-
-    return true;
-}
-
-void PoolInfo::free(const DescriptorResourceCounts& counts)
-{
-    mRemainingSets += 1;
 }
-
-}
\ No newline at end of file
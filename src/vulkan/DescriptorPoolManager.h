@@ -2,40 +2,72 @@
 
 #include "../GraphicsDefs.h"
 #include "VulkanDefs.h"
+#include <memory>
 #include <mutex>
+#include <unordered_map>
 #include <vector>
 
 namespace mygfx {
 
 class PoolInfo;
 
+// Descriptor pools bucketed by layout signature (the descriptor counts of one set).
+// Each thread allocates from its own pool per bucket, so threads only meet on the manager lock
+// when a pool runs full. A pool whose sets have all been freed is reset and kept for reuse, or
+// destroyed once enough idle pools of its bucket are kept.
 class DescriptorPoolManager {
 public:
     void init();
     void destroyAll();
 
-    VkDescriptorPool& getPool(const DescriptorResourceCounts& counts, uint32_t totalSets = 64);
-    void free(const VkDescriptorPool& pool, const DescriptorResourceCounts& counts);
+    // Allocates one set, allocInfo.descriptorPool is filled in. Returns the pool to free it with.
+    PoolInfo* allocate(const DescriptorResourceCounts& counts, bool bindless, VkDescriptorSetAllocateInfo& allocInfo, VkDescriptorSet* descriptorSet);
+    void free(PoolInfo* pool, VkDescriptorSet descriptorSet);
+
+    // idle pools kept per bucket, the rest are destroyed
+    static constexpr uint32_t MAX_IDLE_POOLS = 2;
+    // sets per pool, each new pool of a bucket doubles up to the max
+    static constexpr uint32_t MIN_POOL_SETS = 16;
+    static constexpr uint32_t MAX_POOL_SETS = 256;
 
 private:
-    PoolInfo& createNewPool(const DescriptorResourceCounts& counts, uint32_t totalSets);
-    std::vector<PoolInfo> mPools;
+    struct Bucket {
+        uint32_t nextPoolSets = MIN_POOL_SETS;
+        std::vector<PoolInfo*> idlePools;
+    };
+
+    PoolInfo* acquirePool(size_t key, const DescriptorResourceCounts& counts, bool bindless, PoolInfo* fullPool);
+    // called with the manager lock held, recycles the pools handed back by exited threads
+    void reclaimOrphanPools();
+    void recyclePool(PoolInfo* pool);
+    PoolInfo* createNewPool(size_t key, const DescriptorResourceCounts& counts, uint32_t totalSets);
+    void destroyPool(PoolInfo* pool);
+
+    std::vector<std::unique_ptr<PoolInfo>> mPools;
+    std::unordered_map<size_t, Bucket> mBuckets;
     std::mutex mMutex;
 };
 
 class PoolInfo {
 public:
-    PoolInfo(const VkDescriptorPool& pool, const DescriptorResourceCounts& counts, uint32_t totalSets);
-
-    bool allocate(const DescriptorResourceCounts& counts);
-    void free(const DescriptorResourceCounts& counts);
+    PoolInfo(const VkDescriptorPool& pool, size_t key, const DescriptorResourceCounts& counts, uint32_t totalSets);
 
     inline VkDescriptorPool& pool() { return mPool; }
 
 private:
     VkDescriptorPool mPool;
+    size_t mKey;
     DescriptorResourceCounts mDescriptorCounts { 0 };
-    uint32_t mRemainingSets;
+    uint32_t mTotalSets;
+
+    // guarded by mMutex, the pool itself must be externally synchronized
+    std::mutex mMutex;
+    uint32_t mAllocatedSets = 0;
+    // guarded by the manager lock: a thread allocates from it, or it waits in the idle list
+    bool mOwned = false;
+    bool mIdle = false;
+
+    friend class DescriptorPoolManager;
 };
 
 }
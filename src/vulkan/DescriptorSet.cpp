@@ -6,6 +6,21 @@
 
 namespace mygfx {
 
+static bool isImageDescriptor(VkDescriptorType descriptorType)
+{
+    return descriptorType == VK_DESCRIPTOR_TYPE_SAMPLER
+        || descriptorType == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER
+        || descriptorType == VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE
+        || descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE
+        || descriptorType == VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+}
+
+static bool isTexelBufferDescriptor(VkDescriptorType descriptorType)
+{
+    return descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER
+        || descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER;
+}
+
 VkDescriptorType toVk(DescriptorType descriptorType)
 {
     switch (descriptorType) {
@@ -71,14 +86,12 @@ void DescriptorSet::init(DescriptorSetLayout* layout)
 void DescriptorSet::create()
 {
     mDescriptorResourceCounts = mResourceLayout->sizeCounts();
-    mDescriptorPool = gfx().getDescriptorPools().getPool(mDescriptorResourceCounts);
 
     VkDescriptorSetVariableDescriptorCountAllocateInfo variableDescriptorCountAllocInfo {};
 
     VkDescriptorSetAllocateInfo allocInfo = {};
     allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
     allocInfo.pNext = nullptr;
-    allocInfo.descriptorPool = mDescriptorPool;
     allocInfo.descriptorSetCount = 1;
     allocInfo.pSetLayouts = &mResourceLayout->handle();
 
@@ -89,16 +102,37 @@ void DescriptorSet::create()
         allocInfo.pNext = &variableDescriptorCountAllocInfo;
     }
 
-    VK_CHECK_RESULT(vkAllocateDescriptorSets(gfx().device, &allocInfo, &handle_));
+    mDescriptorPool = gfx().getDescriptorPools().allocate(mDescriptorResourceCounts, mResourceLayout->isBindless, allocInfo, &handle_);
+
+    mUpdateTemplate = mResourceLayout->updateTemplate();
+    if (mUpdateTemplate) {
+        mDescriptorData.resize(mResourceLayout->numBindings());
+    }
 }
 
 void DescriptorSet::destroy()
 {
+    {
+        std::lock_guard<std::mutex> lock(gfx().getDescriptorWriteLock());
+        if (mPending) {
+            gfx().removePendingDescriptorSet(this);
+            mPending = false;
+        }
+
+        mPendingWrites.clear();
+        mImageInfos.clear();
+        mBufferInfos.clear();
+        mTexelBufferViews.clear();
+        mDescriptorData.clear();
+        mWrittenMask = 0;
+        mDirtyMask = 0;
+        mUpdateTemplate = VK_NULL_HANDLE;
+    }
+
     if (handle_) {
-        auto sizeCounts = mDescriptorResourceCounts;
-        auto dp = mDescriptorPool;
-        auto sets = handle_;
-        vkFreeDescriptorSets(gfx().device, dp, 1, &sets);
+        gfx().getDescriptorPools().free(mDescriptorPool, handle_);
+        mDescriptorPool = nullptr;
+        handle_ = VK_NULL_HANDLE;
     }
 }
 
@@ -117,6 +151,143 @@ const DescriptorSetLayoutBinding* DescriptorSet::getBinding(uint32_t index) cons
     return mResourceLayout->getBinding(index);
 }
 
+void DescriptorSet::markPending()
+{
+    if (!mPending) {
+        mPending = true;
+        gfx().addPendingDescriptorSet(this);
+    }
+}
+
+DescriptorData* DescriptorSet::stageTemplateWrite(uint32_t dstBinding, uint32_t dstArrayElement, uint32_t count)
+{
+    uint32_t index = 0;
+    if (!mUpdateTemplate || !mResourceLayout->findBinding(dstBinding, &index)) {
+        return nullptr;
+    }
+
+    // template layouts only have single descriptors
+    assert(dstArrayElement == 0 && count == 1);
+    mWrittenMask |= 1ull << index;
+    mDirtyMask |= 1ull << index;
+    markPending();
+    return &mDescriptorData[index];
+}
+
+void DescriptorSet::write(uint32_t dstBinding, uint32_t dstArrayElement, VkDescriptorType descriptorType, const VkDescriptorImageInfo* imageInfos, uint32_t count)
+{
+    std::lock_guard<std::mutex> lock(gfx().getDescriptorWriteLock());
+    if (auto data = stageTemplateWrite(dstBinding, dstArrayElement, count)) {
+        data->image = imageInfos[0];
+        return;
+    }
+
+    mPendingWrites.push_back(PendingWrite { dstBinding, dstArrayElement, count, descriptorType, (uint32_t)mImageInfos.size() });
+    mImageInfos.insert(mImageInfos.end(), imageInfos, imageInfos + count);
+    markPending();
+}
+
+void DescriptorSet::write(uint32_t dstBinding, uint32_t dstArrayElement, VkDescriptorType descriptorType, const VkDescriptorBufferInfo* bufferInfos, uint32_t count)
+{
+    std::lock_guard<std::mutex> lock(gfx().getDescriptorWriteLock());
+    if (auto data = stageTemplateWrite(dstBinding, dstArrayElement, count)) {
+        data->buffer = bufferInfos[0];
+        return;
+    }
+
+    mPendingWrites.push_back(PendingWrite { dstBinding, dstArrayElement, count, descriptorType, (uint32_t)mBufferInfos.size() });
+    mBufferInfos.insert(mBufferInfos.end(), bufferInfos, bufferInfos + count);
+    markPending();
+}
+
+void DescriptorSet::write(uint32_t dstBinding, uint32_t dstArrayElement, VkDescriptorType descriptorType, const VkBufferView* texelBufferViews, uint32_t count)
+{
+    std::lock_guard<std::mutex> lock(gfx().getDescriptorWriteLock());
+    if (auto data = stageTemplateWrite(dstBinding, dstArrayElement, count)) {
+        data->texelBufferView = texelBufferViews[0];
+        return;
+    }
+
+    mPendingWrites.push_back(PendingWrite { dstBinding, dstArrayElement, count, descriptorType, (uint32_t)mTexelBufferViews.size() });
+    mTexelBufferViews.insert(mTexelBufferViews.end(), texelBufferViews, texelBufferViews + count);
+    markPending();
+}
+
+void DescriptorSet::flush()
+{
+    mPending = false;
+    if (!handle_) {
+        return;
+    }
+
+    std::vector<VkWriteDescriptorSet> writes;
+
+    if (mUpdateTemplate) {
+        uint32_t numBindings = mResourceLayout->numBindings();
+        uint64_t allBindings = numBindings == 64 ? ~0ull : (1ull << numBindings) - 1;
+        if (mWrittenMask == allBindings) {
+            vkUpdateDescriptorSetWithTemplate(gfx().device, handle_, mUpdateTemplate, mDescriptorData.data());
+            mDirtyMask = 0;
+            return;
+        }
+
+        // until every binding has a descriptor the template would write garbage, write the dirty ones
+        for (uint32_t i = 0; i < numBindings; i++) {
+            if ((mDirtyMask & (1ull << i)) == 0) {
+                continue;
+            }
+
+            auto layoutBinding = mResourceLayout->getBinding(i);
+            VkWriteDescriptorSet& write = writes.emplace_back(VkWriteDescriptorSet {
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .dstSet = handle_,
+                .dstBinding = layoutBinding->binding,
+                .dstArrayElement = 0,
+                .descriptorCount = 1,
+                .descriptorType = toVk(layoutBinding->descriptorType),
+            });
+
+            if (isImageDescriptor(write.descriptorType)) {
+                write.pImageInfo = &mDescriptorData[i].image;
+            } else if (isTexelBufferDescriptor(write.descriptorType)) {
+                write.pTexelBufferView = &mDescriptorData[i].texelBufferView;
+            } else {
+                write.pBufferInfo = &mDescriptorData[i].buffer;
+            }
+        }
+        mDirtyMask = 0;
+    } else {
+        writes.reserve(mPendingWrites.size());
+        for (auto& pending : mPendingWrites) {
+            VkWriteDescriptorSet& write = writes.emplace_back(VkWriteDescriptorSet {
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .dstSet = handle_,
+                .dstBinding = pending.binding,
+                .dstArrayElement = pending.arrayElement,
+                .descriptorCount = pending.count,
+                .descriptorType = pending.descriptorType,
+            });
+
+            if (isImageDescriptor(pending.descriptorType)) {
+                write.pImageInfo = &mImageInfos[pending.offset];
+            } else if (isTexelBufferDescriptor(pending.descriptorType)) {
+                write.pTexelBufferView = &mTexelBufferViews[pending.offset];
+            } else {
+                write.pBufferInfo = &mBufferInfos[pending.offset];
+            }
+        }
+    }
+
+    if (!writes.empty()) {
+        vkUpdateDescriptorSets(gfx().device, (uint32_t)writes.size(), writes.data(), 0, nullptr);
+    }
+
+    mPendingWrites.clear();
+    mImageInfos.clear();
+    mBufferInfos.clear();
+    mTexelBufferViews.clear();
+}
+
 void DescriptorSet::bind(uint32_t dstBinding, const BufferInfo& buffer)
 {
     VulkanBuffer* vkBuffer = static_cast<VulkanBuffer*>(buffer.buffer);
@@ -130,13 +301,44 @@ void DescriptorSet::bind(uint32_t dstBinding, const BufferInfo& buffer)
 void DescriptorSet::bind(uint32_t dstBinding, HwTextureView* texView)
 {
     VulkanTextureView* vkTexView = static_cast<VulkanTextureView*>(texView);
-    bind(dstBinding, 0, vkTexView->descriptorInfo());
+    auto layoutBinding = mResourceLayout->findBinding(dstBinding);
+    if (layoutBinding && layoutBinding->descriptorType == DescriptorType::STORAGE_IMAGE) {
+        // storage images are accessed in the general layout
+        VkDescriptorImageInfo imageInfo = vkTexView->descriptorInfo();
+        imageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+        bind(dstBinding, 0, imageInfo);
+    } else {
+        bind(dstBinding, 0, vkTexView->descriptorInfo());
+    }
+
+    trackImage(dstBinding, vkTexView);
 }
 
 void DescriptorSet::bind(uint32_t dstBinding, HwTexture* tex)
 {
     VulkanTexture* vkTex = static_cast<VulkanTexture*>(tex);
-    bind(dstBinding, 0, vkTex->srv()->descriptorInfo());
+    bind(dstBinding, vkTex->srv());
+}
+
+void DescriptorSet::trackImage(uint32_t dstBinding, VulkanTextureView* view)
+{
+    auto layoutBinding = mResourceLayout->findBinding(dstBinding);
+    if (!layoutBinding || view->texture() == nullptr) {
+        return;
+    }
+
+    ResourceState state = layoutBinding->descriptorType == DescriptorType::STORAGE_IMAGE ? ResourceState::UNORDERED_ACCESS : ResourceState::SHADER_RESOURCE;
+
+    std::lock_guard<std::mutex> lock(gfx().getDescriptorWriteLock());
+    for (auto& image : mBoundImages) {
+        if (image.binding == dstBinding) {
+            image.view = view;
+            image.state = state;
+            return;
+        }
+    }
+
+    mBoundImages.push_back({ dstBinding, view, state });
 }
 
 void DescriptorSet::bind(uint32_t dstBinding, HwBuffer* buffer)
@@ -147,201 +349,110 @@ void DescriptorSet::bind(uint32_t dstBinding, HwBuffer* buffer)
 
 DescriptorSet& DescriptorSet::bind(uint32_t dstBinding, const DescriptorInfo& descriptorInfo)
 {
-    auto layoutBinding = mResourceLayout->getBinding(dstBinding);
+    auto layoutBinding = mResourceLayout->findBinding(dstBinding);
     if (!layoutBinding) {
         LOG_WARNING("Cannot find DescriptorSetLayoutBinding : {}", dstBinding);
         return *this;
     }
 
-    VkWriteDescriptorSet wds {
-        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-        .dstSet = handle_,
-        .dstBinding = dstBinding,
-        .dstArrayElement = 0,
-        .descriptorCount = 1,
-        .descriptorType = toVk(layoutBinding->descriptorType)
-    };
-
+    VkDescriptorType descriptorType = toVk(layoutBinding->descriptorType);
     switch (descriptorInfo.index()) {
     case 0:
-        wds.pImageInfo = &(VkDescriptorImageInfo&)descriptorInfo;
+        write(dstBinding, 0, descriptorType, &std::get<VkDescriptorImageInfo>(descriptorInfo), 1);
         break;
     case 1:
-        wds.pBufferInfo = &(VkDescriptorBufferInfo&)descriptorInfo;
+        write(dstBinding, 0, descriptorType, &std::get<VkDescriptorBufferInfo>(descriptorInfo), 1);
         break;
     case 2:
-        wds.pTexelBufferView = &(VkBufferView&)descriptorInfo;
-        break;
-    case 3:
-        auto& imageInfos = (std::vector<VkDescriptorImageInfo>&)descriptorInfo;
-        wds.pImageInfo = imageInfos.data();
-        wds.descriptorCount = (uint32_t)imageInfos.size();
+        write(dstBinding, 0, descriptorType, &std::get<VkBufferView>(descriptorInfo), 1);
         break;
+    case 3: {
+        auto& imageInfos = std::get<std::vector<VkDescriptorImageInfo>>(descriptorInfo);
+        write(dstBinding, 0, descriptorType, imageInfos.data(), (uint32_t)imageInfos.size());
+    } break;
+    case 4: {
+        auto& bufferInfos = std::get<std::vector<VkDescriptorBufferInfo>>(descriptorInfo);
+        write(dstBinding, 0, descriptorType, bufferInfos.data(), (uint32_t)bufferInfos.size());
+    } break;
     }
 
-    vkUpdateDescriptorSets(gfx().device, 1, &wds, 0, nullptr);
     return *this;
 }
 
 DescriptorSet& DescriptorSet::bind(uint32_t dstBinding, const Span<VkDescriptorImageInfo>& imageInfos)
 {
-    auto layoutBinding = mResourceLayout->getBinding(dstBinding);
-    if (!layoutBinding) {
-        LOG_WARNING("Cannot find DescriptorSetLayoutBinding : {}", dstBinding);
-        return *this;
-    }
-
-    VkWriteDescriptorSet write;
-    write = {};
-    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    write.pNext = NULL;
-    write.dstSet = handle_;
-    write.descriptorCount = (uint32_t)imageInfos.size();
-    write.descriptorType = toVk(layoutBinding->descriptorType);
-    write.pImageInfo = imageInfos.data();
-    write.dstBinding = dstBinding;
-    write.dstArrayElement = 0;
-
-    vkUpdateDescriptorSets(gfx().device, 1, &write, 0, NULL);
-
-    return *this;
+    return bind(dstBinding, imageInfos.data(), (uint32_t)imageInfos.size());
 }
 
 DescriptorSet& DescriptorSet::bind(uint32_t dstBinding, const VkDescriptorImageInfo* imageInfo, uint32_t count)
 {
-    auto layoutBinding = mResourceLayout->getBinding(dstBinding);
+    auto layoutBinding = mResourceLayout->findBinding(dstBinding);
     if (!layoutBinding) {
         LOG_WARNING("Cannot find DescriptorSetLayoutBinding : {}", dstBinding);
         return *this;
     }
 
-    VkWriteDescriptorSet write;
-    write = {};
-    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    write.pNext = NULL;
-    write.dstSet = handle_;
-    write.descriptorCount = count;
-    write.descriptorType = toVk(layoutBinding->descriptorType);
-    write.pImageInfo = imageInfo;
-    write.dstBinding = dstBinding;
-    write.dstArrayElement = 0;
-
-    vkUpdateDescriptorSets(gfx().device, 1, &write, 0, NULL);
+    write(dstBinding, 0, toVk(layoutBinding->descriptorType), imageInfo, count);
     return *this;
 }
 
 DescriptorSet& DescriptorSet::bind(uint32_t dstBinding, const VkDescriptorBufferInfo* bufferInfo, uint32_t count)
 {
-    auto layoutBinding = mResourceLayout->getBinding(dstBinding);
+    auto layoutBinding = mResourceLayout->findBinding(dstBinding);
     if (!layoutBinding) {
         LOG_WARNING("Cannot find DescriptorSetLayoutBinding : {}", dstBinding);
         return *this;
     }
 
-    VkWriteDescriptorSet write;
-    write = {};
-    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    write.pNext = NULL;
-    write.dstSet = handle_;
-    write.descriptorCount = count;
-    write.descriptorType = toVk(layoutBinding->descriptorType);
-    write.pBufferInfo = bufferInfo;
-    write.dstBinding = dstBinding;
-    write.dstArrayElement = 0;
-
-    vkUpdateDescriptorSets(gfx().device, 1, &write, 0, NULL);
+    write(dstBinding, 0, toVk(layoutBinding->descriptorType), bufferInfo, count);
     return *this;
 }
 
 DescriptorSet& DescriptorSet::bind(uint32_t dstBinding, const VkBufferView* bufferView, uint32_t count)
 {
-    auto layoutBinding = mResourceLayout->getBinding(dstBinding);
+    auto layoutBinding = mResourceLayout->findBinding(dstBinding);
     if (!layoutBinding) {
         LOG_WARNING("Cannot find DescriptorSetLayoutBinding : {}", dstBinding);
         return *this;
     }
 
-    VkWriteDescriptorSet write;
-    write = {};
-    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    write.pNext = NULL;
-    write.dstSet = handle_;
-    write.descriptorCount = count;
-    write.descriptorType = toVk(layoutBinding->descriptorType);
-    write.pTexelBufferView = bufferView;
-    write.dstBinding = dstBinding;
-    write.dstArrayElement = 0;
-
-    vkUpdateDescriptorSets(gfx().device, 1, &write, 0, NULL);
+    write(dstBinding, 0, toVk(layoutBinding->descriptorType), bufferView, count);
     return *this;
 }
 
 DescriptorSet& DescriptorSet::bind(uint32_t dstBinding, uint32_t dstArrayElement, const VkDescriptorImageInfo& imageInfo)
 {
-    auto layoutBinding = mResourceLayout->getBinding(dstBinding);
+    auto layoutBinding = mResourceLayout->findBinding(dstBinding);
     if (!layoutBinding) {
         LOG_WARNING("Cannot find DescriptorSetLayoutBinding : {}", dstBinding);
         return *this;
     }
 
-    VkWriteDescriptorSet write;
-    write = {};
-    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    write.pNext = NULL;
-    write.dstSet = handle_;
-    write.descriptorCount = 1;
-    write.descriptorType = toVk(layoutBinding->descriptorType);
-    write.pImageInfo = &imageInfo;
-    write.dstBinding = dstBinding;
-    write.dstArrayElement = dstArrayElement;
-
-    vkUpdateDescriptorSets(gfx().device, 1, &write, 0, NULL);
+    write(dstBinding, dstArrayElement, toVk(layoutBinding->descriptorType), &imageInfo, 1);
     return *this;
 }
 
 DescriptorSet& DescriptorSet::bind(uint32_t dstBinding, uint32_t dstArrayElement, const VkDescriptorBufferInfo& bufferInfo)
 {
-    auto layoutBinding = mResourceLayout->getBinding(dstBinding);
+    auto layoutBinding = mResourceLayout->findBinding(dstBinding);
     if (!layoutBinding) {
         LOG_WARNING("Cannot find DescriptorSetLayoutBinding : {}", dstBinding);
         return *this;
     }
 
-    VkWriteDescriptorSet write;
-    write = {};
-    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    write.pNext = NULL;
-    write.dstSet = handle_;
-    write.descriptorCount = 1;
-    write.descriptorType = toVk(layoutBinding->descriptorType);
-    write.pBufferInfo = &bufferInfo;
-    write.dstBinding = dstBinding;
-    write.dstArrayElement = dstArrayElement;
-
-    vkUpdateDescriptorSets(gfx().device, 1, &write, 0, NULL);
+    write(dstBinding, dstArrayElement, toVk(layoutBinding->descriptorType), &bufferInfo, 1);
     return *this;
 }
 
 DescriptorSet& DescriptorSet::bind(uint32_t dstBinding, uint32_t dstArrayElement, const VkBufferView& bufferView)
 {
-    auto layoutBinding = mResourceLayout->getBinding(dstBinding);
+    auto layoutBinding = mResourceLayout->findBinding(dstBinding);
     if (!layoutBinding) {
         LOG_WARNING("Cannot find DescriptorSetLayoutBinding : {}", dstBinding);
         return *this;
     }
 
-    VkWriteDescriptorSet write;
-    write = {};
-    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    write.pNext = NULL;
-    write.dstSet = handle_;
-    write.descriptorCount = 1;
-    write.descriptorType = toVk(layoutBinding->descriptorType);
-    write.pTexelBufferView = &bufferView;
-    write.dstBinding = dstBinding;
-    write.dstArrayElement = dstArrayElement;
-
-    vkUpdateDescriptorSets(gfx().device, 1, &write, 0, NULL);
+    write(dstBinding, dstArrayElement, toVk(layoutBinding->descriptorType), &bufferView, 1);
     return *this;
 }
 
@@ -352,18 +463,7 @@ void DescriptorSet::bind(uint32_t dstBinding, VkImageView imageView, VkSampler p
     desc_image.imageView = imageView;
     desc_image.imageLayout = imageLayout;
 
-    VkWriteDescriptorSet write;
-    write = {};
-    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    write.pNext = NULL;
-    write.dstSet = handle_;
-    write.descriptorCount = 1;
-    write.descriptorType = (pSampler == NULL) ? VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    write.pImageInfo = &desc_image;
-    write.dstBinding = dstBinding;
-    write.dstArrayElement = 0;
-
-    vkUpdateDescriptorSets(gfx().device, 1, &write, 0, NULL);
+    write(dstBinding, 0, (pSampler == NULL) ? VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &desc_image, 1);
 }
 
 void DescriptorSet::bind(uint32_t dstBinding, VkImageView imageView)
@@ -373,18 +473,7 @@ void DescriptorSet::bind(uint32_t dstBinding, VkImageView imageView)
     desc_image.imageView = imageView;
     desc_image.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
 
-    VkWriteDescriptorSet write;
-    write = {};
-    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    write.pNext = NULL;
-    write.dstSet = handle_;
-    write.descriptorCount = 1;
-    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-    write.pImageInfo = &desc_image;
-    write.dstBinding = dstBinding;
-    write.dstArrayElement = 0;
-
-    vkUpdateDescriptorSets(gfx().device, 1, &write, 0, NULL);
+    write(dstBinding, 0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, &desc_image, 1);
 }
 
 void DescriptorSet::bind(uint32_t dstBinding, uint32_t descriptorsCount, const std::vector<Ref<HwTexture>>& imageViews)
@@ -402,23 +491,12 @@ void DescriptorSet::bind(uint32_t dstBinding, uint32_t descriptorsCount, const s
         desc_images[i].imageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
     }
 
-    VkWriteDescriptorSet write;
-    write = {};
-    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    write.pNext = NULL;
-    write.dstSet = handle_;
-    write.descriptorCount = descriptorsCount;
-    write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    write.pImageInfo = desc_images.data();
-    write.dstBinding = dstBinding;
-    write.dstArrayElement = 0;
-
-    vkUpdateDescriptorSets(gfx().device, 1, &write, 0, NULL);
+    write(dstBinding, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, desc_images.data(), descriptorsCount);
 }
 
 void DescriptorSet::bind(uint32_t dstBinding, uint32_t size)
 {
-    auto layoutBinding = mResourceLayout->getBinding(dstBinding);
+    auto layoutBinding = mResourceLayout->findBinding(dstBinding);
     if (!layoutBinding) {
         LOG_WARNING("Cannot find DescriptorSetLayoutBinding : {}", dstBinding);
         return;
@@ -435,18 +513,7 @@ void DescriptorSet::bind(uint32_t dstBinding, uint32_t size)
     out.offset = 0;
     out.range = size;
 
-    VkWriteDescriptorSet write;
-    write = {};
-    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    write.pNext = NULL;
-    write.dstSet = handle_;
-    write.descriptorCount = 1;
-    write.descriptorType = toVk(layoutBinding->descriptorType);
-    write.pBufferInfo = &out;
-    write.dstArrayElement = 0;
-    write.dstBinding = dstBinding;
-
-    vkUpdateDescriptorSets(gfx().device, 1, &write, 0, NULL);
+    write(dstBinding, 0, toVk(layoutBinding->descriptorType), &out, 1);
 }
 
 }
@@ -7,6 +7,8 @@
 namespace mygfx {
 
 class DescriptorSet;
+class PoolInfo;
+class VulkanTextureView;
 
 using DescriptorInfo = std::variant<VkDescriptorImageInfo, VkDescriptorBufferInfo,
     VkBufferView, std::vector<VkDescriptorImageInfo>, std::vector<VkDescriptorBufferInfo>>;
@@ -48,15 +50,60 @@ public:
 
     void destroy();
 
+    // Applies the writes staged by bind() in one call, see VulkanDevice::flushDescriptorWrites.
+    // Called with the device's descriptor write lock held.
+    void flush();
+
     uint32_t dynamicBufferSize[8] = { 0 };
 
+    // Textures bound by bind(binding, HwTextureView/HwTexture) and the state the set reads them in.
+    // Compute dispatches transition them when the set is bound, guarded by the descriptor write lock.
+    struct BoundImage {
+        uint32_t binding;
+        VulkanTextureView* view;
+        ResourceState state;
+    };
+
+    const std::vector<BoundImage>& getBoundImages() const { return mBoundImages; }
+
 private:
     DescriptorSet& bind(uint32_t dstBinding, const Span<VkDescriptorImageInfo>& imageInfos);
     void create();
 
-    VkDescriptorPool mDescriptorPool;
+    void write(uint32_t dstBinding, uint32_t dstArrayElement, VkDescriptorType descriptorType, const VkDescriptorImageInfo* imageInfos, uint32_t count);
+    void write(uint32_t dstBinding, uint32_t dstArrayElement, VkDescriptorType descriptorType, const VkDescriptorBufferInfo* bufferInfos, uint32_t count);
+    void write(uint32_t dstBinding, uint32_t dstArrayElement, VkDescriptorType descriptorType, const VkBufferView* texelBufferViews, uint32_t count);
+    DescriptorData* stageTemplateWrite(uint32_t dstBinding, uint32_t dstArrayElement, uint32_t count);
+    void markPending();
+    void trackImage(uint32_t dstBinding, VulkanTextureView* view);
+
+    PoolInfo* mDescriptorPool = nullptr;
     DescriptorResourceCounts mDescriptorResourceCounts = { 0 };
     Ref<DescriptorSetLayout> mResourceLayout;
+
+    // Layouts with an update template keep the last descriptor of every binding and rewrite the
+    // whole set with it once all bindings have one.
+    VkDescriptorUpdateTemplate mUpdateTemplate = VK_NULL_HANDLE;
+    std::vector<DescriptorData> mDescriptorData;
+    uint64_t mWrittenMask = 0;
+    uint64_t mDirtyMask = 0;
+
+    // Other layouts queue plain writes, offset points into the info array matching the type.
+    struct PendingWrite {
+        uint32_t binding;
+        uint32_t arrayElement;
+        uint32_t count;
+        VkDescriptorType descriptorType;
+        uint32_t offset;
+    };
+
+    std::vector<PendingWrite> mPendingWrites;
+    std::vector<VkDescriptorImageInfo> mImageInfos;
+    std::vector<VkDescriptorBufferInfo> mBufferInfos;
+    std::vector<VkBufferView> mTexelBufferViews;
+    bool mPending = false;
+
+    std::vector<BoundImage> mBoundImages;
 };
 
 }
@@ -72,6 +72,59 @@ DescriptorSetLayoutBinding* DescriptorSetLayout::getBinding(uint32_t index)
     return nullptr;
 }
 
+const DescriptorSetLayoutBinding* DescriptorSetLayout::findBinding(uint32_t binding, uint32_t* index) const
+{
+    if (binding >= mBindingIndices.size() || mBindingIndices[binding] == 0) {
+        return nullptr;
+    }
+
+    uint32_t i = mBindingIndices[binding] - 1;
+    if (index) {
+        *index = i;
+    }
+    return &mDSLayoutbindings[i];
+}
+
+VkDescriptorUpdateTemplate DescriptorSetLayout::updateTemplate() const
+{
+    if (mUpdateTemplateChecked) {
+        return mUpdateTemplate;
+    }
+
+    mUpdateTemplateChecked = true;
+    if (isBindless || mDSLayoutbindings.empty() || mDSLayoutbindings.size() > MAX_TEMPLATE_BINDINGS) {
+        return VK_NULL_HANDLE;
+    }
+
+    std::vector<VkDescriptorUpdateTemplateEntry> entries;
+    entries.reserve(mDSLayoutbindings.size());
+    for (auto& binding : mDSLayoutbindings) {
+        if (binding.descriptorCount != 1) {
+            return VK_NULL_HANDLE;
+        }
+
+        entries.push_back(VkDescriptorUpdateTemplateEntry {
+            .dstBinding = binding.binding,
+            .dstArrayElement = 0,
+            .descriptorCount = 1,
+            .descriptorType = (VkDescriptorType)binding.descriptorType,
+            .offset = entries.size() * sizeof(DescriptorData),
+            .stride = sizeof(DescriptorData),
+        });
+    }
+
+    VkDescriptorUpdateTemplateCreateInfo createInfo {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO,
+        .descriptorUpdateEntryCount = (uint32_t)entries.size(),
+        .pDescriptorUpdateEntries = entries.data(),
+        .templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET,
+        .descriptorSetLayout = handle(),
+    };
+
+    VK_CHECK_RESULT(vkCreateDescriptorUpdateTemplate(gfx().device, &createInfo, nullptr, &mUpdateTemplate));
+    return mUpdateTemplate;
+}
+
 ShaderStage DescriptorSetLayout::shaderStageFlags() const
 {
     if (mDSLayoutbindings.size() > 0) {
@@ -148,17 +201,30 @@ void DescriptorSetLayout::create() const
 
     if (mHandle) {
         auto handle = mHandle;
+        auto updateTemplate = mUpdateTemplate;
         gfx().post([=]() {
+            if (updateTemplate) {
+                vkDestroyDescriptorUpdateTemplate(gfx().device, updateTemplate, nullptr);
+            }
             vkDestroyDescriptorSetLayout(gfx().device, handle, nullptr);
         });
 
         mDescriptorResourceCounts.fill(0);
+        mUpdateTemplate = VK_NULL_HANDLE;
+        mUpdateTemplateChecked = false;
     }
 
     VK_CHECK_RESULT(vkCreateDescriptorSetLayout(gfx().device, &layoutInfo, nullptr, &mHandle));
 
-    for (auto& binding : mDSLayoutbindings) {
+    mBindingIndices.clear();
+    for (uint32_t i = 0; i < mDSLayoutbindings.size(); i++) {
+        auto& binding = mDSLayoutbindings[i];
         mDescriptorResourceCounts[(int)binding.descriptorType] += binding.descriptorCount;
+
+        if (binding.binding >= mBindingIndices.size()) {
+            mBindingIndices.resize(binding.binding + 1);
+        }
+        mBindingIndices[binding.binding] = (uint16_t)(i + 1);
     }
 }
 
@@ -166,12 +232,18 @@ void DescriptorSetLayout::destroy()
 {
     if (mHandle) {
         auto handle = mHandle;
+        auto updateTemplate = mUpdateTemplate;
         gfx().post([=]() {
+            if (updateTemplate) {
+                vkDestroyDescriptorUpdateTemplate(gfx().device, updateTemplate, nullptr);
+            }
             vkDestroyDescriptorSetLayout(gfx().device, handle, nullptr);
         });
 
         mDescriptorResourceCounts.fill(0);
         mHandle = nullptr;
+        mUpdateTemplate = VK_NULL_HANDLE;
+        mUpdateTemplateChecked = false;
     }
 }
 
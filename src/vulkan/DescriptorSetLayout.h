@@ -7,6 +7,13 @@
 
 namespace mygfx {
 
+// One descriptor as laid out for vkUpdateDescriptorSetWithTemplate.
+union DescriptorData {
+    VkDescriptorImageInfo image;
+    VkDescriptorBufferInfo buffer;
+    VkBufferView texelBufferView;
+};
+
 class DescriptorSetLayout : public HwObject {
 public:
     DescriptorSetLayout();
@@ -25,6 +32,13 @@ public:
     const DescriptorSetLayoutBinding* getBinding(const String& name) const;
     const DescriptorSetLayoutBinding* getBinding(uint32_t index) const;
     DescriptorSetLayoutBinding* getBinding(uint32_t index);
+    // by binding number rather than index, index receives the position in the layout
+    const DescriptorSetLayoutBinding* findBinding(uint32_t binding, uint32_t* index = nullptr) const;
+
+    // Updates every binding from an array of DescriptorData, one per binding in layout order.
+    // VK_NULL_HANDLE for bindless layouts, arrays and layouts with more than MAX_TEMPLATE_BINDINGS.
+    VkDescriptorUpdateTemplate updateTemplate() const;
+    static constexpr uint32_t MAX_TEMPLATE_BINDINGS = 64;
 
     ShaderStage shaderStageFlags() const;
 
@@ -41,6 +55,10 @@ public:
 private:
     void create() const;
     mutable VkDescriptorSetLayout mHandle = nullptr;
+    mutable VkDescriptorUpdateTemplate mUpdateTemplate = VK_NULL_HANDLE;
+    mutable bool mUpdateTemplateChecked = false;
+    // binding number -> index + 1, 0 when the binding is not in the layout
+    mutable std::vector<uint16_t> mBindingIndices;
     std::vector<DescriptorSetLayoutBinding> mDSLayoutbindings;
     mutable std::vector<VkDescriptorBindingFlags> mDescriptorBindingFlags;
     std::vector<uint32_t> mVariableDescCounts;
@@ -120,7 +120,19 @@ void DescriptorTable::init()
     descriptorSetLayoutTex->defineDescriptorTable(mDescriptorType, ShaderStage::VERTEX | ShaderStage::FRAGMENT | ShaderStage::COMPUTE);
     addDescriptorSet(descriptorSetLayoutTex);
 
-    mDescriptorInfos[0] = std::vector<VkDescriptorImageInfo>();
+    mCapacity = gfx().getMaxVariableCount((VkDescriptorType)mDescriptorType);
+    mNextFree = std::make_unique<std::atomic<uint32_t>[]>(mCapacity);
+
+    if (isBufferTable()) {
+        mDescriptorInfos[0] = std::vector<VkDescriptorBufferInfo>();
+    } else {
+        mDescriptorInfos[0] = std::vector<VkDescriptorImageInfo>();
+    }
+}
+
+bool DescriptorTable::isBufferTable() const
+{
+    return mDescriptorType == DescriptorType::STORAGE_BUFFER || mDescriptorType == DescriptorType::UNIFORM_BUFFER;
 }
 
 DescriptorSet* DescriptorTable::fragmentSet()
@@ -128,116 +140,186 @@ DescriptorSet* DescriptorTable::fragmentSet()
     return mFragmentSet;
 }
 
-int DescriptorTable::add(const VkDescriptorBufferInfo& descriptorInfo, bool update)
+int DescriptorTable::allocateSlot()
 {
-    std::lock_guard locker(mMutex);
-    std::vector<VkDescriptorBufferInfo>& imageInfos = std::get<std::vector<VkDescriptorBufferInfo>>(mDescriptorInfos[0]);
-    int index;
-    if (mFreeIndics.size() > 0) {
-        index = mFreeIndics.back();
-        mFreeIndics.pop_back();
-        imageInfos[index] = descriptorInfo;
-    } else {
-        index = (int)imageInfos.size();
-        imageInfos.push_back(descriptorInfo);
+    uint64_t head = mFreeHead.load(std::memory_order_acquire);
+    while ((uint32_t)head != INVALID_SLOT) {
+        uint32_t index = (uint32_t)head;
+        uint64_t next = ((head >> 32) + 1) << 32 | mNextFree[index].load(std::memory_order_relaxed);
+        if (mFreeHead.compare_exchange_weak(head, next, std::memory_order_acquire, std::memory_order_acquire)) {
+            return (int)index;
+        }
     }
 
-    for (auto& it : mDescriptorSets) {
-        it.second->bind(0, index, imageInfos[index]);
+    uint32_t index = mSlotCount.fetch_add(1, std::memory_order_relaxed);
+    if (index >= mCapacity) {
+        mSlotCount.fetch_sub(1, std::memory_order_relaxed);
+        LOG_ERROR("Descriptor table is full, capacity : {}", mCapacity);
+        return -1;
     }
 
+    return (int)index;
+}
+
+void DescriptorTable::pushFreeSlot(uint32_t index)
+{
+    uint64_t head = mFreeHead.load(std::memory_order_relaxed);
+    uint64_t next;
+    do {
+        mNextFree[index].store((uint32_t)head, std::memory_order_relaxed);
+        next = ((head >> 32) + 1) << 32 | index;
+    } while (!mFreeHead.compare_exchange_weak(head, next, std::memory_order_release, std::memory_order_relaxed));
+}
+
+void DescriptorTable::queueWrite(const SlotWrite& write)
+{
+    mPendingWrites.enqueue(write);
+    mHasPendingWrites.store(true, std::memory_order_release);
+    gfx().markDescriptorTablesDirty();
+}
+
+int DescriptorTable::add(const VkDescriptorBufferInfo& descriptorInfo, bool update)
+{
+    assert(isBufferTable());
+    int index = allocateSlot();
+    if (index < 0) {
+        return index;
+    }
+
+    SlotWrite write { index, true };
+    write.bufferInfo = descriptorInfo;
+    queueWrite(write);
     return index;
 }
 
 void DescriptorTable::update(int index, const VkDescriptorBufferInfo& descriptorInfo)
 {
     assert(index >= 0);
-    std::lock_guard locker(mMutex);
+    assert(isBufferTable());
 
-    std::vector<VkDescriptorBufferInfo>& imageInfos = std::get<std::vector<VkDescriptorBufferInfo>>(mDescriptorInfos[0]);
-    if (std::memcmp(&imageInfos[index], &descriptorInfo, sizeof(VkDescriptorBufferInfo)) != 0) {
-        imageInfos[index] = descriptorInfo;
-
-        for (auto& it : mDescriptorSets) {
-            it.second->bind(0, index, imageInfos[index]);
-        }
-    }
+    SlotWrite write { index, true };
+    write.bufferInfo = descriptorInfo;
+    queueWrite(write);
 }
 
 int DescriptorTable::add(const VkDescriptorImageInfo& descriptorInfo, bool update)
 {
-    std::lock_guard locker(mMutex);
-    std::vector<VkDescriptorImageInfo>& imageInfos = std::get<std::vector<VkDescriptorImageInfo>>(mDescriptorInfos[0]);
-    int index;
-    if (mFreeIndics.size() > 0) {
-        index = mFreeIndics.back();
-        mFreeIndics.pop_back();
-        imageInfos[index] = descriptorInfo;
-    } else {
-        index = (int)imageInfos.size();
-        imageInfos.push_back(descriptorInfo);
-    }
-
-    for (auto& it : mDescriptorSets) {
-        it.second->bind(0, index, imageInfos[index]);
+    assert(!isBufferTable());
+    int index = allocateSlot();
+    if (index < 0) {
+        return index;
     }
 
+    SlotWrite write { index, false };
+    write.imageInfo = descriptorInfo;
+    queueWrite(write);
     return index;
 }
 
 void DescriptorTable::update(int index, const VkDescriptorImageInfo& descriptorInfo)
 {
     assert(index >= 0);
-    std::lock_guard locker(mMutex);
-
-    std::vector<VkDescriptorImageInfo>& imageInfos = std::get<std::vector<VkDescriptorImageInfo>>(mDescriptorInfos[0]);
-    if (std::memcmp(&imageInfos[index], &descriptorInfo, sizeof(VkDescriptorImageInfo)) != 0) {
-        imageInfos[index] = descriptorInfo;
+    assert(!isBufferTable());
 
-        for (auto& it : mDescriptorSets) {
-            it.second->bind(0, index, imageInfos[index]);
-        }
-    }
+    SlotWrite write { index, false };
+    write.imageInfo = descriptorInfo;
+    queueWrite(write);
 }
 
 void DescriptorTable::free(int index)
 {
     if (index >= 0) {
-        std::lock_guard locker(mMutex);
+        mPendingFrees.enqueue(index);
+        mHasPendingWrites.store(true, std::memory_order_release);
+        gfx().markDescriptorTablesDirty();
+    }
+}
+
+void DescriptorTable::flush(uint64_t retireValue, uint64_t completedValue)
+{
+    CHECK_RENDER_THREAD();
 
-        if (mDescriptorType == DescriptorType::STORAGE_BUFFER || mDescriptorType == DescriptorType::UNIFORM_BUFFER) {
+    // no submit that could still reference these slots is pending on the GPU
+    while (!mRetiredSlots.empty() && mRetiredSlots.front().timelineValue <= completedValue) {
+        pushFreeSlot((uint32_t)mRetiredSlots.front().index);
+        mRetiredSlots.pop_front();
+    }
+
+    if (!mHasPendingWrites.exchange(false, std::memory_order_acq_rel)) {
+        return;
+    }
 
-            std::vector<VkDescriptorBufferInfo>& bufferInfos = std::get<std::vector<VkDescriptorBufferInfo>>(mDescriptorInfos[0]);
+    // frees are taken first: the write of a slot is always queued before its free, so every slot
+    // freed here also has its writes in this batch and the placeholder is written last
+    int freeIndex;
+    while (mPendingFrees.try_dequeue(freeIndex)) {
+        mFreeScratch.push_back(freeIndex);
+    }
 
-            bufferInfos[index] = {};            
+    SlotWrite write;
+    while (mPendingWrites.try_dequeue(write)) {
+        mWriteScratch.push_back(write);
+    }
 
-            for (auto& it : mDescriptorSets) {
-                it.second->bind(0, index, bufferInfos[index]);
-            }
+    VkDescriptorImageInfo freeImageInfo {};
+    if (!isBufferTable() && HwTexture::Magenta) {
+        VulkanTexture* vkTex = static_cast<VulkanTexture*>(HwTexture::Magenta.get());
+        freeImageInfo = vkTex->srv()->descriptorInfo();
+    }
+
+    for (int index : mFreeScratch) {
+        SlotWrite freeWrite { index, isBufferTable() };
+        if (freeWrite.isBuffer) {
+            freeWrite.bufferInfo = {};
         } else {
-            std::vector<VkDescriptorImageInfo>& imageInfos = std::get<std::vector<VkDescriptorImageInfo>>(mDescriptorInfos[0]);
+            freeWrite.imageInfo = freeImageInfo;
+        }
+        mWriteScratch.push_back(freeWrite);
+        mRetiredSlots.push_back({ index, retireValue });
+    }
 
-            if (HwTexture::Magenta) {
-                VulkanTexture* vkTex = static_cast<VulkanTexture*>(HwTexture::Magenta.get());
-                imageInfos[index] = vkTex->srv()->descriptorInfo();
+    std::lock_guard locker(mMutex);
+    for (auto& w : mWriteScratch) {
+        // the shadow copy initializes layout variants created later
+        if (w.isBuffer) {
+            auto& bufferInfos = std::get<std::vector<VkDescriptorBufferInfo>>(mDescriptorInfos[0]);
+            if (w.index >= (int)bufferInfos.size()) {
+                bufferInfos.resize(w.index + 1);
+            } else if (std::memcmp(&bufferInfos[w.index], &w.bufferInfo, sizeof(VkDescriptorBufferInfo)) == 0) {
+                continue;
             }
-
-            for (auto& it : mDescriptorSets) {
-                it.second->bind(0, index, imageInfos[index]);
+            bufferInfos[w.index] = w.bufferInfo;
+        } else {
+            auto& imageInfos = std::get<std::vector<VkDescriptorImageInfo>>(mDescriptorInfos[0]);
+            if (w.index >= (int)imageInfos.size()) {
+                imageInfos.resize(w.index + 1);
+            } else if (std::memcmp(&imageInfos[w.index], &w.imageInfo, sizeof(VkDescriptorImageInfo)) == 0) {
+                continue;
             }
-
+            imageInfos[w.index] = w.imageInfo;
         }
 
-        mFreeIndics.push_back(index);
+        for (auto& it : mDescriptorSets) {
+            if (w.isBuffer) {
+                it.second->bind(0, w.index, w.bufferInfo);
+            } else {
+                it.second->bind(0, w.index, w.imageInfo);
+            }
+        }
     }
+
+    mWriteScratch.clear();
+    mFreeScratch.clear();
 }
 
 void DescriptorTable::clear()
 {
     std::lock_guard locker(mMutex);
     mDescriptorInfos.clear();
-    mFreeIndics.clear();
     mDescriptorSets.clear();
+    mRetiredSlots.clear();
+    mFreeHead.store(INVALID_SLOT);
+    mSlotCount.store(0);
 }
 
 SamplerTable::SamplerTable()
@@ -263,14 +345,34 @@ void SamplerTable::init()
 }
 
 Ref<SamplerHandle> SamplerTable::createSampler(SamplerInfo info)
-{    
-    std::lock_guard locker(mMutex);
-    for (int i = 0; i < mSamplers.size(); i++) {
-        if (mSamplers[i]->samplerInfo == info) {
-            return mSamplers[i];
+{
+    return Ref<SamplerHandle>(findOrCreateSampler(info));
+}
+
+int SamplerTable::getSamplerIndex(SamplerInfo info)
+{
+    return findOrCreateSampler(info)->index;
+}
+
+VulkanSampler* SamplerTable::findOrCreateSampler(SamplerInfo info)
+{
+    auto key = info.key();
+    {
+        std::shared_lock locker(mSamplerMutex);
+        auto it = mSamplerIndices.find(key);
+        if (it != mSamplerIndices.end()) {
+            return mSamplers[it->second];
         }
     }
-    
+
+    std::unique_lock samplerLocker(mSamplerMutex);
+    // another thread may have created it in between
+    auto it = mSamplerIndices.find(key);
+    if (it != mSamplerIndices.end()) {
+        return mSamplers[it->second];
+    }
+
+    std::lock_guard locker(mMutex);
     std::vector<VkDescriptorImageInfo>& imageInfos = std::get<std::vector<VkDescriptorImageInfo>>(mDescriptorInfos[0]);
 
     int index = (int)imageInfos.size();
@@ -278,7 +380,8 @@ Ref<SamplerHandle> SamplerTable::createSampler(SamplerInfo info)
 
     VulkanSampler* s = new VulkanSampler(info);
     mSamplers.emplace_back(s);
-    
+    mSamplerIndices.emplace(key, (uint32_t)index);
+
     VkDescriptorImageInfo descriptorInfo {};
     descriptorInfo.sampler = s->vkSampler;
     descriptorInfo.imageView = VK_NULL_HANDLE;
@@ -292,7 +395,7 @@ Ref<SamplerHandle> SamplerTable::createSampler(SamplerInfo info)
 
     s->index = index;
 
-    return Ref<SamplerHandle>(s);
+    return s;
 }
 
 void SamplerTable::update(int index, const VkDescriptorImageInfo& descriptorInfo)
@@ -312,9 +415,11 @@ void SamplerTable::update(int index, const VkDescriptorImageInfo& descriptorInfo
 
 void SamplerTable::clear()
 {
+    std::unique_lock samplerLocker(mSamplerMutex);
     std::lock_guard locker(mMutex);
     mDescriptorInfos.clear();
     mDescriptorSets.clear();
     mSamplers.clear();
+    mSamplerIndices.clear();
 }
 }
@@ -1,7 +1,11 @@
 #pragma once
 #include "DescriptorSet.h"
+#include "utils/concurrentqueue.h"
+#include <atomic>
+#include <deque>
 #include <map>
 #include <mutex>
+#include <shared_mutex>
 #include <unordered_map>
 
 namespace mygfx {
@@ -39,6 +43,11 @@ protected:
     std::unordered_map<size_t, Ref<DescriptorSet>> mDescriptorSets;
 };
 
+// Bindless table of one descriptor type. Slots are handed out from a lock-free free list and
+// the descriptor writes are queued, so add/update/free can be called from any thread without
+// taking a lock. flush() applies the queued writes to every layout variant on the render thread.
+// A freed slot goes back to the free list only once the graphics timeline passed the submit of
+// the frame that freed it.
 class DescriptorTable : public ResourceSet {
 public:
     DescriptorTable(DescriptorType descriptorType);
@@ -51,12 +60,52 @@ public:
     int add(const VkDescriptorImageInfo& descriptorInfo, bool update = true);
     void update(int index, const VkDescriptorImageInfo& descriptorInfo);
     void free(int index);
+
+    // render thread, retireValue is the graphics timeline value the frame being recorded signals,
+    // completedValue the one the GPU reached
+    void flush(uint64_t retireValue, uint64_t completedValue);
+    bool hasPendingWrites() const { return mHasPendingWrites.load(std::memory_order_acquire); }
+
 private:
+    struct SlotWrite {
+        int index;
+        bool isBuffer;
+        union {
+            VkDescriptorImageInfo imageInfo;
+            VkDescriptorBufferInfo bufferInfo;
+        };
+    };
+
+    struct RetiredSlot {
+        int index;
+        uint64_t timelineValue;
+    };
+
+    static constexpr uint32_t INVALID_SLOT = 0xffffffff;
+
+    bool isBufferTable() const;
+    int allocateSlot();
+    void pushFreeSlot(uint32_t index);
+    void queueWrite(const SlotWrite& write);
     void clear();
     DescriptorSet* fragmentSet();
     DescriptorType mDescriptorType = DescriptorType::COMBINED_IMAGE_SAMPLER;
-    std::vector<int> mFreeIndics;
     Ref<DescriptorSet> mFragmentSet;
+
+    uint32_t mCapacity = 0;
+    // free list head, the upper 32 bits are a tag against ABA
+    std::atomic<uint64_t> mFreeHead = INVALID_SLOT;
+    std::unique_ptr<std::atomic<uint32_t>[]> mNextFree;
+    // slots never handed out start here
+    std::atomic<uint32_t> mSlotCount = 0;
+
+    moodycamel::ConcurrentQueue<SlotWrite> mPendingWrites;
+    moodycamel::ConcurrentQueue<int> mPendingFrees;
+    std::atomic<bool> mHasPendingWrites = false;
+    // render thread only
+    std::deque<RetiredSlot> mRetiredSlots;
+    std::vector<SlotWrite> mWriteScratch;
+    std::vector<int> mFreeScratch;
 };
 
 class SamplerTable : public ResourceSet {
@@ -67,14 +116,21 @@ public:
     void init();
     
     Ref<SamplerHandle> createSampler(SamplerInfo info);
+    // index of the sampler in the table, created on first use
+    int getSamplerIndex(SamplerInfo info);
 
 private:
+    VulkanSampler* findOrCreateSampler(SamplerInfo info);
     void update(int index, const VkDescriptorImageInfo& descriptorInfo);
     void clear();
 
     DescriptorType mDescriptorType = DescriptorType::SAMPLER;
     Ref<DescriptorSet> mFragmentSet;
     Vector<Ref<VulkanSampler>> mSamplers;
+    // SamplerInfo::key() to index in mSamplers
+    std::unordered_map<uint32_t, uint32_t> mSamplerIndices;
+    // guards mSamplers and mSamplerIndices, always taken before mMutex
+    std::shared_mutex mSamplerMutex;
 };
 
 }
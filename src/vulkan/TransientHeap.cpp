@@ -0,0 +1,133 @@
+#include "TransientHeap.h"
+#include "../utils/Log.h"
+
+namespace mygfx {
+
+void TransientHeap::init(VmaAllocator allocator, const VkPhysicalDeviceMemoryProperties& memoryProperties)
+{
+    VmaAllocatorInfo allocatorInfo;
+    vmaGetAllocatorInfo(allocator, &allocatorInfo);
+    mAllocator = allocator;
+    mDevice = allocatorInfo.device;
+    mLazilyAllocated = false;
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+        if (memoryProperties.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) {
+            mLazilyAllocated = true;
+            break;
+        }
+    }
+}
+
+void TransientHeap::destroy()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (auto& it : mBlocks) {
+        if (it.second.imageCount > 0) {
+            LOG_WARNING("TransientHeap: block still used by {} images", it.second.imageCount);
+        }
+        vmaFreeMemory(mAllocator, it.second.allocation);
+    }
+
+    mBlocks.clear();
+    for (auto& block : mLaneBlocks) {
+        block = VK_NULL_HANDLE;
+    }
+}
+
+VkResult TransientHeap::createImage(const VkImageCreateInfo& createInfo, const char* name, VkImage* pImage, VmaAllocation* pAllocation)
+{
+    if (mLazilyAllocated) {
+        VmaAllocationCreateInfo allocCreateInfo = {};
+        allocCreateInfo.usage = VMA_MEMORY_USAGE_GPU_LAZILY_ALLOCATED;
+        allocCreateInfo.flags = VMA_ALLOCATION_CREATE_USER_DATA_COPY_STRING_BIT;
+        allocCreateInfo.pUserData = (void*)name;
+        return vmaCreateImage(mAllocator, &createInfo, &allocCreateInfo, pImage, pAllocation, nullptr);
+    }
+
+    VkResult res = vkCreateImage(mDevice, &createInfo, nullptr, pImage);
+    if (res != VK_SUCCESS) {
+        return res;
+    }
+
+    VkMemoryRequirements memReq;
+    vkGetImageMemoryRequirements(mDevice, *pImage, &memReq);
+
+    Lane lane = (createInfo.usage & VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT) ? DEPTH_STENCIL : COLOR;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    Block* block = nullptr;
+    if (mLaneBlocks[lane] != VK_NULL_HANDLE) {
+        // blocks are dedicated allocations, offset 0 satisfies any alignment
+        block = &mBlocks[mLaneBlocks[lane]];
+        if (memReq.size > block->size || (memReq.memoryTypeBits & (1u << block->memoryType)) == 0) {
+            // replaced, an unused block is freed now, a used one with its last image
+            if (block->imageCount == 0) {
+                vmaFreeMemory(mAllocator, block->allocation);
+                mBlocks.erase(mLaneBlocks[lane]);
+            }
+            mLaneBlocks[lane] = VK_NULL_HANDLE;
+            block = nullptr;
+        }
+    }
+
+    if (block == nullptr) {
+        VmaAllocationCreateInfo allocCreateInfo = {};
+        allocCreateInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+        allocCreateInfo.flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+
+        VmaAllocation allocation;
+        VmaAllocationInfo allocInfo;
+        res = vmaAllocateMemory(mAllocator, &memReq, &allocCreateInfo, &allocation, &allocInfo);
+        if (res != VK_SUCCESS) {
+            vkDestroyImage(mDevice, *pImage, nullptr);
+            *pImage = VK_NULL_HANDLE;
+            return res;
+        }
+
+        block = &mBlocks[allocation];
+        block->allocation = allocation;
+        block->size = memReq.size;
+        block->memoryType = allocInfo.memoryType;
+        mLaneBlocks[lane] = allocation;
+    }
+
+    res = vmaBindImageMemory(mAllocator, block->allocation, *pImage);
+    if (res != VK_SUCCESS) {
+        LOG_ERROR("TransientHeap: failed to bind {}", name ? name : "");
+        vkDestroyImage(mDevice, *pImage, nullptr);
+        *pImage = VK_NULL_HANDLE;
+        return res;
+    }
+
+    block->imageCount++;
+    *pAllocation = block->allocation;
+    return VK_SUCCESS;
+}
+
+void TransientHeap::destroyImage(VkImage image, VmaAllocation allocation)
+{
+    if (mLazilyAllocated) {
+        vmaDestroyImage(mAllocator, image, allocation);
+        return;
+    }
+
+    vkDestroyImage(mDevice, image, nullptr);
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto it = mBlocks.find(allocation);
+    if (it == mBlocks.end() || --it->second.imageCount > 0) {
+        return;
+    }
+
+    // the lane keeps its block for the next transient attachment
+    for (auto& block : mLaneBlocks) {
+        if (block == allocation) {
+            return;
+        }
+    }
+
+    vmaFreeMemory(mAllocator, allocation);
+    mBlocks.erase(it);
+}
+
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "../GraphicsDefs.h"
+#include "VulkanDefs.h"
+#include <mutex>
+#include <unordered_map>
+
+namespace mygfx {
+
+// Memory for transient attachments (TextureUsage::TRANSIENT_ATTACHMENT), whose contents only live
+// inside the pass that renders them. Where the device has lazily allocated memory (tilers) each
+// image gets its own lazily allocated allocation, which is not backed unless the driver needs it.
+// Elsewhere the images alias: all transient color attachments are bound at offset 0 of one shared
+// block, and so are all transient depth stencil attachments. A block is replaced by a bigger one
+// when an image does not fit, and freed with its last image unless it is still the current one.
+//
+// A render target can use one transient attachment of each kind, two of the same kind would
+// overwrite each other.
+class TransientHeap {
+public:
+    void init(VmaAllocator allocator, const VkPhysicalDeviceMemoryProperties& memoryProperties);
+    void destroy();
+
+    VkResult createImage(const VkImageCreateInfo& createInfo, const char* name, VkImage* pImage, VmaAllocation* pAllocation);
+    void destroyImage(VkImage image, VmaAllocation allocation);
+
+    bool hasLazilyAllocatedMemory() const { return mLazilyAllocated; }
+    // true when images of the allocation share their memory, the first use of each must wait
+    // for the writes of the others
+    bool isAliased(VmaAllocation allocation) const { return !mLazilyAllocated && allocation != VK_NULL_HANDLE; }
+
+private:
+    enum Lane {
+        COLOR,
+        DEPTH_STENCIL,
+        LANE_COUNT
+    };
+
+    struct Block {
+        VmaAllocation allocation = VK_NULL_HANDLE;
+        VkDeviceSize size = 0;
+        uint32_t memoryType = 0;
+        uint32_t imageCount = 0;
+    };
+
+    VmaAllocator mAllocator = VK_NULL_HANDLE;
+    VkDevice mDevice = VK_NULL_HANDLE;
+    bool mLazilyAllocated = false;
+
+    std::mutex mMutex;
+    // the block new images of a lane are bound to
+    VmaAllocation mLaneBlocks[LANE_COUNT] {};
+    std::unordered_map<VmaAllocation, Block> mBlocks;
+};
+
+}
@@ -75,46 +75,40 @@ void UploadHeap::finish()
 // SuballocateFromUploadHeap
 //
 //--------------------------------------------------------------------------------------
-uint8_t* UploadHeap::Suballocate(uint64_t uSize, uint64_t uAlign)
+bool UploadHeap::fits(uint64_t uSize, uint64_t uAlign) const
 {
-    // wait until we are done flusing the heap
-    flushing.Wait();
-
-    uint8_t* pRet = NULL;
-
-    {
-        std::unique_lock<std::mutex> lock(m_mutex);
-
-        // make sure resource (and its mips) would fit the upload heap, if not please make the upload heap bigger
-        assert(uSize < (uint64_t)(m_pDataEnd - m_pDataBegin));
+    uint8_t* pDataCur = reinterpret_cast<uint8_t*>(utils::alignUp(reinterpret_cast<uint64_t>(m_pDataCur), uAlign));
+    return pDataCur < m_pDataEnd && pDataCur + utils::alignUp(uSize, uAlign) < m_pDataEnd;
+}
 
-        m_pDataCur = reinterpret_cast<uint8_t*>(utils::alignUp(reinterpret_cast<uint64_t>(m_pDataCur), uAlign));
-        uSize = utils::alignUp(uSize, uAlign);
+uint8_t* UploadHeap::Suballocate(uint64_t uSize, uint64_t uAlign)
+{
+    // make sure resource (and its mips) would fit the upload heap, if not please make the upload heap bigger
+    assert(uSize < (uint64_t)(m_pDataEnd - m_pDataBegin));
 
-        // return NULL if we ran out of space in the heap
-        if ((m_pDataCur >= m_pDataEnd) || (m_pDataCur + uSize >= m_pDataEnd)) {
-            return NULL;
+    for (;;) {
+        // wait until we are done flusing the heap
+        flushing.Wait();
+
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+
+            if (fits(uSize, uAlign)) {
+                m_pDataCur = reinterpret_cast<uint8_t*>(utils::alignUp(reinterpret_cast<uint64_t>(m_pDataCur), uAlign));
+                uint8_t* pRet = m_pDataCur;
+                m_pDataCur += utils::alignUp(uSize, uAlign);
+                return pRet;
+            }
         }
 
-        pRet = m_pDataCur;
-        m_pDataCur += uSize;
+        // we ran out of space in the heap, start over from the beginning once the gpu is done with it
+        rewind(uSize, uAlign);
     }
-
-    return pRet;
 }
 
 uint8_t* UploadHeap::BeginSuballocate(uint64_t uSize, uint64_t uAlign)
 {
-    uint8_t* pRes = NULL;
-
-    for (;;) {
-        pRes = Suballocate(uSize, uAlign);
-        if (pRes != NULL) {
-            break;
-        }
-
-        FlushAndFinish();
-    }
+    uint8_t* pRes = Suballocate(uSize, uAlign);
 
     allocating.Inc();
 
@@ -180,7 +174,13 @@ void UploadHeap::FlushAndFinish()
 
     // LOG_INFO("flushing {}", m_copies.size());
 
-    gfx().executeCommand(CommandQueueType::Copy, [this](const CommandBuffer& cmd) {
+    if (m_copies.empty() && m_toPreBarrier.empty() && m_toPostBarrier.empty()) {
+        flushing.Dec();
+        return;
+    }
+
+    // recorded into the device upload batch, the heap stays in use until that batch retires
+    m_uploadBatch = gfx().recordUpload([this](const CommandBuffer& cmd) {
         // apply pre barriers in one go
         if (m_toPreBarrier.size() > 0) {
             vkCmdPipelineBarrier(cmd.cmd, VK_PIPELINE_STAGE_HOST_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, (uint32_t)m_toPreBarrier.size(), m_toPreBarrier.data());
@@ -200,7 +200,26 @@ void UploadHeap::FlushAndFinish()
         }
     });
 
-    m_pDataCur = m_pDataBegin;
+    flushing.Dec();
+}
+
+void UploadHeap::rewind(uint64_t uSize, uint64_t uAlign)
+{
+    FlushAndFinish();
+
+    flushing.Wait();
+    flushing.Inc();
+    allocating.Wait();
+
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        // another thread may have rewound the heap in the meantime
+        if (!fits(uSize, uAlign)) {
+            gfx().waitUploads(m_uploadBatch);
+            m_pDataCur = m_pDataBegin;
+        }
+    }
 
     flushing.Dec();
 }
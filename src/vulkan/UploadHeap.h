@@ -53,7 +53,8 @@ public:
 //
 // This class shows the most efficient way to upload resources to the GPU memory.
 // The idea is to create just one upload heap and suballocate memory from it.
-// For convenience this class comes with it's own command list & submit (FlushAndFinish)
+// FlushAndFinish records the pending copies into the device upload batch without waiting, the heap
+// only starts over from the beginning (and waits for the GPU) once it runs out of space.
 //
 class UploadHeap {
 public:
@@ -78,6 +79,9 @@ public:
     void finish();
 
 private:
+    bool fits(uint64_t uSize, uint64_t uAlign) const;
+    void rewind(uint64_t uSize, uint64_t uAlign);
+
     VkBuffer m_buffer;
     VkDeviceMemory m_deviceMemory;
 
@@ -97,5 +101,6 @@ private:
     std::vector<VkImageMemoryBarrier> m_toPostBarrier;
     std::mutex m_mutex;
     std::atomic<bool> batchUpdate = false;
+    uint64_t m_uploadBatch = 0;
 };
 }
\ No newline at end of file
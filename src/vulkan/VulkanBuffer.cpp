@@ -11,7 +11,7 @@ VulkanBuffer::VulkanBuffer(BufferUsage usage, MemoryUsage memoryUsage, uint64_t
 	this->stride = stride;
 	this->memoryUsage = memoryUsage;
 
-	VkBufferUsageFlags flags = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	VkBufferUsageFlags flags = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
 	if ((usage & BufferUsage::VERTEX) != BufferUsage::NONE) {
 		flags |= VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
 	}
@@ -74,6 +74,8 @@ VulkanBuffer::VulkanBuffer(BufferUsage usage, MemoryUsage memoryUsage, uint64_t
 			initState(ResourceState::COPY_DEST);
 		}
 		setData(data, size, 0);
+	} else {
+		initState(ResourceState::UNDEFINED);
 	}
 
 	descriptor.buffer = buffer;
@@ -121,20 +123,12 @@ void VulkanBuffer::setData(const void* data, VkDeviceSize size, VkDeviceSize off
 		auto stage = gfx().getStagePool().acquireStage(data, size);
 
 		VkBufferCopy copyRegion = {};
+		copyRegion.dstOffset = offset;
 		copyRegion.size = size;
 
-		if (ThreadUtils::isThisThread(gfx().renderThreadID) || gfx().enalbeAsyncCopy()) {
-			gfx().executeCommand(CommandQueueType::Copy, [=](auto& c) {
-				vkCmdCopyBuffer(c.cmd, stage->buffer, buffer, 1, &copyRegion);
-				});
-		} else {
-			gfx().post_async([=]() {
-				gfx().executeCommand(CommandQueueType::Copy, [=](auto& c) {
-					vkCmdCopyBuffer(c.cmd, stage->buffer, buffer, 1, &copyRegion);
-					});
-				});
-
-		}
+		gfx().recordUpload([=](auto& c) {
+			vkCmdCopyBuffer(c.cmd, stage->buffer, buffer, 1, &copyRegion);
+			});
 	}
 }
 
@@ -5,12 +5,15 @@
 #include "VulkanDevice.h"
 #include "VulkanBuffer.h"
 #include "VulkanHandles.h"
+#include "VulkanShader.h"
 #include "VulkanStagePool.h"
 #include "VulkanSwapchain.h"
 #include "VulkanTextureView.h"
 #include "api/CommandStreamDispatcher.h"
+#include "utils/FileUtils.h"
 #include "utils/Log.h"
 #include "vulkan/VulkanTexture.h"
+#include <fstream>
 #include <unordered_set>
 
 #define VMA_STATIC_VULKAN_FUNCTIONS 0
@@ -37,6 +40,8 @@ VulkanDevice::VulkanDevice()
 
 VulkanDevice::~VulkanDevice()
 {
+    // GraphicsApi::destroy deletes the device, tear everything down here
+    destroy();
 }
 
 bool VulkanDevice::create(const Settings& settings)
@@ -53,9 +58,24 @@ bool VulkanDevice::create(const Settings& settings)
     // Ensures that the image is displayed before we start submitting new commands to the queue
     VK_CHECK_RESULT(vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &mPresentComplete));
 
+    if (settings.shaderCachePath) {
+        mShaderCachePath = settings.shaderCachePath;
+        if (!utils::FileUtils::createDirectories(mShaderCachePath)) {
+            LOG_WARNING("Can't create the shader cache dir {}", mShaderCachePath);
+        }
+        ShaderReflection::setCacheDir(mShaderCachePath);
+    }
+
+    if (settings.pipelineCachePath) {
+        mPipelineCachePath = settings.pipelineCachePath;
+    }
+
+    createPipelineCache();
+
     mDescriptorPoolManager.init();
 
     mStagePool = new VulkanStagePool(mVmaAllocator);
+    mTransientHeap.init(mVmaAllocator, memoryProperties);
 
     mSamplerSet = new SamplerTable();
     mTextureSet = new DescriptorTable(DescriptorType::COMBINED_IMAGE_SAMPLER);
@@ -69,12 +89,19 @@ bool VulkanDevice::create(const Settings& settings)
     mCommandQueues[1].init(CommandQueueType::Compute, queueFamilyIndices.compute, 0, 3, "");
     mCommandQueues[2].init(CommandQueueType::Copy, queueFamilyIndices.transfer, copyQueueFamilyProperties().queueCount > 1 ? 1 : 0, 3, "");
 
+    mJobSystem = std::make_unique<JobSystem>(settings.workerThreadCount);
+    for (uint32_t i = 0; i < mJobSystem->getWorkerCount(); i++) {
+        mSecondaryCommandPools.emplace_back(std::make_unique<SecondaryCommandPool>(queueFamilyIndices.graphics));
+    }
+    mMultiThreadedDrawThreshold = settings.multiThreadedDrawThreshold;
+
     SamplerHandle::init();
 
     // Create a 'dynamic' constant buffer
     const uint32_t constantBuffersMemSize = 32 * 1024 * 1024;
+    // uniforms are addressed by their offset in the one ring buffer, so it can't grow
     mConstantBufferRing.create(BufferUsage::UNIFORM | BufferUsage::STORAGE | BufferUsage::SHADER_DEVICE_ADDRESS,
-        constantBuffersMemSize, MAX_BACKBUFFER_COUNT, constantBuffersMemSize, "Uniforms");
+        MAX_BACKBUFFER_COUNT, constantBuffersMemSize, "Uniforms", false);
 #if LARGE_DYNAMIC_INDEX
     const uint32_t vertexBuffersMemSize = 64 * 1024 * 1024;
 #else
@@ -98,26 +125,66 @@ const char* VulkanDevice::getDeviceName() const
     return properties.deviceName;
 }
 
-void VulkanDevice::updateDynamicDescriptorSet(int index, uint32_t size, VkDescriptorSet descriptorSet)
+void VulkanDevice::updateDynamicDescriptorSet(int index, uint32_t size, DescriptorSet& descriptorSet)
 {
     VulkanBuffer* vkBuffer = (VulkanBuffer*)mConstantBufferRing.getBuffer();
     VkDescriptorBufferInfo out = {};
     out.buffer = vkBuffer->buffer;
     out.offset = 0;
     out.range = size;
+    descriptorSet.bind(index, 0, out);
+}
+
+void VulkanDevice::updateInstanceDataDescriptorSet(int index, DescriptorSet& descriptorSet)
+{
+    // the whole ring, instance tables and the uniforms they point at live anywhere in it
+    VulkanBuffer* vkBuffer = (VulkanBuffer*)mConstantBufferRing.getBuffer();
+    VkDescriptorBufferInfo out = {};
+    out.buffer = vkBuffer->buffer;
+    out.offset = 0;
+    out.range = VK_WHOLE_SIZE;
+    descriptorSet.bind(index, 0, out);
+}
+
+void VulkanDevice::addPendingDescriptorSet(DescriptorSet* ds)
+{
+    mPendingDescriptorSets.push_back(ds);
+    mHasPendingDescriptorSets.store(true, std::memory_order_release);
+}
 
-    VkWriteDescriptorSet write;
-    write = {};
-    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    write.pNext = NULL;
-    write.dstSet = descriptorSet;
-    write.descriptorCount = 1;
-    write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
-    write.pBufferInfo = &out;
-    write.dstArrayElement = 0;
-    write.dstBinding = index;
+void VulkanDevice::removePendingDescriptorSet(DescriptorSet* ds)
+{
+    std::erase(mPendingDescriptorSets, ds);
+}
+
+void VulkanDevice::flushDescriptorTables()
+{
+    mHasDirtyDescriptorTables.store(false, std::memory_order_release);
+
+    // slots freed now may still be bound by the frame being recorded, they retire with its submit
+    auto& queue = mCommandQueues[(int)CommandQueueType::Graphics];
+    uint64_t retireValue = queue.getNextSubmitValue();
+    uint64_t completedValue = queue.getCompletedValue();
+    mTextureSet->flush(retireValue, completedValue);
+    mSampledImageTable->flush(retireValue, completedValue);
+    mStorageImageTable->flush(retireValue, completedValue);
+    mStorageBufferTable->flush(retireValue, completedValue);
+}
+
+void VulkanDevice::flushPendingDescriptorSets()
+{
+    // the tables stage their writes into their descriptor sets, which are flushed below
+    if (mHasDirtyDescriptorTables.load(std::memory_order_acquire)) {
+        flushDescriptorTables();
+    }
+
+    std::lock_guard<std::mutex> lock(mDescriptorWriteLock);
+    for (auto ds : mPendingDescriptorSets) {
+        ds->flush();
+    }
 
-    vkUpdateDescriptorSets(gfx().device, 1, &write, 0, NULL);
+    mPendingDescriptorSets.clear();
+    mHasPendingDescriptorSets.store(false, std::memory_order_release);
 }
 
 CommandBuffer* VulkanDevice::getCommandBuffer(CommandQueueType queueType, uint32_t count)
@@ -130,15 +197,89 @@ void VulkanDevice::freeCommandBuffer(CommandBuffer* cmd)
     mCommandQueues[(int)cmd->getCommandQueueType()].freeCommandBuffer(cmd);
 }
 
-void VulkanDevice::executeCommand(CommandQueueType queueType, const std::function<void(const CommandBuffer&)>& fn)
+uint64_t VulkanDevice::submit(const CommandBuffer& cmd, VkSemaphore signalSemaphore, VkSemaphore waitSemaphore, int useEndOfFrameSemaphore)
+{
+    auto queueType = cmd.getCommandQueueType();
+    // copy queue work is ordered behind the uploads by the queue itself and only recordUpload uses it
+    assert(queueType != CommandQueueType::Copy);
+
+    uint64_t uploadSemaphoreValue = 0;
+    {
+        std::lock_guard<std::mutex> lock(mUploadLock);
+        flushUploadsLocked();
+        uploadSemaphoreValue = mUploadSemaphoreValue;
+    }
+
+    auto& queue = mCommandQueues[(int)queueType];
+    if (uploadSemaphoreValue > mUploadSemaphoreWaited[(int)queueType]) {
+        queue.waitQueue(mCommandQueues[(int)CommandQueueType::Copy], uploadSemaphoreValue);
+        mUploadSemaphoreWaited[(int)queueType] = uploadSemaphoreValue;
+    }
+
+    return queue.submit(&cmd.cmd, 1, signalSemaphore, waitSemaphore, useEndOfFrameSemaphore);
+}
+
+uint64_t VulkanDevice::recordUpload(const std::function<void(const CommandBuffer&)>& fn)
+{
+    std::lock_guard<std::mutex> lock(mUploadLock);
+    if (mUploadCmd == nullptr) {
+        mUploadCmd = getCommandBuffer(CommandQueueType::Copy);
+        mUploadCmd->begin();
+    }
+
+    fn(*mUploadCmd);
+    return mUploadBatchId;
+}
+
+void VulkanDevice::flushUploads()
+{
+    std::lock_guard<std::mutex> lock(mUploadLock);
+    flushUploadsLocked();
+}
+
+void VulkanDevice::flushUploadsLocked()
+{
+    retireUploads(false);
+
+    if (mUploadCmd == nullptr) {
+        return;
+    }
+
+    mUploadCmd->end();
+    mUploadSemaphoreValue = mCommandQueues[(int)CommandQueueType::Copy].submit(&mUploadCmd->cmd, 1, VK_NULL_HANDLE, VK_NULL_HANDLE);
+    mUploadsInFlight.push_back({ mUploadCmd, mUploadSemaphoreValue });
+    mUploadCmd = nullptr;
+    mUploadBatchId++;
+}
+
+void VulkanDevice::waitUploads(uint64_t batchId)
+{
+    uint64_t semaphoreValue = 0;
+    {
+        std::lock_guard<std::mutex> lock(mUploadLock);
+        if (batchId == mUploadBatchId) {
+            flushUploadsLocked();
+        }
+
+        // copy queue submits complete in order, the latest value covers every earlier batch
+        semaphoreValue = mUploadSemaphoreValue;
+    }
+
+    mCommandQueues[(int)CommandQueueType::Copy].wait(semaphoreValue);
+}
+
+void VulkanDevice::retireUploads(bool waitAll)
 {
-    auto cmd = getCommandBuffer(queueType);
-    cmd->begin();
-    fn(*cmd);
-    cmd->end();
-    uint64_t waitValue = mCommandQueues[(int)queueType].submit(&cmd->cmd, 1, VK_NULL_HANDLE, VK_NULL_HANDLE);
-    mCommandQueues[(int)queueType].wait(waitValue);
-    freeCommandBuffer(cmd);
+    auto& copyQueue = mCommandQueues[(int)CommandQueueType::Copy];
+    if (waitAll && !mUploadsInFlight.empty()) {
+        copyQueue.wait(mUploadsInFlight.back().semaphoreValue);
+    }
+
+    uint64_t completedValue = copyQueue.getCompletedValue();
+    while (!mUploadsInFlight.empty() && mUploadsInFlight.front().semaphoreValue <= completedValue) {
+        freeCommandBuffer(mUploadsInFlight.front().cmd);
+        mUploadsInFlight.pop_front();
+    }
 }
 
 void VulkanDevice::resize(HwSwapchain* sc, uint32_t destWidth, uint32_t destHeight)
@@ -159,11 +300,19 @@ void VulkanDevice::resize(HwSwapchain* sc, uint32_t destWidth, uint32_t destHeig
 
 void VulkanDevice::destroy()
 {
-    // Flush device to make sure all resources can be freed
-    if (device != VK_NULL_HANDLE) {
-        vkDeviceWaitIdle(device);
+    // never created or already destroyed
+    if (device == VK_NULL_HANDLE) {
+        return;
     }
 
+    // Flush device to make sure all resources can be freed
+    flushUploads();
+    vkDeviceWaitIdle(device);
+
+    // finish background pipeline compiles and hand their results over before anything is released
+    mJobSystem.reset();
+    executePostCommands();
+
     HwObject::gc(true);
 
     // Clean up Vulkan resources
@@ -171,6 +320,9 @@ void VulkanDevice::destroy()
 
     vkDestroySemaphore(device, mPresentComplete, nullptr);
 
+    savePipelineCache();
+    vkDestroyPipelineCache(device, mPipelineCache, nullptr);
+
     mTextureSet.reset();
     mSamplerSet.reset();
     mSampledImageTable.reset();
@@ -186,6 +338,16 @@ void VulkanDevice::destroy()
     mStagePool->terminate();
     delete mStagePool;
 
+    // transient attachments were released by the gc above, the blocks left are the lanes' current ones
+    mTransientHeap.destroy();
+
+    mSecondaryCommandPools.clear();
+
+    {
+        std::lock_guard<std::mutex> lock(mUploadLock);
+        retireUploads(true);
+    }
+
     mCommandQueues[0].release();
     mCommandQueues[1].release();
     mCommandQueues[2].release();
@@ -193,6 +355,103 @@ void VulkanDevice::destroy()
     VulkanDeviceHelper::destroy();
 }
 
+// written in front of the vulkan cache data
+struct PipelineCacheFileHeader {
+    static constexpr uint32_t MAGIC = 0x43504647; // "GFPC"
+
+    uint32_t magic;
+    uint32_t driverVersion;
+    uint64_t dataSize;
+    uint8_t driverUUID[VK_UUID_SIZE];
+};
+
+void VulkanDevice::createPipelineCache()
+{
+    std::vector<char> data;
+    if (!mPipelineCachePath.empty()) {
+        std::ifstream is(mPipelineCachePath, std::ios::binary | std::ios::in | std::ios::ate);
+        if (is.is_open()) {
+            data.resize((size_t)is.tellg());
+            is.seekg(0, std::ios::beg);
+            is.read(data.data(), data.size());
+        }
+    }
+
+    // A cache written by another gpu or driver version is rejected by some drivers and silently
+    // ignored by others, so only hand over data whose header matches this device. The vulkan
+    // header has no driver version or driver UUID, the file keeps them in front of the cache data.
+    if (!data.empty()) {
+        PipelineCacheFileHeader fileHeader {};
+        VkPipelineCacheHeaderVersionOne header {};
+        bool valid = data.size() >= sizeof(fileHeader) + sizeof(header);
+        if (valid) {
+            std::memcpy(&fileHeader, data.data(), sizeof(fileHeader));
+            std::memcpy(&header, data.data() + sizeof(fileHeader), sizeof(header));
+            valid = fileHeader.magic == PipelineCacheFileHeader::MAGIC
+                && fileHeader.driverVersion == properties.driverVersion
+                && std::memcmp(fileHeader.driverUUID, idProperties.driverUUID, VK_UUID_SIZE) == 0
+                && fileHeader.dataSize == data.size() - sizeof(fileHeader)
+                && header.headerSize >= sizeof(header)
+                && header.headerSize <= fileHeader.dataSize
+                && header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+                && header.vendorID == properties.vendorID
+                && header.deviceID == properties.deviceID
+                && std::memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+        }
+
+        if (valid) {
+            data.erase(data.begin(), data.begin() + sizeof(fileHeader));
+            LOG_INFO("Pipeline cache loaded: {}, {} bytes", mPipelineCachePath, data.size());
+        } else {
+            LOG_WARNING("Pipeline cache {} does not match this device, ignored", mPipelineCachePath);
+            data.clear();
+        }
+    }
+
+    VkPipelineCacheCreateInfo createInfo {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+        .initialDataSize = data.size(),
+        .pInitialData = data.empty() ? nullptr : data.data(),
+    };
+
+    if (vkCreatePipelineCache(device, &createInfo, nullptr, &mPipelineCache) != VK_SUCCESS && !data.empty()) {
+        LOG_WARNING("Pipeline cache {} rejected by the driver", mPipelineCachePath);
+        createInfo.initialDataSize = 0;
+        createInfo.pInitialData = nullptr;
+        VK_CHECK_RESULT(vkCreatePipelineCache(device, &createInfo, nullptr, &mPipelineCache));
+    }
+}
+
+void VulkanDevice::savePipelineCache()
+{
+    if (mPipelineCache == VK_NULL_HANDLE || mPipelineCachePath.empty()) {
+        return;
+    }
+
+    size_t size = 0;
+    if (vkGetPipelineCacheData(device, mPipelineCache, &size, nullptr) != VK_SUCCESS || size == 0) {
+        return;
+    }
+
+    PipelineCacheFileHeader fileHeader {};
+    fileHeader.magic = PipelineCacheFileHeader::MAGIC;
+    fileHeader.driverVersion = properties.driverVersion;
+    std::memcpy(fileHeader.driverUUID, idProperties.driverUUID, VK_UUID_SIZE);
+
+    std::vector<char> data(sizeof(fileHeader) + size);
+    if (vkGetPipelineCacheData(device, mPipelineCache, &size, data.data() + sizeof(fileHeader)) != VK_SUCCESS) {
+        return;
+    }
+
+    fileHeader.dataSize = size;
+    std::memcpy(data.data(), &fileHeader, sizeof(fileHeader));
+    size += sizeof(fileHeader);
+
+    if (!utils::FileUtils::writeAtomic(mPipelineCachePath, data.data(), size)) {
+        LOG_WARNING("Can not write pipeline cache: {}", mPipelineCachePath);
+    }
+}
+
 bool VulkanDevice::allocConstantBuffer(uint32_t size, void** pData, BufferInfo* pOut)
 {
     return mConstantBufferRing.allocBuffer(size, pData, pOut);
@@ -262,9 +521,9 @@ Ref<HwShaderModule> VulkanDevice::createShaderModule(ShaderStage stage, const By
     return makeShared<VulkanShaderModule>(stage, shaderCode, shaderCodeType, pShaderEntryPoint);
 }
 
-SharedPtr<HwProgram> VulkanDevice::createProgram(Ref<HwShaderModule>* shaderModules, uint32_t count)
+SharedPtr<HwProgram> VulkanDevice::createProgram(Ref<HwShaderModule>* shaderModules, uint32_t count, const Span<const SpecializationValue>& specializationValues)
 {
-    SharedPtr<VulkanProgram> handle = makeShared<VulkanProgram>(shaderModules, count);
+    SharedPtr<VulkanProgram> handle = makeShared<VulkanProgram>(shaderModules, count, specializationValues);
     return handle;
 }
 
@@ -319,9 +578,9 @@ void VulkanDevice::updateBuffer(HwBuffer* buffer, const void* data, size_t size,
 void VulkanDevice::copyTexture(HwTexture* srcTex, uint32_t srcLevel, uint32_t srcLayer,
     HwTexture* destTex, uint32_t destLevel, uint32_t destLayer)
 {
-    gfx().executeCommand(CommandQueueType::Copy, [=](auto& c) {
-        c.copyImage((VulkanTexture*)srcTex, srcLevel, srcLayer, (VulkanTexture*)destTex, destLevel, destLayer);
-    });
+    // copyImage transitions through the tracked states, which belong to the frame's command buffer
+    assert(mCurrentCmd != nullptr && "copyTexture is recorded into the frame");
+    mCurrentCmd->copyImage((VulkanTexture*)srcTex, srcLevel, srcLayer, (VulkanTexture*)destTex, destLevel, destLayer);
 }
 
 void VulkanDevice::updateDescriptorSet1(HwDescriptorSet* descriptorSet, uint32_t dstBinding, HwTextureView* texView)
@@ -346,12 +605,16 @@ void VulkanDevice::updateDescriptorSet4(HwDescriptorSet* descriptorSet, uint32_t
 
 void VulkanDevice::beginFrame(int)
 {
+    mFrameIndex++;
+    // also returns the slots of retired frames to the free lists
+    flushDescriptorTables();
     mCurrentCmd = getCommandBuffer(CommandQueueType::Graphics);
     mCurrentCmd->begin();
 }
 
 void VulkanDevice::beginRendering(HwRenderTarget* pRT, const RenderPassInfo& renderInfo)
 {
+    flushDescriptorWrites();
     mCurrentCmd->beginRendering(pRT, renderInfo);
     mRenderPassInfo = renderInfo;
     mRenderTarget = (VulkanRenderTarget*)pRT;
@@ -489,11 +752,14 @@ void VulkanDevice::pushConstant1(uint32_t index, const void* data, uint32_t size
 
 void VulkanDevice::bindDescriptorSets1(const Span<HwDescriptorSet*>& ds, const Uniforms& uniforms)
 {
+    // a set must not be updated once it is bound, unless its layout is update after bind
+    flushDescriptorWrites();
     mCurrentCmd->bindDescriptorSets(ds.data(), (uint32_t)ds.size(), uniforms.data(), uniforms.size());
 }
 
 void VulkanDevice::bindUniforms(const Uniforms& uniforms)
 {
+    flushDescriptorWrites();
     mCurrentCmd->bindUniformBuffer(uniforms.data(), uniforms.size());
 }
 
@@ -509,45 +775,52 @@ void VulkanDevice::bindVertexBuffer(uint32_t firstBinding, HwBuffer* buffer, uin
 
 void VulkanDevice::draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance)
 {
+    flushDescriptorWrites();
     mCurrentCmd->draw(vertexCount, instanceCount, firstVertex, firstInstance);
     Stats::drawCall()++;
 }
 
 void VulkanDevice::drawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset, uint32_t firstInstance)
 {
+    flushDescriptorWrites();
     mCurrentCmd->drawIndexed(indexCount, instanceCount, firstIndex, vertexOffset, firstInstance);
     Stats::drawCall()++;
 }
 
 void VulkanDevice::drawIndirect(HwBuffer* buffer, uint64_t offset, uint32_t drawCount, uint32_t stride)
 {
+    flushDescriptorWrites();
     mCurrentCmd->drawIndirect(buffer, offset, drawCount, stride);
 }
 
 void VulkanDevice::drawIndexedIndirect(HwBuffer* buffer, uint64_t offset, uint32_t drawCount, uint32_t stride)
 {
+    flushDescriptorWrites();
     mCurrentCmd->drawIndexedIndirect(buffer, offset, drawCount, stride);
 }
 
 void VulkanDevice::dispatch(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ)
 {
+    flushDescriptorWrites();
     mCurrentCmd->dispatch(groupCountX, groupCountY, groupCountZ);
 }
 
 void VulkanDevice::dispatchIndirect(HwBuffer* buffer, uint64_t offset)
 {
+    flushDescriptorWrites();
     mCurrentCmd->dispatchIndirect(buffer, offset);
 }
 
 void VulkanDevice::drawPrimitive(HwRenderPrimitive* primitive, uint32_t instanceCount, uint32_t firstInstance)
 {
+    flushDescriptorWrites();
     VulkanRenderPrimitive* rp = static_cast<VulkanRenderPrimitive*>(primitive);
     if (rp->vertexBuffers.size() > 0) {
         vkCmdBindVertexBuffers(mCurrentCmd->cmd, 0, (uint32_t)rp->vertexBuffers.size(), rp->vertexBuffers.data(), rp->bufferOffsets.get());
     }
 
     if (rp->indexBuffer != nullptr) {
-        vkCmdBindIndexBuffer(mCurrentCmd->cmd, rp->indexBuffer, 0, rp->indexType);
+        vkCmdBindIndexBuffer(mCurrentCmd->cmd, rp->indexBuffer, rp->indexOffset, rp->indexType);
         mCurrentCmd->drawIndexed(rp->drawArgs.indexCount, instanceCount, rp->drawArgs.firstIndex, rp->drawArgs.vertexOffset, firstInstance);
     } else {
         mCurrentCmd->draw(rp->drawArgs.vertexCount, instanceCount, rp->drawArgs.firstVertex, firstInstance);
@@ -558,13 +831,14 @@ void VulkanDevice::drawPrimitive(HwRenderPrimitive* primitive, uint32_t instance
 
 void VulkanDevice::drawIndirectPrimitive(HwRenderPrimitive* primitive, HwBuffer* indirectBuffer, uint64_t offset, uint32_t drawCount, uint32_t stride)
 {
+    flushDescriptorWrites();
     VulkanRenderPrimitive* rp = static_cast<VulkanRenderPrimitive*>(primitive);
     if (rp->vertexBuffers.size() > 0) {
         vkCmdBindVertexBuffers(mCurrentCmd->cmd, 0, (uint32_t)rp->vertexBuffers.size(), rp->vertexBuffers.data(), rp->bufferOffsets.get());
     }
 
     if (rp->indexBuffer != nullptr) {
-        vkCmdBindIndexBuffer(mCurrentCmd->cmd, rp->indexBuffer, 0, rp->indexType);
+        vkCmdBindIndexBuffer(mCurrentCmd->cmd, rp->indexBuffer, rp->indexOffset, rp->indexType);
         mCurrentCmd->drawIndexedIndirect(indirectBuffer, offset, drawCount, stride);
     } else {
         mCurrentCmd->drawIndirect(indirectBuffer, offset, drawCount, stride);
@@ -579,17 +853,18 @@ static void drawBatch1(const CommandBuffer& cmd, const RenderCommand* start, uin
         auto& primitive = start[i];
         cmd.bindPipelineState(&primitive.pipelineState);
         cmd.bindUniforms(primitive.uniforms);
-        cmd.drawPrimitive(primitive.renderPrimitive, primitive.instanceCount, 0);
+        cmd.drawPrimitive(primitive.renderPrimitive, primitive.instanceCount, primitive.firstInstance);
     }
 }
 
 void VulkanDevice::drawBatch(HwRenderQueue* renderQueue)
 {
+    flushDescriptorWrites();
     const auto& primitives = renderQueue->getReadCommands();
 #if defined(VK_USE_PLATFORM_METAL_EXT)
     drawBatch1(*mCurrentCmd, primitives.data(), (uint32_t)primitives.size());
 #else
-    if (primitives.size() > 200) {
+    if (primitives.size() > mMultiThreadedDrawThreshold) {
         drawMultiThreaded(primitives, *mCurrentCmd);
     } else {
         drawBatch1(*mCurrentCmd, primitives.data(), (uint32_t)primitives.size());
@@ -599,10 +874,8 @@ void VulkanDevice::drawBatch(HwRenderQueue* renderQueue)
     Stats::drawCall() += (uint32_t)primitives.size();
 }
 
-void drawWork(VulkanDevice* device, const RenderCommand* start, uint32_t count, uint32_t index)
+void drawWork(VulkanDevice* device, const CommandBuffer& cb, const RenderCommand* start, uint32_t count)
 {
-    CommandBuffer& cb = *device->mCmdList[index];
-
     VkCommandBufferInheritanceRenderingInfoKHR info1 = {
         .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO_KHR,
         .pNext = nullptr,
@@ -620,7 +893,7 @@ void drawWork(VulkanDevice* device, const RenderCommand* start, uint32_t count,
         .pNext = &info1,
     };
 
-    cb.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT, &info);
+    cb.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT, &info);
     auto& vp = device->mRenderPassInfo.viewport;
     cb.setViewportAndScissor(vp.left, vp.top, vp.width, vp.height);
     cb.resetState();
@@ -631,51 +904,35 @@ void drawWork(VulkanDevice* device, const RenderCommand* start, uint32_t count,
 
 void VulkanDevice::drawMultiThreaded(const std::vector<RenderCommand>& items, const CommandBuffer& cmd)
 {
-    uint32_t itemsPerThread = 200;
-    uint32_t threadNum = std::thread::hardware_concurrency();
-    itemsPerThread = (uint32_t)(items.size() + threadNum - 1) / threadNum;
-    itemsPerThread = std::max(40u, itemsPerThread);
-
-    mFutures.clear();
-    uint32_t start = 0, end = 0;
-
-    mSecondCmdBuffers.reserve(threadNum);
+    uint32_t workerCount = mJobSystem->getWorkerCount();
+    uint32_t itemsPerJob = (uint32_t)(items.size() + workerCount - 1) / workerCount;
+    itemsPerJob = std::max(40u, itemsPerJob);
+    uint32_t jobCount = (uint32_t)(items.size() + itemsPerJob - 1) / itemsPerJob;
 
 #if !HAS_SHADER_OBJECT_EXT
+    // workers only look pipelines up, misses (and async compile requests) happen here
     for (auto& prim : items) {
         VulkanProgram* vkProgram = (VulkanProgram*)prim.pipelineState.program;
-        vkProgram->getGraphicsPipeline(mAttachmentFormats, &prim.pipelineState);
+        auto pipeline = vkProgram->getGraphicsPipeline(mAttachmentFormats, &prim.pipelineState);
+        if (pipeline == VK_NULL_HANDLE && vkProgram->fallbackState) {
+            auto fallbackState = vkProgram->fallbackState;
+            ((VulkanProgram*)fallbackState->program)->getGraphicsPipeline(mAttachmentFormats, fallbackState);
+        }
     }
 #endif
 
-    for (unsigned i = 0; i < threadNum && start < items.size(); ++i) {
-        auto cmdList = mCommandQueues[(int)CommandQueueType::Graphics].getCommandBuffer(1, true);
-        mCmdList.push_back(cmdList);
-        mSecondCmdBuffers.push_back(cmdList->cmd);
-        uint32_t itemCount = std::min(itemsPerThread, (uint32_t)items.size() - start);
-        mFutures.emplace_back(std::async(std::launch::async,
-            drawWork, this, (const RenderCommand*)&items[start], (uint32_t)itemCount, (uint32_t)i));
+    mSecondCmdBuffers.resize(jobCount);
 
-        start += itemCount;
-    }
-
-    for (auto& f : mFutures) {
-        f.get();
-    }
+    mJobSystem->parallelFor(jobCount, [&](uint32_t jobIndex, uint32_t workerIndex) {
+        CommandBuffer* cb = mSecondaryCommandPools[workerIndex]->acquire(mFrameIndex);
+        uint32_t start = jobIndex * itemsPerJob;
+        uint32_t itemCount = std::min(itemsPerJob, (uint32_t)items.size() - start);
+        drawWork(this, *cb, &items[start], itemCount);
+        mSecondCmdBuffers[jobIndex] = cb->cmd;
+    });
 
     vkCmdExecuteCommands(cmd.cmd, (uint32_t)mSecondCmdBuffers.size(), mSecondCmdBuffers.data());
     mSecondCmdBuffers.clear();
-
-    for (auto cmdList : mCmdList) {
-        auto c = cmdList;
-        post([=]() {
-            mCommandQueues[(int)CommandQueueType::Graphics].releaseCommandPool(c->commandPool);
-            c->free();
-        },
-            4);
-    }
-
-    mCmdList.clear();
 }
 
 void VulkanDevice::resourceBarrier(uint32_t barrierCount, const Barrier* pBarriers)
@@ -690,7 +947,8 @@ void VulkanDevice::commit(HwSwapchain* sc)
     assert(sc == mSwapChain);
     VulkanSwapChain* swapChain = static_cast<VulkanSwapChain*>(sc);
 
-    auto semaphoreValue = mCommandQueues[0].submit(&mCurrentCmd->cmd, 1, nullptr, mPresentComplete, mCurrentImage);
+    // uploads recorded so far become visible to this frame without blocking the cpu
+    auto semaphoreValue = submit(*mCurrentCmd, VK_NULL_HANDLE, mPresentComplete, mCurrentImage);
     mCommandQueues[0].present(swapChain->swapChain, mCurrentImage);
     auto cmd = (CommandBuffer*)mCurrentCmd;
     auto future = std::async(std::launch::async, [this, semaphoreValue, cmd]() {
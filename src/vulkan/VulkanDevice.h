@@ -1,5 +1,6 @@
 #pragma once
 #include "../GraphicsDevice.h"
+#include "../JobSystem.h"
 #include "VulkanBuffer.h"
 #include "VulkanDebug.h"
 #include "VulkanDefs.h"
@@ -12,8 +13,10 @@
 #include "CommandQueue.h"
 #include "DescriptorPoolManager.h"
 #include "ResourceSet.h"
+#include "TransientHeap.h"
 #include "UploadHeap.h"
 #include <algorithm>
+#include <atomic>
 #include <assert.h>
 #include <deque>
 #include <exception>
@@ -38,6 +41,7 @@ public:
     Dispatcher getDispatcher() const noexcept override;
 
     DynamicBufferPool& getConstbufferRing() { return mConstantBufferRing; }
+    DynamicBufferPool& getVertexBufferRing() { return mVertexBufferRing; }
 
     bool allocVertexBuffer(uint32_t sizeInBytes, void** pData, BufferInfo* pOut);
     bool allocIndexBuffer(uint32_t sizeInBytes, void** pData, BufferInfo* pOut);
@@ -63,6 +67,7 @@ public:
 
     VulkanStagePool& getStagePool() { return *mStagePool; }
     UploadHeap& getUploadHeap() { return mUploadHeap; }
+    TransientHeap& getTransientHeap() { return mTransientHeap; }
     DescriptorTable* getTextureSet() { return mTextureSet; }
     DescriptorTable* getImageSet() { return mSampledImageTable; }
     SamplerTable* getSamplerSet() { return mSamplerSet; }
@@ -81,19 +86,61 @@ public:
         return vkBuffer->buffer;
     }
 
-    void updateDynamicDescriptorSet(int index, uint32_t size, VkDescriptorSet descriptorSet);
+    void updateDynamicDescriptorSet(int index, uint32_t size, DescriptorSet& descriptorSet);
+    void updateInstanceDataDescriptorSet(int index, DescriptorSet& descriptorSet);
+
+    // DescriptorSet stages its writes under this lock, any thread may write. The staged writes are
+    // applied by flushDescriptorWrites on the render thread, before the next bind, draw or dispatch.
+    std::mutex& getDescriptorWriteLock() { return mDescriptorWriteLock; }
+    // called with the descriptor write lock held
+    void addPendingDescriptorSet(DescriptorSet* ds);
+    void removePendingDescriptorSet(DescriptorSet* ds);
+    // DescriptorTable queues its slot writes and calls this, they are applied by the same flush
+    void markDescriptorTablesDirty() { mHasDirtyDescriptorTables.store(true, std::memory_order_release); }
+    void flushDescriptorWrites()
+    {
+        if (mHasPendingDescriptorSets.load(std::memory_order_acquire) || mHasDirtyDescriptorTables.load(std::memory_order_acquire)) {
+            flushPendingDescriptorSets();
+        }
+    }
 
+    CommandQueue& getCommandQueue(CommandQueueType queueType) { return mCommandQueues[(int)queueType]; }
     CommandBuffer* getCommandBuffer(CommandQueueType queueType, uint32_t count = 1);
     void freeCommandBuffer(CommandBuffer* cmd);
-    void executeCommand(CommandQueueType queueType, const std::function<void(const CommandBuffer&)>& fn);
+    // Submits a graphics or compute command buffer and returns the timeline value it signals.
+    // Uploads recorded so far are flushed first and the submit waits for them on the GPU. Every
+    // queue submit except the upload batches themselves goes through here.
+    uint64_t submit(const CommandBuffer& cmd, VkSemaphore signalSemaphore = VK_NULL_HANDLE, VkSemaphore waitSemaphore = VK_NULL_HANDLE, int useEndOfFrameSemaphore = -1);
+
+    // Records fn into the pending upload batch of the copy queue and returns without waiting.
+    // The batch is submitted before the next submit of another queue, which waits for it on the GPU.
+    // Thread safe, returns the id of the batch fn went into.
+    uint64_t recordUpload(const std::function<void(const CommandBuffer&)>& fn);
+    void flushUploads();
+    // Blocks the calling thread until the upload batch has been executed.
+    void waitUploads(uint64_t batchId);
+
+    JobSystem& getJobSystem() { return *mJobSystem; }
+    VkPipelineCache getPipelineCache() const { return mPipelineCache; }
+    // Settings::shaderCachePath, empty when disabled
+    const String& getShaderCachePath() const { return mShaderCachePath; }
 
 protected:
     void drawMultiThreaded(const std::vector<RenderCommand>& items, const CommandBuffer& cmd);
+    void flushPendingDescriptorSets();
+    void flushDescriptorTables();
+    void createPipelineCache();
+    void savePipelineCache();
 
     DynamicBufferPool mConstantBufferRing;
     DynamicBufferPool mVertexBufferRing;
     UploadHeap mUploadHeap;
+    TransientHeap mTransientHeap;
     std::mutex mSamplerLock;
+    std::mutex mDescriptorWriteLock;
+    std::vector<DescriptorSet*> mPendingDescriptorSets;
+    std::atomic<bool> mHasPendingDescriptorSets = false;
+    std::atomic<bool> mHasDirtyDescriptorTables = false;
 
     DescriptorPoolManager mDescriptorPoolManager;
 
@@ -108,14 +155,35 @@ protected:
     VulkanStagePool* mStagePool = nullptr;
     // Swap chain image presentation
     VkSemaphore mPresentComplete = VK_NULL_HANDLE;
+    VkPipelineCache mPipelineCache = VK_NULL_HANDLE;
+    String mPipelineCachePath;
+    String mShaderCachePath;
     
     // Active frame buffer index
     uint32_t mCurrentImage = 0;
     const CommandBuffer* mCurrentCmd = nullptr;
 
-    std::vector<std::future<void>> mFutures {};
+    std::unique_ptr<JobSystem> mJobSystem;
+    std::vector<std::unique_ptr<SecondaryCommandPool>> mSecondaryCommandPools;
     std::vector<VkCommandBuffer> mSecondCmdBuffers;
-    std::vector<CommandBuffer*> mCmdList;
+    uint32_t mMultiThreadedDrawThreshold = 200;
+    uint64_t mFrameIndex = 0;
+
+    struct UploadBatch {
+        CommandBuffer* cmd;
+        uint64_t semaphoreValue;
+    };
+
+    std::mutex mUploadLock;
+    CommandBuffer* mUploadCmd = nullptr;
+    uint64_t mUploadBatchId = 1;
+    uint64_t mUploadSemaphoreValue = 0;
+    // per queue type, the upload value its submits already wait for
+    uint64_t mUploadSemaphoreWaited[3] {};
+    std::deque<UploadBatch> mUploadsInFlight;
+
+    void flushUploadsLocked();
+    void retireUploads(bool waitAll);
 
     RenderPassInfo mRenderPassInfo {};
     VulkanRenderTarget* mRenderTarget = nullptr;
@@ -123,7 +191,7 @@ protected:
 
     friend class CommandBuffer;
 
-    friend void drawWork(VulkanDevice* device, const RenderCommand* start, uint32_t count, uint32_t index);
+    friend void drawWork(VulkanDevice* device, const CommandBuffer& cb, const RenderCommand* start, uint32_t count);
 };
 
 VulkanDevice& gfx();
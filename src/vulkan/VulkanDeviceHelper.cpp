@@ -317,6 +317,14 @@ bool VulkanDeviceHelper::selectPhysicalDevice()
     vkGetPhysicalDeviceFeatures(physicalDevice, &features);
     vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
 
+    {
+        VkPhysicalDeviceProperties2 device_properties;
+        idProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+        device_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2_KHR;
+        device_properties.pNext = &idProperties;
+        vkGetPhysicalDeviceProperties2KHR(physicalDevice, &device_properties);
+    }
+
     // Queue family properties, used for setting up requested queues upon device creation
     uint32_t queueFamilyCount;
     vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
@@ -340,6 +348,14 @@ void VulkanDeviceHelper::getEnabledFeatures()
 #if HAS_SHADER_OBJECT_EXT
     enabledShaderObjectFeaturesEXT.shaderObject = true;
     featuresAppender.AppendNext(&enabledShaderObjectFeaturesEXT, VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_OBJECT_FEATURES_EXT);
+
+    {
+        VkPhysicalDeviceProperties2 device_properties;
+        shaderObjectProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_OBJECT_PROPERTIES_EXT;
+        device_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2_KHR;
+        device_properties.pNext = &shaderObjectProperties;
+        vkGetPhysicalDeviceProperties2KHR(physicalDevice, &device_properties);
+    }
 #endif
     featuresAppender.AppendNext(&enabledDynamicRenderingFeaturesKHR, VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR);
 
@@ -385,6 +401,13 @@ void VulkanDeviceHelper::getEnabledFeatures()
     static VkPhysicalDeviceTimelineSemaphoreFeaturesKHR semaphoreFeatures = {};
     featuresAppender.AppendNext(&semaphoreFeatures, VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR);
 
+    // core in 1.3, barriers are recorded with vkCmdPipelineBarrier2
+    static VkPhysicalDeviceSynchronization2Features synchronization2Features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES,
+        .synchronization2 = VK_TRUE,
+    };
+    featuresAppender.AppendNext(&synchronization2Features);
+
     if (tryAddExtension(VK_EXT_BUFFER_DEVICE_ADDRESS_EXTENSION_NAME)) {
         featuresAppender.AppendNext(&BufferDeviceAddressFeatures, VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_BUFFER_DEVICE_ADDRESS_FEATURES);
     }
@@ -717,6 +740,7 @@ void VulkanDeviceHelper::destroy()
 
     if (device) {
         vkDestroyDevice(device, nullptr);
+        device = VK_NULL_HANDLE;
     }
 
     debug::freeDebugCallback(instance);
@@ -48,6 +48,12 @@ public:
     std::vector<VkExtensionProperties> supportedExtensions;
 
     VkPhysicalDeviceDescriptorIndexingProperties descriptorIndexingProperties = {};
+    // driverUUID identifies the driver build, pipeline cache data is only valid for the same one
+    VkPhysicalDeviceIDProperties idProperties = {};
+#if HAS_SHADER_OBJECT_EXT
+    // shaderBinaryUUID and shaderBinaryVersion identify which cached shader binaries are usable
+    VkPhysicalDeviceShaderObjectPropertiesEXT shaderObjectProperties = {};
+#endif
 
     /** @brief Contains queue family indices */
     struct
@@ -2,7 +2,9 @@
 #include "VulkanShader.h"
 #include "vulkan/VkFormatHelper.h"
 #include "vulkan/VulkanDevice.h"
+#include "vulkan/VulkanTextureView.h"
 #include "vulkan/VulkanTools.h"
+#include "utils/Log.h"
 
 namespace mygfx {
 
@@ -15,26 +17,34 @@ VulkanRenderPrimitive::VulkanRenderPrimitive(VertexData* geo, const DrawPrimitiv
     for (int i = 0; i < geo->vertexBuffers.size(); i++) {
         VulkanBuffer* vb = (VulkanBuffer*)geo->vertexBuffers[i].get();
         vertexBuffers.push_back(vb->buffer);
-        bufferOffsets[i] = vb->bufferOffset;
-        vertexSemantics[i] = (VertexAttribute)vb->extra;
+        bufferOffsets[i] = vb->bufferOffset + (i < geo->vertexOffsets.size() ? geo->vertexOffsets[i] : 0);
+        vertexSemantics[i] = i < geo->vertexAttributes.size() ? geo->vertexAttributes[i] : (VertexAttribute)vb->extra;
     }
 
     if (geo->indexBuffer) {
         VulkanBuffer* ib = (VulkanBuffer*)geo->indexBuffer.get();
         indexBuffer = ib->buffer;
-        indexType = ib->stride == 2 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+        indexOffset = ib->bufferOffset + geo->indexOffset;
+        // a packed buffer has no stride of its own
+        if (ib->stride != 0) {
+            indexType = ib->stride == 2 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+        } else {
+            indexType = geo->indexType == IndexType::UINT16 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+        }
     }
 }
 
 VulkanVertexInput::VulkanVertexInput(const FormatList& fmts)
 {
     append(fmts, false);
+    contentId = makeContentId(fmts, {});
 }
 
 VulkanVertexInput::VulkanVertexInput(const FormatList& fmts, const FormatList& fmts1)
 {
     append(fmts, false);
     append(fmts1, true);
+    contentId = makeContentId(fmts, fmts1);
 }
 
 void VulkanVertexInput::append(const FormatList& fmts, bool perInstance)
@@ -85,8 +95,17 @@ VulkanRenderTarget::VulkanRenderTarget(const RenderTargetDesc& desc)
     width = desc.width;
     height = desc.height;
 
+    uint32_t aliasedCount = 0;
     for (auto& rt : desc.colorAttachments) {
         colorAttachments.emplace_back((VulkanTextureView*)rt.get());
+        if (colorAttachments.back()->texture()->isAliased()) {
+            aliasedCount++;
+        }
+    }
+
+    // aliased transient color attachments share one block of memory
+    if (aliasedCount > 1) {
+        LOG_WARNING("RenderTarget: {} aliased transient color attachments overwrite each other", aliasedCount);
     }
 
     depthAttachment = (VulkanTextureView*)desc.depthAttachment.get();
@@ -14,6 +14,7 @@ public:
     std::unique_ptr<uint64_t[]> bufferOffsets = nullptr;
     std::unique_ptr<VertexAttribute[]> vertexSemantics = nullptr;
     VkBuffer indexBuffer = nullptr;
+    VkDeviceSize indexOffset = 0;
     VkIndexType indexType;
 };
 
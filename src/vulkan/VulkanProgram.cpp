@@ -1,8 +1,11 @@
 #include "VulkanProgram.h"
 #include "VulkanDevice.h"
 #include "VulkanInitializers.hpp"
+#include "utils/FileUtils.h"
 #include "utils/Log.h"
 #include "utils/ThreadUtils.h"
+#include "utils/algorithm.h"
+#include <fstream>
 
 namespace mygfx {
 
@@ -32,27 +35,41 @@ PipelineCache::~PipelineCache()
     sPipelineCaches.erase(this);
 }
 
+GraphicsPipelineKey::GraphicsPipelineKey(const AttachmentFormats& formats, const PipelineState& pipelineState)
+    : state(pipelineState)
+    , colorAttachmentCount(formats.colorAttachmentCount)
+{
+    for (uint32_t i = 0; i < colorAttachmentCount; i++) {
+        attachmentFormats[i] = formats.attachmentFormats[i];
+    }
+    attachmentFormats[8] = formats.depthAttachmentFormat();
+    attachmentFormats[9] = formats.stencilAttachmentFormat();
+
+    hash = formats.getHash();
+    utils::hash_combine(hash, PipelineKey::Hasher {}(state));
+}
+
+bool GraphicsPipelineKey::operator==(const GraphicsPipelineKey& other) const
+{
+    return hash == other.hash && colorAttachmentCount == other.colorAttachmentCount
+        && std::memcmp(attachmentFormats, other.attachmentFormats, sizeof(attachmentFormats)) == 0
+        && state == other.state;
+}
+
 void PipelineCache::gc()
 {
     using namespace std::literals::chrono_literals;
-    static Vector<size_t> toRemove;
     auto now = Clock::now();
     std::unique_lock locker(sLock);
     for (auto& pipelineCache : sPipelineCaches) {
-
-        for (auto& info : *pipelineCache) {
-            if (now - info.second.lastTime < 100s) {
-                // todo:
-                info.second.destroy();
-                toRemove.push_back(info.first);
-            }
-        }
-
-        if (toRemove.size() > 0) {
-            for (auto hash : toRemove) {
-                pipelineCache->erase(hash);
+        for (auto it = pipelineCache->begin(); it != pipelineCache->end();) {
+            // entries still compiling in the background have no pipeline yet and must stay
+            if (it->second.pipeline && now - it->second.lastTime > 100s) {
+                it->second.destroy();
+                it = pipelineCache->erase(it);
+            } else {
+                ++it;
             }
-            toRemove.clear();
         }
     }
 }
@@ -70,32 +87,57 @@ ShaderResourceInfo* findShaderResource(std::vector<Ref<ShaderResourceInfo>> shad
     return nullptr;
 }
 
-ShaderResourceInfo* HwProgram::getShaderResource(const String& name)
+VulkanProgram::VulkanProgram()
 {
-    return static_cast<VulkanProgram*>(this)->getShaderResource(name);
 }
 
-HwDescriptorSet* HwProgram::getDescriptorSet(uint32_t index)
+void VulkanProgram::initSpecialization(uint32_t stage, const Span<const SpecializationValue>& specializationValues)
 {
-    return static_cast<VulkanProgram*>(this)->getDescriptorSet(index);
-}
+    VulkanShaderModule* sm = mShaderModules[stage].get();
+    auto& spec = mSpecializations[stage];
+
+    for (auto& sc : sm->specializationConsts) {
+        // the last value wins when an id is given more than once
+        const SpecializationValue* value = nullptr;
+        for (auto& v : specializationValues) {
+            if (v.id == sc.id && any(v.stageFlags & sm->shaderStage)) {
+                value = &v;
+            }
+        }
 
-HwDescriptorSet* HwProgram::createDescriptorSet(uint32_t index)
-{
-    return static_cast<VulkanProgram*>(this)->createDescriptorSet(index);
+        if (value == nullptr) {
+            continue;
+        }
+
+        if (sc.size > sizeof(uint32_t)) {
+            LOG_WARNING("Specialization constant {} is not 32-bit, value ignored", sc.id);
+            continue;
+        }
+
+        spec.mapEntries.push_back(VkSpecializationMapEntry { sc.id, (uint32_t)(spec.data.size() * sizeof(uint32_t)), sizeof(uint32_t) });
+        spec.data.push_back(value->value);
+    }
+
+    spec.info.mapEntryCount = (uint32_t)spec.mapEntries.size();
+    spec.info.pMapEntries = spec.mapEntries.data();
+    spec.info.dataSize = spec.data.size() * sizeof(uint32_t);
+    spec.info.pData = spec.data.data();
 }
 
-VulkanProgram::VulkanProgram()
+const VkSpecializationInfo* VulkanProgram::getSpecializationInfo(uint32_t stage) const
 {
+    auto& spec = mSpecializations[stage];
+    return spec.mapEntries.empty() ? nullptr : &spec.info;
 }
 
-VulkanProgram::VulkanProgram(Ref<HwShaderModule>* shaderModules, uint32_t count)
+VulkanProgram::VulkanProgram(Ref<HwShaderModule>* shaderModules, uint32_t count, const Span<const SpecializationValue>& specializationValues)
 {
     assert(count <= MAX_SHADER_STAGE);
     shaderCodeType = VK_SHADER_CODE_TYPE_SPIRV_EXT;
     stageCount = count;
 
     VkShaderStageFlags fullShaderStageFlags = 0;
+    size_t hash = utils::_FNV_offset_basis;
 
     for (uint32_t i = 0; i < stageCount; i++) {
         VulkanShaderModule* sm = static_cast<VulkanShaderModule*>(shaderModules[i].get());
@@ -103,6 +145,14 @@ VulkanProgram::VulkanProgram(Ref<HwShaderModule>* shaderModules, uint32_t count)
 
         stages[i] = sm->vkShaderStage;
         fullShaderStageFlags |= sm->vkShaderStage;
+        initSpecialization(i, specializationValues);
+
+        auto& spec = mSpecializations[i];
+        hash = utils::fnv1a(hash, (const unsigned char*)&sm->vkShaderStage, sizeof(sm->vkShaderStage));
+        hash = utils::fnv1a(hash, sm->shaderCode.data(), sm->shaderCode.size());
+        hash = utils::fnv1a(hash, (const unsigned char*)sm->entryPoint.data(), sm->entryPoint.size());
+        hash = utils::fnv1a(hash, (const unsigned char*)spec.mapEntries.data(), spec.mapEntries.size() * sizeof(VkSpecializationMapEntry));
+        hash = utils::fnv1a(hash, (const unsigned char*)spec.data.data(), spec.data.size() * sizeof(uint32_t));
 
         for (auto& pc : sm->pushConstants) {
             bool found = false;
@@ -140,6 +190,8 @@ VulkanProgram::VulkanProgram(Ref<HwShaderModule>* shaderModules, uint32_t count)
         }
     }
 
+    contentId = hash;
+
     if (fullShaderStageFlags == (VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)) {
         programType = ProgramType::GRAPHICS;
     } else if (fullShaderStageFlags == VK_SHADER_STAGE_COMPUTE_BIT) {
@@ -221,6 +273,8 @@ VulkanProgram::VulkanProgram(Ref<HwShaderModule>* shaderModules, uint32_t count)
                         ds->dynamicBufferSize[j] = sz;
                         gfx().updateDynamicDescriptorSet(it.second[j]->dsLayoutBinding.binding, sz, *ds);
                     }
+                } else if (it.second[j]->dsLayoutBinding.descriptorType == DescriptorType::STORAGE_BUFFER && it.second[j]->name == INSTANCE_DATA_NAME) {
+                    gfx().updateInstanceDataDescriptorSet(it.second[j]->dsLayoutBinding.binding, *ds);
                 }
             }
 
@@ -303,6 +357,8 @@ HwDescriptorSet* VulkanProgram::createDescriptorSet(uint32_t index)
                         ds->dynamicBufferSize[j] = sz;
                         gfx().updateDynamicDescriptorSet(layoutBinding.binding, sz, *ds);
                     }
+                } else if (layoutBinding.descriptorType == DescriptorType::STORAGE_BUFFER && res[j]->name == INSTANCE_DATA_NAME) {
+                    gfx().updateInstanceDataDescriptorSet(layoutBinding.binding, *ds);
                 }
             }
             return ds;
@@ -311,31 +367,157 @@ HwDescriptorSet* VulkanProgram::createDescriptorSet(uint32_t index)
     return nullptr;
 }
 
+#if HAS_SHADER_OBJECT_EXT
+
+namespace {
+    constexpr uint32_t SHADER_BINARY_MAGIC = 0x4f53474d; // "MGSO"
+
+    struct ShaderBinaryHeader {
+        uint32_t magic;
+        uint32_t stageCount;
+        uint32_t binaryVersion;
+        uint8_t binaryUUID[VK_UUID_SIZE];
+        uint64_t sizes[VulkanProgram::MAX_SHADER_STAGE];
+    };
+
+    String getShaderBinaryPath(size_t key)
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "/%016llx.sobj", (unsigned long long)key);
+        return gfx().getShaderCachePath() + name;
+    }
+}
+
+size_t VulkanProgram::getShaderBinaryKey(const VkShaderCreateInfoEXT* createInfos) const
+{
+    auto hashBytes = [](size_t hash, const void* data, size_t size) {
+        return utils::fnv1a(hash, (const unsigned char*)data, size);
+    };
+
+    // binaries are only valid for the exact create infos they came from, on the same driver
+    auto& props = gfx().shaderObjectProperties;
+    size_t hash = hashBytes(utils::_FNV_offset_basis, props.shaderBinaryUUID, VK_UUID_SIZE);
+    hash = hashBytes(hash, &props.shaderBinaryVersion, sizeof(props.shaderBinaryVersion));
+
+    for (auto& dsLayout : mDescriptorSetLayouts) {
+        utils::hash_combine(hash, dsLayout->toHash());
+    }
+
+    for (uint32_t i = 0; i < stageCount; i++) {
+        auto& info = createInfos[i];
+        hash = hashBytes(hash, info.pCode, info.codeSize);
+        hash = hashBytes(hash, &info.flags, sizeof(info.flags));
+        hash = hashBytes(hash, &info.stage, sizeof(info.stage));
+        hash = hashBytes(hash, &info.nextStage, sizeof(info.nextStage));
+        hash = hashBytes(hash, info.pName, strlen(info.pName));
+        hash = hashBytes(hash, info.pPushConstantRanges, info.pushConstantRangeCount * sizeof(VkPushConstantRange));
+        if (info.pSpecializationInfo) {
+            auto spec = info.pSpecializationInfo;
+            hash = hashBytes(hash, spec->pMapEntries, spec->mapEntryCount * sizeof(VkSpecializationMapEntry));
+            hash = hashBytes(hash, spec->pData, spec->dataSize);
+        }
+    }
+
+    return hash;
+}
+
+bool VulkanProgram::loadShaderBinaries(size_t key, VkShaderCreateInfoEXT* createInfos)
+{
+    std::ifstream is(getShaderBinaryPath(key), std::ios::binary | std::ios::in | std::ios::ate);
+    if (!is.is_open()) {
+        return false;
+    }
+
+    ByteArray data((size_t)is.tellg());
+    is.seekg(0, std::ios::beg);
+    is.read((char*)data.data(), data.size());
+    if (!is || data.size() < sizeof(ShaderBinaryHeader)) {
+        return false;
+    }
+
+    ShaderBinaryHeader header;
+    memcpy(&header, data.data(), sizeof(header));
+
+    auto& props = gfx().shaderObjectProperties;
+    if (header.magic != SHADER_BINARY_MAGIC || header.stageCount != stageCount
+        || header.binaryVersion != props.shaderBinaryVersion
+        || memcmp(header.binaryUUID, props.shaderBinaryUUID, VK_UUID_SIZE) != 0) {
+        return false;
+    }
+
+    size_t offset = sizeof(header);
+    for (uint32_t i = 0; i < stageCount; i++) {
+        if (header.sizes[i] > data.size() - offset) {
+            return false;
+        }
+
+        createInfos[i].codeType = VK_SHADER_CODE_TYPE_BINARY_EXT;
+        createInfos[i].pCode = data.data() + offset;
+        createInfos[i].codeSize = (size_t)header.sizes[i];
+        offset += (size_t)header.sizes[i];
+    }
+
+    VkResult result = vkCreateShadersEXT(gfx().device, stageCount, createInfos, nullptr, shaders);
+    if (result == VK_SUCCESS) {
+        return true;
+    }
+
+    // e.g. VK_INCOMPATIBLE_SHADER_BINARY_EXT after a driver update, the caller recreates from SPIR-V
+    // and overwrites the entry
+    LOG_WARNING("Cached shader binary rejected ({}), using SPIR-V", tools::errorString(result));
+    for (uint32_t i = 0; i < stageCount; i++) {
+        if (shaders[i] != VK_NULL_HANDLE) {
+            vkDestroyShaderEXT(gfx().device, shaders[i], nullptr);
+            shaders[i] = VK_NULL_HANDLE;
+        }
+    }
+    return false;
+}
+
+void VulkanProgram::saveShaderBinaries(size_t key) const
+{
+    auto& props = gfx().shaderObjectProperties;
+    ShaderBinaryHeader header {};
+    header.magic = SHADER_BINARY_MAGIC;
+    header.stageCount = stageCount;
+    header.binaryVersion = props.shaderBinaryVersion;
+    memcpy(header.binaryUUID, props.shaderBinaryUUID, VK_UUID_SIZE);
+
+    ByteArray data(sizeof(header));
+    for (uint32_t i = 0; i < stageCount; i++) {
+        size_t dataSize = 0;
+        if (vkGetShaderBinaryDataEXT(gfx().device, shaders[i], &dataSize, nullptr) != VK_SUCCESS || dataSize == 0) {
+            return;
+        }
+
+        size_t offset = data.size();
+        data.resize(offset + dataSize);
+        if (vkGetShaderBinaryDataEXT(gfx().device, shaders[i], &dataSize, data.data() + offset) != VK_SUCCESS) {
+            return;
+        }
+        header.sizes[i] = dataSize;
+    }
+    memcpy(data.data(), &header, sizeof(header));
+
+    utils::FileUtils::writeAtomic(getShaderBinaryPath(key), data.data(), data.size());
+}
+
+#endif
+
 bool VulkanProgram::createShaders()
 {
 #if HAS_SHADER_OBJECT_EXT
     VkShaderCreateInfoEXT shaderCreateInfos[MAX_SHADER_STAGE] {};
-    Vector<VkPushConstantRange> pushConstRanges;
-    Vector<VkSpecializationMapEntry> specializationMapEntries;
-    VkSpecializationInfo specializationInfo;
+    // one list per stage, the create infos keep pointing into them until the shaders are created
+    Vector<VkPushConstantRange> pushConstRanges[MAX_SHADER_STAGE];
     for (uint32_t i = 0; i < stageCount; i++) {
         VulkanShaderModule* sm = mShaderModules[i].get();
-        pushConstRanges.clear();
         for (auto& pc : pushConstants) {
             if (any(pc.stageFlags & sm->shaderStage)) {
-                pushConstRanges.push_back(VkPushConstantRange { (VkShaderStageFlags)pc.stageFlags, pc.offset, pc.size });
+                pushConstRanges[i].push_back(VkPushConstantRange { (VkShaderStageFlags)pc.stageFlags, pc.offset, pc.size });
             }
         }
 
-        /*
-        specializationMapEntries.clear();
-        for (auto& sc : sm->specializationConsts) {
-                specializationMapEntries.push_back(VkSpecializationMapEntry{sc.id, 0, sc.size});
-        }
-
-        specializationInfo.mapEntryCount = specializationMapEntries.size();
-        specializationInfo.pMapEntries = specializationMapEntries.data();*/
-
         shaderCreateInfos[i].sType = VK_STRUCTURE_TYPE_SHADER_CREATE_INFO_EXT;
         shaderCreateInfos[i].flags = stageCount > 1 ? VK_SHADER_CREATE_LINK_STAGE_BIT_EXT : 0;
         shaderCreateInfos[i].stage = sm->vkShaderStage;
@@ -346,39 +528,32 @@ bool VulkanProgram::createShaders()
         shaderCreateInfos[i].pName = sm->entryPoint.data();
         shaderCreateInfos[i].setLayoutCount = (uint32_t)mVkDescriptorSetLayouts.size();
         shaderCreateInfos[i].pSetLayouts = mVkDescriptorSetLayouts.data();
-        shaderCreateInfos[i].pPushConstantRanges = pushConstRanges.data();
-        shaderCreateInfos[i].pushConstantRangeCount = (uint32_t)pushConstRanges.size();
+        shaderCreateInfos[i].pPushConstantRanges = pushConstRanges[i].data();
+        shaderCreateInfos[i].pushConstantRangeCount = (uint32_t)pushConstRanges[i].size();
+        shaderCreateInfos[i].pSpecializationInfo = getSpecializationInfo(i);
+    }
 
-        if (specializationMapEntries.size() > 0) {
-            shaderCreateInfos[i].pSpecializationInfo = &specializationInfo;
-        } else {
-            shaderCreateInfos[i].pSpecializationInfo = nullptr;
+    size_t binaryKey = 0;
+    if (!gfx().getShaderCachePath().empty()) {
+        binaryKey = getShaderBinaryKey(shaderCreateInfos);
+
+        VkShaderCreateInfoEXT binaryCreateInfos[MAX_SHADER_STAGE];
+        std::copy_n(shaderCreateInfos, stageCount, binaryCreateInfos);
+        if (loadShaderBinaries(binaryKey, binaryCreateInfos)) {
+            return true;
         }
     }
 
     VkResult result = vkCreateShadersEXT(gfx().device, stageCount, shaderCreateInfos, nullptr, shaders);
-    // If the function returns e.g. VK_ERROR_INCOMPATIBLE_SHADER_BINARY_EXT, the binary file is no longer (or not at all) compatible with the current implementation
-    if (result == VK_SUCCESS) {
-
-        /*
-        if (shaderCodeType == ShaderCodeType::Spirv) {
-                size_t dataSize{ 0 };
-                char* data{ nullptr };
-                std::fstream is;
-
-                g_vkGetShaderBinaryDataEXT(gfx().device, shader, &dataSize, nullptr);
-                data = new char[dataSize];
-                g_vkGetShaderBinaryDataEXT(gfx().device, shader, &dataSize, data);
-                is.open(vsBin, std::ios::binary | std::ios::out);
-                is.write(data, dataSize);
-                is.close();
-                delete[] data;
-        }*/
+    if (result != VK_SUCCESS) {
+        LOG_ERROR("vkCreateShadersEXT failed: {}", tools::errorString(result));
+        return false;
+    }
 
-        return true;
-    } else {
-        std::cout << "Could not load binary shader files (" << tools::errorString(result) << ", loading SPIR - V instead\n";
+    if (binaryKey != 0) {
+        saveShaderBinaries(binaryKey);
     }
+    return true;
 #else
 
 #endif
@@ -391,17 +566,22 @@ VkPipeline VulkanProgram::getGraphicsPipeline(const AttachmentFormats& attachmen
 {
     // assert(ThreadUtils::isThisThread(gfx().renderThreadID));
 
-    size_t pipelineHash = attachmentFormats.getHash();
-
 #if !HAS_DYNAMIC_STATE3
-    pipelineHash = fnv1a(pipelineHash, (const unsigned char*)pipelineState, sizeof(PipelineState));
-    auto it = pipelineCache.find(pipelineHash);
+    GraphicsPipelineKey key(attachmentFormats, *pipelineState);
+    auto it = pipelineCache.find(key);
     if (it != pipelineCache.end()) {
         it->second.lastTime = Clock::now();
+        // VK_NULL_HANDLE while an async compile is in flight
         return it->second.pipeline;
     }
-#else
 
+    if (asyncCompile) {
+        compileAsync(key, attachmentFormats, *pipelineState);
+        return VK_NULL_HANDLE;
+    }
+#else
+    // a single pipeline per attachment formats, always built inline, asyncCompile does not apply
+    size_t pipelineHash = attachmentFormats.getHash();
     if (pipelineHash == pipelineInfo.hash) {
         pipelineInfo.lastTime = Clock::now();
         return pipelineInfo.pipeline;
@@ -410,6 +590,63 @@ VkPipeline VulkanProgram::getGraphicsPipeline(const AttachmentFormats& attachmen
     }
 #endif
 
+    VkPipeline pipe = VK_NULL_HANDLE;
+    if (auto vertexInput = (VulkanVertexInput*)pipelineState->program->vertexInput.get()) {
+        pipe = createGraphicsPipeline(attachmentFormats, pipelineState, vertexInput->bindingDescriptions, vertexInput->attributeDescriptions);
+    } else {
+        pipe = createGraphicsPipeline(attachmentFormats, pipelineState, {}, {});
+    }
+
+#if !HAS_DYNAMIC_STATE3
+    pipelineCache.emplace(key, PipelineInfo { .pipeline = pipe, .hash = key.hash, .lastTime = Clock::now() });
+#else
+    pipelineInfo.hash = pipelineHash;
+    pipelineInfo.pipeline = pipe;
+#endif
+    return pipe;
+}
+
+#if !HAS_DYNAMIC_STATE3
+void VulkanProgram::compileAsync(const GraphicsPipelineKey& key, const AttachmentFormats& attachmentFormats, const PipelineState& pipelineState)
+{
+    pipelineCache.emplace(key, PipelineInfo { .pipeline = VK_NULL_HANDLE, .hash = key.hash, .lastTime = Clock::now() });
+    mPendingPipelines++;
+
+    // The job must not reach back into state the main thread can change while it runs, so it
+    // copies the fixed states and the vertex input descriptions. The advanced state is dynamic and
+    // never read when building the pipeline, it is dropped from the copy. The ref keeps the program.
+    Ref<VulkanProgram> program(this);
+    PipelineState state = pipelineState;
+    state.program = nullptr;
+    state.advanceState = nullptr;
+    std::vector<VkVertexInputBindingDescription2EXT> vertexBindings;
+    std::vector<VkVertexInputAttributeDescription2EXT> vertexAttributes;
+    if (auto vertexInput = (VulkanVertexInput*)pipelineState.program->vertexInput.get()) {
+        vertexBindings = vertexInput->bindingDescriptions;
+        vertexAttributes = vertexInput->attributeDescriptions;
+    }
+
+    gfx().getJobSystem().submit([program, key, attachmentFormats, state, vertexBindings = std::move(vertexBindings), vertexAttributes = std::move(vertexAttributes)]() {
+        VkPipeline pipe = program->createGraphicsPipeline(attachmentFormats, &state, vertexBindings, vertexAttributes);
+
+        gfx().post_async([program, key, pipe]() {
+            // the key has no default state, so the placeholder is looked up rather than indexed
+            auto& info = program->pipelineCache.try_emplace(key).first->second;
+            info.destroy();
+            info = PipelineInfo { .pipeline = pipe, .hash = key.hash, .lastTime = Clock::now() };
+            program->mPendingPipelines--;
+
+            if (program->onPipelineReady) {
+                program->onPipelineReady(program.get());
+            }
+        });
+    });
+}
+#endif
+
+VkPipeline VulkanProgram::createGraphicsPipeline(const AttachmentFormats& attachmentFormats, const PipelineState* pipelineState,
+    Span<const VkVertexInputBindingDescription2EXT> vertexBindings, Span<const VkVertexInputAttributeDescription2EXT> vertexAttributes)
+{
     VkPipelineShaderStageCreateInfo stages[16];
     for (int i = 0; i < mShaderModules.size(); i++) {
         stages[i] = {
@@ -418,6 +655,7 @@ VkPipeline VulkanProgram::getGraphicsPipeline(const AttachmentFormats& attachmen
             .stage = mShaderModules[i]->vkShaderStage,
             .module = mShaderModules[i]->shaderModule,
             .pName = mShaderModules[i]->entryPoint.c_str(),
+            .pSpecializationInfo = getSpecializationInfo(i),
         };
     }
 
@@ -425,28 +663,25 @@ VkPipeline VulkanProgram::getGraphicsPipeline(const AttachmentFormats& attachmen
 #if !HAS_DYNAMIC_STATE3
     VkVertexInputAttributeDescription vertexInputAttributeDescription[16];
     VkVertexInputBindingDescription vertexInputBindingDescription[16];
-    VulkanVertexInput* vertexInput = (VulkanVertexInput*)pipelineState->program->vertexInput.get();
-    if (vertexInput) {
-        for (auto i = 0; i < vertexInput->attributeDescriptions.size(); i++) {
-            vertexInputAttributeDescription[i] = {
-                .location = vertexInput->attributeDescriptions[i].location,
-                .binding = vertexInput->attributeDescriptions[i].binding,
-                .format = vertexInput->attributeDescriptions[i].format,
-                .offset = vertexInput->attributeDescriptions[i].offset
-            };
-        }
-        for (auto i = 0; i < vertexInput->bindingDescriptions.size(); i++) {
-            vertexInputBindingDescription[i] = {
-                .binding = vertexInput->bindingDescriptions[i].binding,
-                .stride = vertexInput->bindingDescriptions[i].stride,
-                .inputRate = vertexInput->bindingDescriptions[i].inputRate
-            };
-        }
-        vertexInputState.pVertexAttributeDescriptions = vertexInputAttributeDescription;
-        vertexInputState.pVertexBindingDescriptions = vertexInputBindingDescription;
-        vertexInputState.vertexAttributeDescriptionCount = (uint32_t)vertexInput->attributeDescriptions.size();
-        vertexInputState.vertexBindingDescriptionCount = (uint32_t)vertexInput->bindingDescriptions.size();
+    for (size_t i = 0; i < vertexAttributes.size(); i++) {
+        vertexInputAttributeDescription[i] = {
+            .location = vertexAttributes[i].location,
+            .binding = vertexAttributes[i].binding,
+            .format = vertexAttributes[i].format,
+            .offset = vertexAttributes[i].offset
+        };
     }
+    for (size_t i = 0; i < vertexBindings.size(); i++) {
+        vertexInputBindingDescription[i] = {
+            .binding = vertexBindings[i].binding,
+            .stride = vertexBindings[i].stride,
+            .inputRate = vertexBindings[i].inputRate
+        };
+    }
+    vertexInputState.pVertexAttributeDescriptions = vertexInputAttributeDescription;
+    vertexInputState.pVertexBindingDescriptions = vertexInputBindingDescription;
+    vertexInputState.vertexAttributeDescriptionCount = (uint32_t)vertexAttributes.size();
+    vertexInputState.vertexBindingDescriptionCount = (uint32_t)vertexBindings.size();
 
 #endif
 
@@ -553,14 +788,7 @@ VkPipeline VulkanProgram::getGraphicsPipeline(const AttachmentFormats& attachmen
     };
 
     VkPipeline pipe = VK_NULL_HANDLE;
-    VK_CHECK_RESULT(vkCreateGraphicsPipelines(gfx().device, VK_NULL_HANDLE, 1, &createInfo, nullptr, &pipe));
-
-#if !HAS_DYNAMIC_STATE3
-    pipelineCache.emplace(pipelineHash, PipelineInfo { .pipeline = pipe, .hash = pipelineHash, .lastTime = Clock::now() });
-#else
-    pipelineInfo.hash = pipelineHash;
-    pipelineInfo.pipeline = pipe;
-#endif
+    VK_CHECK_RESULT(vkCreateGraphicsPipelines(gfx().device, gfx().getPipelineCache(), 1, &createInfo, nullptr, &pipe));
     return pipe;
 }
 
@@ -583,13 +811,14 @@ VkPipeline VulkanProgram::getComputePipeline()
             .stage = mShaderModules[0]->vkShaderStage,
             .module = mShaderModules[0]->shaderModule,
             .pName = mShaderModules[0]->entryPoint.c_str(),
+            .pSpecializationInfo = getSpecializationInfo(0),
         },
         .layout = pipelineLayout,
         .basePipelineHandle = VK_NULL_HANDLE,
         .basePipelineIndex = -1,
     };
 
-    VK_CHECK_RESULT(vkCreateComputePipelines(gfx().device, VK_NULL_HANDLE, 1, &createInfo, nullptr, &pipelineInfo.pipeline));
+    VK_CHECK_RESULT(vkCreateComputePipelines(gfx().device, gfx().getPipelineCache(), 1, &createInfo, nullptr, &pipelineInfo.pipeline));
     return pipelineInfo.pipeline;
 }
 #endif
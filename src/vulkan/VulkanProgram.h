@@ -1,9 +1,12 @@
 #pragma once
 
 #include "../GraphicsHandles.h"
+#include "../PipelineState.h"
 #include "../ShaderResourceInfo.h"
+#include "DescriptorSet.h"
 #include "DescriptorSetLayout.h"
 #include "VulkanDefs.h"
+#include <atomic>
 #include <fstream>
 #include <stdlib.h>
 #include <string>
@@ -13,8 +16,6 @@
 
 namespace mygfx {
 
-class DescriptorSet;
-
 #if !HAS_SHADER_OBJECT_EXT
 
 class VulkanProgram;
@@ -27,7 +28,23 @@ struct PipelineInfo {
     void destroy();
 };
 
-class PipelineCache : public std::unordered_map<size_t, PipelineInfo> {
+// PipelineKey of the state plus the attachment formats the pipeline is built for
+struct GraphicsPipelineKey {
+    PipelineKey state;
+    uint32_t colorAttachmentCount = 0;
+    VkFormat attachmentFormats[10] {};
+    size_t hash = 0;
+
+    GraphicsPipelineKey(const AttachmentFormats& formats, const PipelineState& pipelineState);
+
+    bool operator==(const GraphicsPipelineKey& other) const;
+
+    struct Hasher {
+        size_t operator()(const GraphicsPipelineKey& key) const { return key.hash; }
+    };
+};
+
+class PipelineCache : public std::unordered_map<GraphicsPipelineKey, PipelineInfo, GraphicsPipelineKey::Hasher> {
 public:
     PipelineCache();
     ~PipelineCache();
@@ -40,12 +57,15 @@ public:
 class VulkanProgram : public HwProgram {
 public:
     VulkanProgram();
-    VulkanProgram(Ref<HwShaderModule>* shaderModules, uint32_t count);
+    VulkanProgram(Ref<HwShaderModule>* shaderModules, uint32_t count, const Span<const SpecializationValue>& specializationValues = {});
     ~VulkanProgram();
 
-    ShaderResourceInfo* getShaderResource(const String& name);
-    DescriptorSet* getDescriptorSet(uint32_t index);
-    HwDescriptorSet* createDescriptorSet(uint32_t index);
+    ShaderResourceInfo* getShaderResource(const String& name) override;
+    DescriptorSet* getDescriptorSet(uint32_t index) override;
+    HwDescriptorSet* createDescriptorSet(uint32_t index) override;
+#if !HAS_SHADER_OBJECT_EXT
+    bool isPipelineReady() const override { return mPendingPipelines == 0; }
+#endif
     bool createShaders();
     VkPipelineBindPoint getBindPoint() const { return (VkPipelineBindPoint)programType; }
     static constexpr int MAX_SHADER_STAGE = 8;
@@ -53,9 +73,14 @@ public:
     uint32_t stageCount = 0;
 #if HAS_SHADER_OBJECT_EXT
     VkShaderEXT shaders[MAX_SHADER_STAGE] {};
+    size_t getShaderBinaryKey(const VkShaderCreateInfoEXT* createInfos) const;
+    bool loadShaderBinaries(size_t key, VkShaderCreateInfoEXT* createInfos);
+    void saveShaderBinaries(size_t key) const;
 #else
     VkPipeline getGraphicsPipeline(const AttachmentFormats& attachmentFormats, const struct PipelineState* pipelineState);
     VkPipeline getComputePipeline();
+    VkPipeline createGraphicsPipeline(const AttachmentFormats& attachmentFormats, const struct PipelineState* pipelineState,
+        Span<const VkVertexInputBindingDescription2EXT> vertexBindings, Span<const VkVertexInputAttributeDescription2EXT> vertexAttributes);
     PipelineInfo pipelineInfo;
 #if !HAS_DYNAMIC_STATE3
     PipelineCache pipelineCache;
@@ -69,12 +94,26 @@ public:
     std::map<uint32_t, std::vector<Ref<ShaderResourceInfo>>> combinedBindingMap;
 
 private:
+    void initSpecialization(uint32_t stage, const Span<const SpecializationValue>& specializationValues);
+    const VkSpecializationInfo* getSpecializationInfo(uint32_t stage) const;
+
+    struct Specialization {
+        Vector<VkSpecializationMapEntry> mapEntries;
+        Vector<uint32_t> data;
+        VkSpecializationInfo info {};
+    };
+
     Vector<Ref<VulkanShaderModule>> mShaderModules;
+    Specialization mSpecializations[MAX_SHADER_STAGE];
     Vector<Ref<DescriptorSetLayout>> mDescriptorSetLayouts;
     Vector<VkDescriptorSetLayout> mVkDescriptorSetLayouts;
     ProgramType programType;
     VkShaderCodeTypeEXT shaderCodeType;
     Vector<Ref<DescriptorSet>> mDesciptorSets;
+#if !HAS_SHADER_OBJECT_EXT
+    void compileAsync(const GraphicsPipelineKey& key, const AttachmentFormats& attachmentFormats, const PipelineState& pipelineState);
+    std::atomic<uint32_t> mPendingPipelines = 0;
+#endif
 };
 
 
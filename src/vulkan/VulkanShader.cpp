@@ -1,8 +1,11 @@
 #include "VulkanShader.h"
 #include "VulkanDevice.h"
 #include "VulkanInitializers.hpp"
+#include "utils/FileUtils.h"
 #include "utils/Log.h"
 #include "utils/ThreadUtils.h"
+#include "utils/algorithm.h"
+#include <mutex>
 #include <../third_party/SPIRV-Cross/spirv_glsl.hpp>
 
 using namespace spirv_cross;
@@ -91,17 +94,16 @@ VulkanShaderModule::~VulkanShaderModule()
 #endif
 }
 
-void VulkanShaderModule::collectShaderResource()
+static void reflectShader(ShaderStage shaderStage, VkShaderStageFlagBits vkShaderStage, const ByteArray& shaderCode, ShaderReflection& out)
 {
     auto compiler = std::make_unique<CompilerGLSL>((const uint32_t*)shaderCode.data(), shaderCode.size() / 4);
     auto res = compiler->get_shader_resources();
 
-    pushConstants.clear();
     if (!res.push_constant_buffers.empty()) {
         // LOG_INFO("PushConstant :");
         for (auto& pushConst : res.push_constant_buffers) {
 
-            auto& pc = pushConstants.emplace_back();
+            auto& pc = out.pushConstants.emplace_back();
             pc.stageFlags = shaderStage;
             SPIRType type = compiler->get_type(pushConst.type_id);
             auto strutSize = (uint32_t)compiler->get_declared_struct_size(type);
@@ -124,51 +126,309 @@ void VulkanShaderModule::collectShaderResource()
     // LOG_INFO("uniforms: ");
 
     if (!res.uniform_buffers.empty()) {
-        collectionResource(vkShaderStage, compiler.get(), res.uniform_buffers, shaderResourceInfo);
+        collectionResource(vkShaderStage, compiler.get(), res.uniform_buffers, out.resources);
     }
 
     if (!res.sampled_images.empty()) {
-        collectionResource(vkShaderStage, compiler.get(), res.sampled_images, shaderResourceInfo, true, false);
+        collectionResource(vkShaderStage, compiler.get(), res.sampled_images, out.resources, true, false);
     }
 
     if (!res.storage_buffers.empty()) {
-        collectionResource(vkShaderStage, compiler.get(), res.storage_buffers, shaderResourceInfo, false, true);
+        collectionResource(vkShaderStage, compiler.get(), res.storage_buffers, out.resources, false, true);
     }
 
     if (!res.storage_images.empty()) {
-        collectionResource(vkShaderStage, compiler.get(), res.storage_images, shaderResourceInfo, true, true);
+        collectionResource(vkShaderStage, compiler.get(), res.storage_images, out.resources, true, true);
     }
 
     if (!res.separate_images.empty()) {
-        collectionResource(vkShaderStage, compiler.get(), res.separate_images, shaderResourceInfo, true, false);
+        collectionResource(vkShaderStage, compiler.get(), res.separate_images, out.resources, true, false);
     }
 
     if (!res.separate_samplers.empty()) {
-        collectionResource(vkShaderStage, compiler.get(), res.separate_samplers, shaderResourceInfo);
+        collectionResource(vkShaderStage, compiler.get(), res.separate_samplers, out.resources);
     }
 
     if (!res.subpass_inputs.empty()) {
-        collectionResource(vkShaderStage, compiler.get(), res.subpass_inputs, shaderResourceInfo, false, false, true);
+        collectionResource(vkShaderStage, compiler.get(), res.subpass_inputs, out.resources, false, false, true);
     }
 
     if (!res.atomic_counters.empty()) {
-        collectionResource(vkShaderStage, compiler.get(), res.atomic_counters, shaderResourceInfo);
+        collectionResource(vkShaderStage, compiler.get(), res.atomic_counters, out.resources);
     }
 
     if (!res.acceleration_structures.empty()) {
-        collectionResource(vkShaderStage, compiler.get(), res.acceleration_structures, shaderResourceInfo);
+        collectionResource(vkShaderStage, compiler.get(), res.acceleration_structures, out.resources);
     }
 
     auto specialConsts = compiler->get_specialization_constants();
     for (auto& constant : specialConsts) {
         auto& ct = compiler->get_constant(constant.id);
         SPIRType type = compiler->get_type(ct.constant_type);
-        auto& specConst = specializationConsts.emplace_back();
+        auto& specConst = out.specializationConsts.emplace_back();
         specConst.id = constant.constant_id;
         specConst.type = toUniformType(type, &specConst.size);
     }
 }
 
+void VulkanShaderModule::collectShaderResource()
+{
+    auto reflection = ShaderReflection::get(shaderStage, shaderCode);
+
+    pushConstants = reflection->pushConstants;
+    specializationConsts = reflection->specializationConsts;
+    shaderResourceInfo.clear();
+    for (auto& res : reflection->resources) {
+        auto* info = new ShaderResourceInfo();
+        static_cast<ShaderStruct&>(*info) = *res;
+        info->set = res->set;
+        info->dsLayoutBinding = res->dsLayoutBinding;
+        info->bindless = res->bindless;
+        if (info->bindless) {
+            // device limit, a disk entry may come from another device
+            info->dsLayoutBinding.descriptorCount = gfx().getMaxVariableCount((VkDescriptorType)info->dsLayoutBinding.descriptorType);
+        }
+        shaderResourceInfo.emplace_back(info);
+    }
+}
+
+namespace {
+    constexpr uint32_t REFLECTION_MAGIC = 0x4652474d; // "MGRF"
+    constexpr uint32_t REFLECTION_VERSION = 1;
+
+    std::mutex sReflectionMutex;
+    std::unordered_map<size_t, std::shared_ptr<const ShaderReflection>> sReflections;
+    String sReflectionCacheDir;
+
+    class Writer {
+    public:
+        explicit Writer(ByteArray& out)
+            : mOut(out)
+        {
+        }
+
+        void write(uint32_t v)
+        {
+            auto* p = (const uint8_t*)&v;
+            mOut.insert(mOut.end(), p, p + sizeof(v));
+        }
+
+        void write(const String& str)
+        {
+            write((uint32_t)str.size());
+            mOut.insert(mOut.end(), str.begin(), str.end());
+        }
+
+        void write(const ShaderStruct& s)
+        {
+            write(s.name);
+            write((uint32_t)(int32_t)s.type);
+            write(s.offset);
+            write(s.size);
+            write((uint32_t)s.members.size());
+            for (auto& member : s.members) {
+                write(member);
+            }
+        }
+
+    private:
+        ByteArray& mOut;
+    };
+
+    class Reader {
+    public:
+        explicit Reader(const ByteArray& data)
+            : mData(data)
+        {
+        }
+
+        bool read(uint32_t& v)
+        {
+            if (mPos + sizeof(v) > mData.size()) {
+                return false;
+            }
+            memcpy(&v, mData.data() + mPos, sizeof(v));
+            mPos += sizeof(v);
+            return true;
+        }
+
+        bool read(String& str)
+        {
+            uint32_t size;
+            if (!read(size) || mPos + size > mData.size()) {
+                return false;
+            }
+            str.assign((const char*)mData.data() + mPos, size);
+            mPos += size;
+            return true;
+        }
+
+        bool read(ShaderStruct& s, uint32_t depth = 0)
+        {
+            uint32_t type, count;
+            if (depth > 32 || !read(s.name) || !read(type) || !read(s.offset) || !read(s.size) || !read(count)) {
+                return false;
+            }
+
+            s.type = (UniformType)(int32_t)type;
+            s.members.clear();
+            for (uint32_t i = 0; i < count; i++) {
+                if (!read(s.members.emplace_back(), depth + 1)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        bool atEnd() const { return mPos == mData.size(); }
+
+    private:
+        const ByteArray& mData;
+        size_t mPos = 0;
+    };
+}
+
+void ShaderReflection::serialize(ByteArray& out) const
+{
+    Writer writer(out);
+    writer.write(REFLECTION_MAGIC);
+    writer.write(REFLECTION_VERSION);
+
+    writer.write((uint32_t)pushConstants.size());
+    for (auto& pc : pushConstants) {
+        writer.write(pc);
+        writer.write((uint32_t)pc.stageFlags);
+    }
+
+    writer.write((uint32_t)resources.size());
+    for (auto& res : resources) {
+        writer.write(*res);
+        writer.write(res->set);
+        writer.write(res->dsLayoutBinding.binding);
+        writer.write((uint32_t)res->dsLayoutBinding.descriptorType);
+        writer.write(res->dsLayoutBinding.descriptorCount);
+        writer.write((uint32_t)res->dsLayoutBinding.stageFlags);
+        writer.write(res->dsLayoutBinding.name);
+        writer.write((uint32_t)res->bindless);
+    }
+
+    writer.write((uint32_t)specializationConsts.size());
+    for (auto& sc : specializationConsts) {
+        writer.write(sc.id);
+        writer.write((uint32_t)(int32_t)sc.type);
+        writer.write(sc.size);
+    }
+}
+
+bool ShaderReflection::deserialize(const ByteArray& data)
+{
+    Reader reader(data);
+    uint32_t magic, version, count, value;
+    if (!reader.read(magic) || magic != REFLECTION_MAGIC || !reader.read(version) || version != REFLECTION_VERSION) {
+        return false;
+    }
+
+    if (!reader.read(count)) {
+        return false;
+    }
+    pushConstants.resize(count);
+    for (auto& pc : pushConstants) {
+        if (!reader.read(pc) || !reader.read(value)) {
+            return false;
+        }
+        pc.stageFlags = (ShaderStage)value;
+    }
+
+    if (!reader.read(count)) {
+        return false;
+    }
+    resources.clear();
+    for (uint32_t i = 0; i < count; i++) {
+        Ref<ShaderResourceInfo> res = new ShaderResourceInfo();
+        uint32_t descriptorType, stageFlags, bindless;
+        if (!reader.read(*res) || !reader.read(res->set) || !reader.read(res->dsLayoutBinding.binding)
+            || !reader.read(descriptorType) || !reader.read(res->dsLayoutBinding.descriptorCount)
+            || !reader.read(stageFlags) || !reader.read(res->dsLayoutBinding.name) || !reader.read(bindless)) {
+            return false;
+        }
+        res->dsLayoutBinding.descriptorType = (DescriptorType)descriptorType;
+        res->dsLayoutBinding.stageFlags = (ShaderStage)stageFlags;
+        res->dsLayoutBinding.pImmutableSamplers = nullptr;
+        res->bindless = bindless != 0;
+        resources.push_back(res);
+    }
+
+    if (!reader.read(count)) {
+        return false;
+    }
+    specializationConsts.resize(count);
+    for (auto& sc : specializationConsts) {
+        if (!reader.read(sc.id) || !reader.read(value) || !reader.read(sc.size)) {
+            return false;
+        }
+        sc.type = (UniformType)(int32_t)value;
+    }
+
+    return reader.atEnd();
+}
+
+void ShaderReflection::setCacheDir(const String& dir)
+{
+    std::lock_guard locker(sReflectionMutex);
+    sReflectionCacheDir = dir;
+}
+
+std::shared_ptr<const ShaderReflection> ShaderReflection::get(ShaderStage stage, const ByteArray& shaderCode)
+{
+    size_t key = utils::fnv1a(utils::_FNV_offset_basis, shaderCode.data(), shaderCode.size());
+    key = utils::fnv1a(key, (const unsigned char*)&stage, sizeof(stage));
+
+    String cacheDir;
+    {
+        std::lock_guard locker(sReflectionMutex);
+        auto it = sReflections.find(key);
+        if (it != sReflections.end()) {
+            return it->second;
+        }
+        cacheDir = sReflectionCacheDir;
+    }
+
+    auto reflection = std::make_shared<ShaderReflection>();
+    String path;
+    bool loaded = false;
+    if (!cacheDir.empty()) {
+        char name[32];
+        snprintf(name, sizeof(name), "/%016llx.refl", (unsigned long long)key);
+        path = cacheDir + name;
+
+        std::ifstream is(path, std::ios::binary | std::ios::in | std::ios::ate);
+        if (is.is_open()) {
+            ByteArray data((size_t)is.tellg());
+            is.seekg(0, std::ios::beg);
+            is.read((char*)data.data(), data.size());
+            loaded = is && reflection->deserialize(data);
+            if (!loaded) {
+                *reflection = {};
+            }
+        }
+    }
+
+    if (!loaded) {
+        reflectShader(stage, ToVkShaderStage(stage), shaderCode, *reflection);
+
+        if (!path.empty()) {
+            ByteArray data;
+            reflection->serialize(data);
+
+            utils::FileUtils::writeAtomic(path, data.data(), data.size());
+        }
+    }
+
+    std::lock_guard locker(sReflectionMutex);
+    // another thread may have reflected the same blob meanwhile, keep the first
+    return sReflections.emplace(key, std::move(reflection)).first->second;
+}
+
 static VkDescriptorType getDescriptorType(const Compiler* compiler, const spirv_cross::Resource& resource, bool image, bool storage, bool input)
 {
     SPIRType type = compiler->get_type(resource.type_id);
@@ -12,6 +12,22 @@
 
 namespace mygfx {
 
+// Everything collectShaderResource reads out of a SPIR-V blob. SPIRV-Cross parsing is pure and a
+// noticeable part of load time, so results are cached per blob and stage for the process lifetime,
+// and in the shader cache dir when Settings::shaderCachePath is set. Cached entries are never
+// modified, modules get their own copies since programs merge stage flags into them.
+struct ShaderReflection {
+    Vector<Ref<ShaderResourceInfo>> resources;
+    Vector<PushConstant> pushConstants;
+    Vector<SpecializationConst> specializationConsts;
+
+    void serialize(ByteArray& out) const;
+    bool deserialize(const ByteArray& data);
+
+    static void setCacheDir(const String& dir);
+    static std::shared_ptr<const ShaderReflection> get(ShaderStage stage, const ByteArray& shaderCode);
+};
+
 class VulkanShaderModule : public HwShaderModule {
 public:
     VulkanShaderModule(ShaderStage stage, const std::vector<uint8_t>& shaderCode, ShaderCodeType shaderCodeType = ShaderCodeType::SPIRV, const char* pShaderEntryPoint = nullptr);
@@ -18,7 +18,8 @@ VulkanTexture::VulkanTexture(VkImage image, VkFormat format)
     mRTV = createRTV(0);
     isSwapchain = true;
 
-    initState(ResourceState::PRESENT);
+    // swapchain images are acquired in an undefined layout
+    initState(ResourceState::UNDEFINED);
 }
 
 VulkanTexture::~VulkanTexture()
@@ -31,7 +32,11 @@ void VulkanTexture::destroy()
     if (!isSwapchain && mImage != VK_NULL_HANDLE) {
         auto img = mImage;
         auto mem = mImageAlloc;
-        vmaDestroyImage(gfx().getVmaAllocator(), img, mem);
+        if (mTransient) {
+            gfx().getTransientHeap().destroyImage(img, mem);
+        } else {
+            vmaDestroyImage(gfx().getVmaAllocator(), img, mem);
+        }
 
         mImage = VK_NULL_HANDLE;
         mImageAlloc = nullptr;
@@ -88,33 +93,34 @@ bool VulkanTexture::create(const TextureData& textureData)
     mSamples = (VkSampleCountFlagBits)textureData.sampleCount;
     usage = (VkImageUsageFlags)textureData.usage;
 
+    if (any(textureData.usage & TextureUsage::TRANSIENT_ATTACHMENT)) {
+        // transient images can only be used as attachments inside a pass
+        assert(any(textureData.usage & (TextureUsage::COLOR_ATTACHMENT | TextureUsage::DEPTH_STENCIL_ATTACHMENT)));
+        usage &= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT
+            | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+        mTransient = true;
+    }
+
     if (any(textureData.usage & TextureUsage::DEPTH_STENCIL_ATTACHMENT)) {
 
+        // attachments start undefined, the first pass transitions them
+        initState(ResourceState::UNDEFINED);
         initDepthStencil(textureData.name.c_str());
 
-        if (any(textureData.usage & TextureUsage::SAMPLED))
-            initState(ResourceState::SHADER_RESOURCE);
-        else
-            initState(ResourceState::COMMON_RESOURCE);
-
     } else if (any(textureData.usage & TextureUsage::COLOR_ATTACHMENT)) {
 
+        initState(ResourceState::UNDEFINED);
         initRenderTarget(textureData.name.c_str());
 
-        if (any(textureData.usage & TextureUsage::SAMPLED))
-            initState(ResourceState::SHADER_RESOURCE);
-        else
-            initState(ResourceState::COMMON_RESOURCE);
-
     } else {
 
-        initState(ResourceState::COPY_DEST);
+        initState(ResourceState::UNDEFINED);
 
         initFromData(textureData);
-
-        initSubResourceCount(mipLevels * layerCount * faceCount);
     }
 
+    initSubResourceCount(mipLevels * layerCount * faceCount);
+
     return true;
 }
 
@@ -278,8 +284,6 @@ void VulkanTexture::initRenderTarget(const char* name, VkImageCreateFlags flags)
     if (usage & VK_IMAGE_USAGE_SAMPLED_BIT) {
         createSRV();
     }
-
-    setImageLayout(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
 }
 
 void VulkanTexture::initDepthStencil(const char* name)
@@ -316,6 +320,14 @@ void VulkanTexture::createImage(VkImageCreateInfo* pCreateInfo, const char* name
 {
     mSamples = pCreateInfo->samples;
 
+    if (mTransient) {
+        VkResult res = gfx().getTransientHeap().createImage(*pCreateInfo, name, &mImage, &mImageAlloc);
+        assert(res == VK_SUCCESS);
+        if (name)
+            gfx().setResourceName(VK_OBJECT_TYPE_IMAGE, (uint64_t)mImage, name);
+        return;
+    }
+
     VmaAllocationCreateInfo imageAllocCreateInfo = {};
     imageAllocCreateInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
     imageAllocCreateInfo.flags = VMA_ALLOCATION_CREATE_USER_DATA_COPY_STRING_BIT;
@@ -327,6 +339,11 @@ void VulkanTexture::createImage(VkImageCreateInfo* pCreateInfo, const char* name
         gfx().setResourceName(VK_OBJECT_TYPE_IMAGE, (uint64_t)mImage, name);
 }
 
+bool VulkanTexture::isAliased() const
+{
+    return mTransient && gfx().getTransientHeap().isAliased(mImageAlloc);
+}
+
 Ref<VulkanTextureView> VulkanTexture::createSRV(int mipLevel, const char* name)
 {
     VkImageViewCreateInfo info = {};
@@ -352,6 +369,7 @@ Ref<VulkanTextureView> VulkanTexture::createSRV(int mipLevel, const char* name)
 
     info.subresourceRange.baseArrayLayer = 0;
     auto srv = makeShared<VulkanTextureView>(info, (VulkanSampler*)mSampler.get(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, name);
+    srv->mTexture = this;
     mSRVs.push_back(srv);
     return srv;
 }
@@ -396,6 +414,7 @@ Ref<VulkanTextureView> VulkanTexture::createRTV(int mipLevel, const char* name)
     }
 
     auto rtv = makeShared<VulkanTextureView>(info, ResourceName.c_str());
+    rtv->mTexture = this;
     mRTVs.push_back(rtv);
     return rtv;
 }
@@ -418,7 +437,9 @@ Ref<VulkanTextureView> VulkanTexture::createDSV(const char* name)
         view_info.subresourceRange.aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
     }
 
-    return makeShared<VulkanTextureView>(view_info, name);
+    auto dsv = makeShared<VulkanTextureView>(view_info, name);
+    dsv->mTexture = this;
+    return dsv;
 }
 
 void VulkanTexture::createSRV()
@@ -431,6 +452,32 @@ int VulkanTexture::index() const
     return mSRV->index();
 }
 
+uint32_t VulkanTexture::subresourceIndex(uint32_t mipLevel, uint32_t layer) const
+{
+    if (mCurrentStates.size() <= 1) {
+        return 0;
+    }
+
+    return mipLevel + layer * mipLevels;
+}
+
+void VulkanTexture::setSubresourceState(const VkImageSubresourceRange& range, ResourceState state)
+{
+    uint32_t totalLayers = (uint32_t)layerCount * faceCount;
+    uint32_t levels = range.levelCount == VK_REMAINING_MIP_LEVELS ? mipLevels - range.baseMipLevel : range.levelCount;
+    uint32_t layers = range.layerCount == VK_REMAINING_ARRAY_LAYERS ? totalLayers - range.baseArrayLayer : range.layerCount;
+    if (mCurrentStates.size() <= 1 || (levels == mipLevels && layers == totalLayers)) {
+        setCurrentResourceState(state);
+        return;
+    }
+
+    for (uint32_t layer = range.baseArrayLayer; layer < range.baseArrayLayer + layers; layer++) {
+        for (uint32_t level = range.baseMipLevel; level < range.baseMipLevel + levels; level++) {
+            setCurrentResourceState(state, subresourceIndex(level, layer));
+        }
+    }
+}
+
 void VulkanTexture::setSampler(SamplerInfo samplerInfo)
 {
     mSampler = gfx().createSampler(samplerInfo);
@@ -460,7 +507,7 @@ void VulkanTexture::setImageLayout(VkImageLayout oldImageLayout, VkImageLayout n
 
 void VulkanTexture::setImageLayout(VkImageLayout oldImageLayout, VkImageLayout newImageLayout, VkImageSubresourceRange subresourceRange)
 {
-    gfx().executeCommand(CommandQueueType::Copy, [&](const auto& commandBuffer) {
+    gfx().recordUpload([&](const auto& commandBuffer) {
         commandBuffer.setImageLayout(mImage, oldImageLayout, newImageLayout, subresourceRange);
     });
 
@@ -551,6 +598,8 @@ bool VulkanTexture::copyData(TextureDataProvider* dataProvider)
 
     gfx().getUploadHeap().finish();
 
+    setCurrentResourceState(ResourceState::SHADER_RESOURCE);
+
     if (mSRV == nullptr) {
         createSRV();
     }
@@ -618,6 +667,8 @@ void VulkanTexture::setData(uint32_t level, int x, int y, uint32_t w, uint32_t h
 
     gfx().getUploadHeap().AddPostBarrier(use_barrier);
     gfx().getUploadHeap().finish();
+
+    setSubresourceState(subresourceRange, ResourceState::SHADER_RESOURCE);
 }
 
 void VulkanTexture::setData(uint32_t level, int x, int y, int z, uint32_t w, uint32_t h, uint32_t depth, const void* data, size_t size)
@@ -687,6 +738,8 @@ void VulkanTexture::setData(uint32_t level, int x, int y, int z, uint32_t w, uin
 
     gfx().getUploadHeap().AddPostBarrier(use_barrier);
     gfx().getUploadHeap().finish();
+
+    setSubresourceState(transitionRange, ResourceState::SHADER_RESOURCE);
 }
 
 void VulkanTexture::setData(uint32_t level, int x, int y, uint32_t w, uint32_t h, const void* data, uint32_t size)
@@ -54,6 +54,14 @@ public:
     void setData(uint32_t level, int x, int y, int z, uint32_t w, uint32_t h, uint32_t depth, const void* data, size_t size);
     void destroy();
 
+    // index of a subresource in mCurrentStates
+    uint32_t subresourceIndex(uint32_t mipLevel, uint32_t layer) const;
+    void setSubresourceState(const VkImageSubresourceRange& range, ResourceState state);
+
+    // memory comes from the transient heap and may be shared with other transient attachments
+    bool isTransient() const { return mTransient; }
+    bool isAliased() const;
+
     bool isSwapchain = false;
     VkFormat vkFormat;
     VkImageUsageFlags usage;
@@ -69,6 +77,7 @@ private:
     Ref<SamplerHandle> mSampler;
     VkImageLayout mImageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
     VkSampleCountFlagBits mSamples = VK_SAMPLE_COUNT_1_BIT;
+    bool mTransient = false;
     Vector<Ref<VulkanTextureView>> mSRVs;
     Vector<Ref<VulkanTextureView>> mRTVs;
 };
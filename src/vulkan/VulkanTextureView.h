@@ -7,6 +7,7 @@
 namespace mygfx {
 
 class VulkanSampler;
+class VulkanTexture;
 
 class VulkanTextureView : public HwTextureView, public HandleUnique<VkImageView> {
 public:
@@ -19,13 +20,17 @@ public:
     VkFormat format() const { return mViewInfo.format; }
     const VkImageSubresourceRange& subresourceRange() const { return mViewInfo.subresourceRange; }
     const VkDescriptorImageInfo& descriptorInfo() const { return mDescriptor; }
+    // texture the view was created from, its state is tracked for barriers
+    VulkanTexture* texture() const { return mTexture; }
 
     void updateDescriptor(VulkanSampler* sampler, VkImageLayout imageLayout);
     void destroy();
 private:
     VkImageViewCreateInfo mViewInfo;
     VkDescriptorImageInfo mDescriptor;
+    VulkanTexture* mTexture = nullptr;
 
     friend class DescriptorTable;
+    friend class VulkanTexture;
 };
 }
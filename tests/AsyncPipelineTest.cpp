@@ -0,0 +1,91 @@
+#include "TestUtils.h"
+#include "vulkan/VulkanDevice.h"
+#include "vulkan/VulkanProgram.h"
+#include <chrono>
+#include <thread>
+
+using namespace mygfx;
+
+namespace {
+
+// void main() {} as a SPIR-V 1.0 vertex shader
+const uint32_t EMPTY_VERTEX_SHADER[] = {
+    0x07230203, 0x00010000, 0, 5, 0,
+    0x00020011, 1, // OpCapability Shader
+    0x0003000e, 0, 1, // OpMemoryModel Logical GLSL450
+    0x0005000f, 0, 1, 0x6e69616d, 0, // OpEntryPoint Vertex %1 "main"
+    0x00020013, 2, // %2 = OpTypeVoid
+    0x00030021, 3, 2, // %3 = OpTypeFunction %2
+    0x00050036, 2, 1, 0, 3, // %1 = OpFunction %2 None %3
+    0x000200f8, 4, // OpLabel
+    0x000100fd, // OpReturn
+    0x00010038, // OpFunctionEnd
+};
+
+#if !HAS_SHADER_OBJECT_EXT
+
+// The first draw of a variant gets no pipeline and queues a compile, the result replaces the
+// placeholder once the render thread runs the posted calls.
+void swapPlaceholder(VulkanDevice& device)
+{
+    ByteArray code((const uint8_t*)EMPTY_VERTEX_SHADER, (const uint8_t*)EMPTY_VERTEX_SHADER + sizeof(EMPTY_VERTEX_SHADER));
+    Ref<HwShaderModule> vertexShader = device.createShaderModule(ShaderStage::VERTEX, code, ShaderCodeType::SPIRV, "main");
+    Ref<HwProgram> program = device.createProgram(&vertexShader, 1, {});
+    auto vkProgram = (VulkanProgram*)program.get();
+
+    uint32_t readyCount = 0;
+    vkProgram->asyncCompile = true;
+    vkProgram->onPipelineReady = [&readyCount](HwProgram*) { readyCount++; };
+
+    PipelineState state { .program = program.get() };
+    AttachmentFormats formats {};
+    formats.calculateHash();
+
+    CHECK(vkProgram->getGraphicsPipeline(formats, &state) == VK_NULL_HANDLE);
+    CHECK(!vkProgram->isPipelineReady());
+    // still compiling, the placeholder is returned without queuing the variant again
+    CHECK(vkProgram->getGraphicsPipeline(formats, &state) == VK_NULL_HANDLE);
+    CHECK(vkProgram->pipelineCache.size() == 1);
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    while (!vkProgram->isPipelineReady() && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        device.executePostCommands();
+    }
+
+    CHECK(vkProgram->isPipelineReady());
+    CHECK(readyCount == 1);
+    CHECK(vkProgram->pipelineCache.size() == 1);
+
+    VkPipeline pipeline = vkProgram->getGraphicsPipeline(formats, &state);
+    CHECK(pipeline != VK_NULL_HANDLE);
+    CHECK(pipeline == vkProgram->pipelineCache.begin()->second.pipeline);
+    CHECK(readyCount == 1);
+}
+
+#endif
+
+}
+
+int main(int argc, char** argv)
+{
+#if HAS_SHADER_OBJECT_EXT
+    printf("shader objects have no pipeline variants, skipped\n");
+    return test::SKIPPED;
+#else
+    Settings settings { .name = "AsyncPipelineTest" };
+    auto device = new VulkanDevice();
+    if (!device->create(settings)) {
+        printf("no Vulkan device, skipped\n");
+        delete device;
+        return test::SKIPPED;
+    }
+
+    // the compile callbacks run on this thread, standing in for the render thread
+    SyncContext::renderThreadID = std::this_thread::get_id();
+    swapPlaceholder(*device);
+
+    delete device;
+    return test::result();
+#endif
+}
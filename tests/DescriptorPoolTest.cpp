@@ -0,0 +1,137 @@
+#include "TestUtils.h"
+#include "vulkan/VulkanDevice.h"
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace mygfx;
+
+namespace {
+
+struct AllocatedSet {
+    PoolInfo* pool;
+    VkDescriptorSet set;
+};
+
+constexpr uint32_t ROUNDS = 200;
+constexpr uint32_t THREADS = 4;
+// spans a few pools per thread, they double from MIN_POOL_SETS
+constexpr uint32_t SETS_PER_THREAD = 100;
+
+VkDescriptorSetLayout createLayout(VkDevice device)
+{
+    VkDescriptorSetLayoutBinding binding {};
+    binding.binding = 0;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    binding.descriptorCount = 1;
+    binding.stageFlags = VK_SHADER_STAGE_ALL;
+
+    VkDescriptorSetLayoutCreateInfo layoutCI { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
+    layoutCI.bindingCount = 1;
+    layoutCI.pBindings = &binding;
+
+    VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+    vkCreateDescriptorSetLayout(device, &layoutCI, nullptr, &layout);
+    return layout;
+}
+
+bool allocateSet(DescriptorPoolManager& pools, VkDescriptorSetLayout layout, AllocatedSet& out)
+{
+    DescriptorResourceCounts counts {};
+    counts[VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER] = 1;
+
+    VkDescriptorSetAllocateInfo allocInfo { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &layout;
+    out.pool = pools.allocate(counts, false, allocInfo, &out.set);
+    return out.pool != nullptr;
+}
+
+// Threads allocate and exit, handing their pools back as orphans. Workers then free those sets,
+// draining pools, while short lived threads keep acquiring pools, which reclaims and destroys the
+// orphans. A pool must not be destroyed while a free still uses it.
+void freeWhileAcquiring(DescriptorPoolManager& pools, VkDescriptorSetLayout layout)
+{
+    for (uint32_t round = 0; round < ROUNDS; round++) {
+        std::mutex lock;
+        std::vector<AllocatedSet> sets;
+        std::atomic<bool> failed = false;
+
+        std::vector<std::thread> allocators;
+        for (uint32_t i = 0; i < THREADS; i++) {
+            allocators.emplace_back([&]() {
+                for (uint32_t j = 0; j < SETS_PER_THREAD; j++) {
+                    AllocatedSet set;
+                    if (!allocateSet(pools, layout, set)) {
+                        failed = true;
+                        return;
+                    }
+
+                    std::lock_guard<std::mutex> guard(lock);
+                    sets.push_back(set);
+                }
+            });
+        }
+
+        for (auto& thread : allocators) {
+            thread.join();
+        }
+
+        std::atomic<size_t> next = 0;
+        std::vector<std::thread> freers;
+        for (uint32_t i = 0; i < THREADS; i++) {
+            freers.emplace_back([&]() {
+                for (size_t index = next++; index < sets.size(); index = next++) {
+                    pools.free(sets[index].pool, sets[index].set);
+                }
+            });
+        }
+
+        // the first allocation of a new thread acquires a pool, which reclaims the orphans
+        std::vector<AllocatedSet> acquired;
+        while (next < sets.size()) {
+            std::thread([&]() {
+                AllocatedSet set;
+                if (allocateSet(pools, layout, set)) {
+                    acquired.push_back(set);
+                } else {
+                    failed = true;
+                }
+            }).join();
+        }
+
+        for (auto& thread : freers) {
+            thread.join();
+        }
+
+        for (auto& set : acquired) {
+            pools.free(set.pool, set.set);
+        }
+
+        CHECK(!failed);
+    }
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    Settings settings { .name = "DescriptorPoolTest" };
+    auto device = new VulkanDevice();
+    if (!device->create(settings)) {
+        printf("no Vulkan device, skipped\n");
+        delete device;
+        return test::SKIPPED;
+    }
+
+    VkDescriptorSetLayout layout = createLayout(device->device);
+    CHECK(layout != VK_NULL_HANDLE);
+    if (layout != VK_NULL_HANDLE) {
+        freeWhileAcquiring(device->getDescriptorPools(), layout);
+        vkDestroyDescriptorSetLayout(device->device, layout, nullptr);
+    }
+
+    delete device;
+    return test::result();
+}
@@ -0,0 +1,125 @@
+#include "DynamicBufferPool.h"
+#include "TestUtils.h"
+#include "null/NullDevice.h"
+#include <deque>
+#include <vector>
+
+using namespace mygfx;
+
+namespace {
+
+constexpr uint32_t BACK_BUFFERS = 3;
+constexpr uint32_t RING_SIZE = 3072;
+constexpr uint32_t ALLOC_SIZE = 256;
+
+struct Allocation {
+    HwBuffer* buffer;
+    uint32_t offset;
+    uint32_t range;
+};
+
+// allocations of the frames the GPU may still be reading, the current one last
+using FrameAllocations = std::deque<std::vector<Allocation>>;
+
+bool overlaps(const Allocation& a, const Allocation& b)
+{
+    return a.buffer == b.buffer && a.offset < b.offset + b.range && b.offset < a.offset + a.range;
+}
+
+void beginFrame(DynamicBufferPool& pool, FrameAllocations& frames)
+{
+    pool.onFrameChange();
+    frames.emplace_back();
+    if (frames.size() > BACK_BUFFERS) {
+        frames.pop_front();
+    }
+}
+
+// Allocates count blocks, each must not overlap memory of a frame still in flight
+void allocate(DynamicBufferPool& pool, FrameAllocations& frames, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        void* data = nullptr;
+        BufferInfo info;
+        bool allocated = pool.allocBuffer(ALLOC_SIZE, &data, &info);
+        CHECK(allocated);
+        if (!allocated) {
+            return;
+        }
+
+        Allocation allocation { info.buffer, info.offset, info.range };
+        for (auto& frame : frames) {
+            for (auto& other : frame) {
+                CHECK(!overlaps(allocation, other));
+            }
+        }
+        frames.back().push_back(allocation);
+    }
+}
+
+// Every frame needs more than its share of the ring. The chained buffer's memory is reused as the
+// frames that wrote it retire, instead of chaining more buffers.
+void overflowEveryFrame()
+{
+    DynamicBufferPool pool;
+    pool.create(BufferUsage::VERTEX, BACK_BUFFERS, RING_SIZE, "overflow");
+
+    FrameAllocations frames;
+    frames.emplace_back();
+    for (uint32_t frame = 0; frame < 100; frame++) {
+        beginFrame(pool, frames);
+        allocate(pool, frames, 8);
+
+        auto stats = pool.getStats();
+        CHECK(stats.chainedBufferCount <= 1);
+        CHECK(stats.failedCount == 0);
+    }
+    CHECK(pool.getStats().chainedBufferCount == 1);
+
+    pool.destroy();
+}
+
+// Once the frames fit in the ring again the chain is released and everything comes from the ring
+void reuseAfterChain()
+{
+    DynamicBufferPool pool;
+    pool.create(BufferUsage::VERTEX, BACK_BUFFERS, RING_SIZE, "reuse");
+
+    FrameAllocations frames;
+    frames.emplace_back();
+    for (uint32_t frame = 0; frame < 10; frame++) {
+        beginFrame(pool, frames);
+        allocate(pool, frames, 2 * RING_SIZE / ALLOC_SIZE);
+    }
+    CHECK(pool.getStats().chainedBufferCount > 0);
+
+    // the ring has room again once the overflowing frames retired, the chain goes quiet from there
+    for (uint32_t frame = 0; frame < 2 * BACK_BUFFERS + DynamicBufferPool::MAX_QUIET_FRAMES; frame++) {
+        beginFrame(pool, frames);
+        allocate(pool, frames, 1);
+        if (frame >= BACK_BUFFERS) {
+            CHECK(frames.back().back().buffer == pool.getBuffer());
+        }
+    }
+
+    CHECK(pool.getStats().chainedBufferCount == 0);
+    pool.destroy();
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    Settings settings { .name = "DynamicBufferPoolTest" };
+    auto device = new NullDevice();
+    if (!device->create(settings)) {
+        delete device;
+        return 1;
+    }
+
+    overflowEveryFrame();
+    reuseAfterChain();
+
+    delete device;
+    return test::result();
+}
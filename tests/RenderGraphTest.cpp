@@ -0,0 +1,213 @@
+#include "GraphicsApi.h"
+#include "RenderGraph.h"
+#include "TestUtils.h"
+#include "null/NullDevice.h"
+
+using namespace mygfx;
+
+namespace {
+
+const RenderGraphTextureDesc COLOR_DESC { 256, 256, Format::R8G8B8A8_UNORM };
+const RenderGraphTextureDesc HALF_DESC { 128, 128, Format::R8G8B8A8_UNORM };
+
+// Two passes rendering to a texture nobody reads, the second one loads what the first cleared
+void cullUnusedReadModifyWrite()
+{
+    RenderGraph graph;
+    RenderGraphTexture color;
+    graph.addPass("clear", [&](RenderGraphBuilder& builder) {
+        color = builder.createTexture("color", COLOR_DESC);
+        builder.setColorAttachment(0, color, true);
+    }, nullptr);
+    graph.addPass("blend", [&](RenderGraphBuilder& builder) {
+        builder.setColorAttachment(0, color);
+    }, nullptr);
+
+    graph.compile();
+    CHECK(graph.isPassCulled(0));
+    CHECK(graph.isPassCulled(1));
+}
+
+// The same chain is kept once a pass with a side effect samples the result
+void keepReadModifyWrite()
+{
+    RenderGraph graph;
+    RenderGraphTexture color;
+    graph.addPass("clear", [&](RenderGraphBuilder& builder) {
+        color = builder.createTexture("color", COLOR_DESC);
+        builder.setColorAttachment(0, color, true);
+    }, nullptr);
+    graph.addPass("blend", [&](RenderGraphBuilder& builder) {
+        builder.setColorAttachment(0, color);
+    }, nullptr);
+    graph.addPass("present", [&](RenderGraphBuilder& builder) {
+        builder.read(color);
+        builder.sideEffect();
+    }, nullptr);
+
+    graph.compile();
+    CHECK(!graph.isPassCulled(0));
+    CHECK(!graph.isPassCulled(1));
+    CHECK(!graph.isPassCulled(2));
+}
+
+// A live pass loading a texture keeps its earlier writer, even if nothing reads the texture later
+void keepLoadedWriter()
+{
+    RenderGraph graph;
+    RenderGraphTexture color;
+    RenderGraphTexture result;
+    graph.addPass("clear", [&](RenderGraphBuilder& builder) {
+        color = builder.createTexture("color", COLOR_DESC);
+        builder.setColorAttachment(0, color, true);
+    }, nullptr);
+    graph.addPass("blend", [&](RenderGraphBuilder& builder) {
+        result = builder.createTexture("result", COLOR_DESC);
+        builder.setColorAttachment(0, color);
+        builder.write(result);
+    }, nullptr);
+    graph.addPass("unused", [&](RenderGraphBuilder& builder) {
+        builder.write(builder.createTexture("unused", COLOR_DESC));
+    }, nullptr);
+    graph.addPass("present", [&](RenderGraphBuilder& builder) {
+        builder.read(result);
+        builder.sideEffect();
+    }, nullptr);
+
+    graph.compile();
+    CHECK(!graph.isPassCulled(0));
+    CHECK(!graph.isPassCulled(1));
+    CHECK(graph.isPassCulled(2));
+    CHECK(!graph.isPassCulled(3));
+}
+
+// a -> b -> c, a and c have disjoint lifetimes and share a slot, b overlaps both
+void assignSlots()
+{
+    RenderGraph graph;
+    RenderGraphTexture a, b, c, half;
+    graph.addPass("a", [&](RenderGraphBuilder& builder) {
+        a = builder.write(builder.createTexture("a", COLOR_DESC));
+    }, nullptr);
+    graph.addPass("b", [&](RenderGraphBuilder& builder) {
+        builder.read(a);
+        b = builder.write(builder.createTexture("b", COLOR_DESC));
+    }, nullptr);
+    graph.addPass("c", [&](RenderGraphBuilder& builder) {
+        builder.read(b);
+        c = builder.write(builder.createTexture("c", COLOR_DESC));
+        half = builder.write(builder.createTexture("half", HALF_DESC));
+    }, nullptr);
+    graph.addPass("present", [&](RenderGraphBuilder& builder) {
+        builder.read(c);
+        builder.read(half);
+        builder.sideEffect();
+    }, nullptr);
+
+    graph.compile();
+    CHECK(graph.getPhysicalIndex(a) == graph.getPhysicalIndex(c));
+    CHECK(graph.getPhysicalIndex(a) != graph.getPhysicalIndex(b));
+    CHECK(graph.getPhysicalIndex(half) != graph.getPhysicalIndex(a));
+    CHECK(graph.getPhysicalIndex(half) != graph.getPhysicalIndex(b));
+}
+
+// Only the live passes run, with physical resources acquired from the pool
+void executeLivePasses(GraphicsApi& cmd)
+{
+    RenderGraph graph;
+    RenderGraphTexture texture;
+    RenderGraphBuffer buffer;
+    bool culledRan = false;
+    bool writeRan = false;
+    bool readRan = false;
+    graph.addPass("write", [&](RenderGraphBuilder& builder) {
+        texture = builder.write(builder.createTexture("texture", COLOR_DESC));
+        buffer = builder.write(builder.createBuffer("buffer", { BufferUsage::STORAGE, 1024 }));
+    }, [&](GraphicsApi&, const RenderGraphResources& resources) {
+        writeRan = resources.getTexture(texture) != nullptr && resources.getBuffer(buffer) != nullptr;
+    });
+    graph.addPass("culled", [&](RenderGraphBuilder& builder) {
+        builder.read(texture);
+        builder.write(builder.createTexture("unused", COLOR_DESC));
+    }, [&](GraphicsApi&, const RenderGraphResources&) {
+        culledRan = true;
+    });
+    graph.addPass("read", [&](RenderGraphBuilder& builder) {
+        builder.read(texture);
+        builder.read(buffer, ResourceState::SHADER_RESOURCE);
+        builder.sideEffect();
+    }, [&](GraphicsApi&, const RenderGraphResources&) {
+        readRan = true;
+    });
+
+    graph.execute(cmd);
+    CHECK(writeRan);
+    CHECK(readRan);
+    CHECK(!culledRan);
+
+    graph.clear();
+}
+
+// The backend moves a texture between passes on its own, here like a sampled write returned to
+// SHADER_RESOURCE by the next bind. The graph's later transitions must still match its state.
+void transitionAfterBackendMove(GraphicsApi& cmd, NullDevice& device)
+{
+    RenderGraph graph;
+    RenderGraphTexture texture;
+    HwTexture* physical = nullptr;
+    graph.addPass("compute", [&](RenderGraphBuilder& builder) {
+        texture = builder.write(builder.createTexture("texture", COLOR_DESC));
+    }, [&](GraphicsApi&, const RenderGraphResources& resources) {
+        physical = resources.getTexture(texture);
+    });
+    graph.addPass("unrelated", [&](RenderGraphBuilder& builder) {
+        builder.sideEffect();
+    }, [&](GraphicsApi& cmd, const RenderGraphResources&) {
+        cmd.queueCommand([&physical]() {
+            physical->setCurrentResourceState(ResourceState::SHADER_RESOURCE);
+        });
+    });
+    graph.addPass("sample", [&](RenderGraphBuilder& builder) {
+        builder.read(texture);
+        builder.write(builder.createTexture("result", COLOR_DESC));
+        builder.sideEffect();
+    }, nullptr);
+
+    uint32_t invalidBarriers = device.getInvalidBarrierCount();
+    graph.execute(cmd);
+    cmd.flush();
+    cmd.flush();
+    CHECK(device.getInvalidBarrierCount() == invalidBarriers);
+    CHECK(physical != nullptr && physical->getCurrentResourceState() == ResourceState::SHADER_RESOURCE);
+
+    graph.clear();
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    cullUnusedReadModifyWrite();
+    keepReadModifyWrite();
+    keepLoadedWriter();
+    assignSlots();
+
+    Settings settings { .name = "RenderGraphTest" };
+    auto device = new NullDevice();
+    if (!device->create(settings)) {
+        delete device;
+        return 1;
+    }
+
+    // the api owns the device from here, destroy deletes it
+    auto api = std::make_unique<GraphicsApi>(*device);
+    executeLivePasses(*api);
+    transitionAfterBackendMove(*api, *device);
+
+    // let the render thread drain before the device goes away
+    api->flush();
+    api->flush();
+    api->destroy();
+
+    return test::result();
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdio>
+
+namespace mygfx::test {
+
+inline int gFailures = 0;
+
+// returned by a test that needs hardware the machine does not have, see SKIP_RETURN_CODE
+static constexpr int SKIPPED = 77;
+
+inline int result()
+{
+    if (gFailures > 0) {
+        printf("%d checks failed\n", gFailures);
+        return 1;
+    }
+
+    printf("all checks passed\n");
+    return 0;
+}
+
+}
+
+#define CHECK(expr)                                                          \
+    do {                                                                     \
+        if (!(expr)) {                                                       \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #expr); \
+            mygfx::test::gFailures++;                                        \
+        }                                                                    \
+    } while (0)
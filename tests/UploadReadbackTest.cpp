@@ -0,0 +1,62 @@
+#include "TestUtils.h"
+#include "vulkan/VulkanDevice.h"
+#include <cstring>
+#include <vector>
+
+using namespace mygfx;
+
+namespace {
+
+constexpr uint32_t BUFFER_SIZE = 64 * 1024;
+
+// A GPU only buffer is filled through the copy queue and copied back on the graphics queue right
+// away, without flushing or waiting for the upload on the cpu. The submit has to wait for it.
+void readBackUpload(VulkanDevice& device)
+{
+    std::vector<uint32_t> data(BUFFER_SIZE / sizeof(uint32_t));
+    for (uint32_t i = 0; i < data.size(); i++) {
+        data[i] = i * 2654435761u;
+    }
+
+    Ref<HwBuffer> buffer = device.createBuffer(BufferUsage::STORAGE, MemoryUsage::GPU_ONLY, BUFFER_SIZE, 0, data.data());
+    Ref<HwBuffer> readback = device.createBuffer(BufferUsage::NONE, MemoryUsage::GPU_TO_CPU, BUFFER_SIZE, 0, nullptr);
+    auto src = static_cast<VulkanBuffer*>(buffer.get());
+    auto dst = static_cast<VulkanBuffer*>(readback.get());
+
+    auto cmd = device.getCommandBuffer(CommandQueueType::Graphics);
+    cmd->begin();
+
+    VkBufferCopy region { 0, 0, BUFFER_SIZE };
+    vkCmdCopyBuffer(cmd->cmd, src->buffer, dst->buffer, 1, &region);
+
+    VkMemoryBarrier barrier { VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(cmd->cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+    cmd->end();
+
+    uint64_t value = device.submit(*cmd);
+    device.getCommandQueue(CommandQueueType::Graphics).wait(value);
+    device.freeCommandBuffer(cmd);
+
+    dst->invalidate(BUFFER_SIZE, 0);
+    CHECK(std::memcmp(dst->map(0), data.data(), BUFFER_SIZE) == 0);
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    Settings settings { .name = "UploadReadbackTest" };
+    auto device = new VulkanDevice();
+    if (!device->create(settings)) {
+        printf("no Vulkan device, skipped\n");
+        delete device;
+        return test::SKIPPED;
+    }
+
+    readBackUpload(*device);
+
+    delete device;
+    return test::result();
+}